@@ -0,0 +1,148 @@
+/*******************************************************************************
+* RoboCore - Benchmark (v1.0)
+* 
+* Measure the execution time of the main methods of the library.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+// Each method is called SAMPLES times and the percentiles of the execution
+// time are printed as one JSON object per line, for example:
+//   {"name":"motors.turn","samples":1000,"unit":"ns","min":500,"p50":541,"p90":562,"p99":750,"max":3750}
+// The times are measured with the cycle counter (<VespaHAL::cycles()>) and
+// converted to nanoseconds with <VespaHAL::cyclesPerMicrosecond()>, so the unit
+// is the same on the ESP32 and on the simulator (see <extras/simulator>), where
+// the counter is the clock of the host.
+// Note: the motors are activated during the test, so keep the wheels off the ground.
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// Variables
+
+VespaBattery vbat;
+VespaButton button;
+VespaLED led;
+VespaMotors motors;
+VespaServo servo;
+
+const uint16_t SAMPLES = 1000;
+uint32_t samples[SAMPLES];
+uint32_t overhead = 0; // cost of reading the cycle counter
+
+// --------------------------------------------------
+
+// Compare two samples (for <qsort()>)
+int compareSamples(const void *a, const void *b){
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+// --------------------------------------------------
+
+// Convert a number of cycles to nanoseconds
+//  @param (cycles) : the number of cycles [uint32_t]
+//  @returns the time [ns] [uint32_t]
+uint32_t toNanoseconds(uint32_t cycles){
+  return ((uint64_t)cycles * 1000) / VespaHAL::cyclesPerMicrosecond();
+}
+
+// --------------------------------------------------
+
+// Measure a function and print the result
+//  @param (name) : the name of the test [const char *]
+//         (function) : the function to call with the index of the sample [F]
+template <typename F>
+void measure(const char *name, F function){
+  // collect the samples
+  for(uint16_t i=0 ; i < SAMPLES ; i++){
+    uint32_t start = VespaHAL::cycles();
+    function(i);
+    uint32_t elapsed = VespaHAL::cycles() - start;
+    samples[i] = (elapsed > overhead) ? (elapsed - overhead) : 0;
+  }
+  qsort(samples, SAMPLES, sizeof(uint32_t), compareSamples);
+
+  // print the percentiles
+  Serial.print("{\"name\":\"");
+  Serial.print(name);
+  Serial.print("\",\"samples\":");
+  Serial.print(SAMPLES);
+  Serial.print(",\"unit\":\"ns\",\"min\":");
+  Serial.print(toNanoseconds(samples[0]));
+  Serial.print(",\"p50\":");
+  Serial.print(toNanoseconds(samples[SAMPLES * 50 / 100]));
+  Serial.print(",\"p90\":");
+  Serial.print(toNanoseconds(samples[SAMPLES * 90 / 100]));
+  Serial.print(",\"p99\":");
+  Serial.print(toNanoseconds(samples[SAMPLES * 99 / 100]));
+  Serial.print(",\"max\":");
+  Serial.print(toNanoseconds(samples[SAMPLES - 1]));
+  Serial.println("}");
+}
+
+// --------------------------------------------------
+
+void setup(){
+  Vespa::begin(); // initialize all the drivers
+  Serial.begin(115200);
+  delay(1000);
+
+  // configure the objects
+  button.setDebounce(0); // no delay in <pressed()>
+  vbat.setBatteryType(BATTERY_LIPO);
+  servo.attach(VESPA_SERVO_S1);
+  led.blink(1);
+
+  // measure the cost of reading the counter
+  measure("overhead", [](uint16_t){});
+  overhead = samples[SAMPLES / 2];
+
+  Serial.print("{\"name\":\"config\",\"cycles_per_us\":");
+  Serial.print(VespaHAL::cyclesPerMicrosecond());
+  Serial.print(",\"overhead_ns\":");
+  Serial.print(toNanoseconds(overhead));
+  Serial.println("}");
+
+  // run the tests
+  measure("motors.setSpeedLeft", [](uint16_t i){ motors.setSpeedLeft(i % 100); });
+  measure("motors.setSpeedLeft.reverse", [](uint16_t i){ motors.setSpeedLeft((i & 0x01) ? 50 : -50); });
+  measure("motors.turn", [](uint16_t i){ motors.turn(i % 100, -(i % 100)); });
+  measure("motors.forward", [](uint16_t i){ motors.forward(i % 100); });
+  motors.stop();
+  measure("servo.write", [](uint16_t i){ servo.write(i % 180); });
+  measure("battery.readVoltage", [](uint16_t){ vbat.readVoltage(); });
+  measure("battery.readCapacity", [](uint16_t){ vbat.readCapacity(); });
+  measure("button.pressed", [](uint16_t){ button.pressed(); });
+  measure("led.update", [](uint16_t){ led.update(); });
+
+  Serial.println("{\"name\":\"done\"}");
+}
+
+// --------------------------------------------------
+
+void loop(){
+  // nothing to do here
+}
+
+// --------------------------------------------------
@@ -36,6 +36,7 @@ VespaLED led;
 // --------------------------------------------------
 
 void setup() {
+  Vespa::begin(); // initialize all the drivers
   led.blink(1000);
 }
 
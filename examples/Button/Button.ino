@@ -37,6 +37,7 @@ VespaLED led;
 // --------------------------------------------------
 
 void setup() {
+  Vespa::begin(); // initialize all the drivers
 }
 
 // --------------------------------------------------
@@ -0,0 +1,66 @@
+/*******************************************************************************
+* RoboCore - Commands (v1.0)
+* 
+* Control the board with binary commands from a companion computer.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+// The motors, the servo, the LED and the battery are controlled with the binary
+// frames of <VespaCommands> (see <extras/commands/vespa_commands.py>). If no valid
+// frame is received for 500 ms, the motors are stopped by a hardware timer.
+// Note: the motors are activated, so keep the wheels off the ground.
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// Variables
+
+VespaBattery vbat;
+VespaLED led;
+VespaMotors motors;
+VespaServo servo;
+VespaCommands commands(Serial, 500); // [ms]
+
+// --------------------------------------------------
+
+void setup(){
+  Vespa::begin(); // initialize all the drivers
+  Serial.begin(115200);
+
+  servo.attach(VESPA_SERVO_S1);
+
+  commands.attach(vbat);
+  commands.attach(led);
+  commands.attach(servo);
+  commands.attach(motors); // starts the deadman
+}
+
+// --------------------------------------------------
+
+void loop(){
+  commands.update();
+  led.update();
+}
+
+// --------------------------------------------------
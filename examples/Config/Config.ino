@@ -0,0 +1,104 @@
+/*******************************************************************************
+* RoboCore - Config (v1.0)
+* 
+* Store the calibration of the board in the flash and apply it at startup.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+
+// On the first run, the voltage divider of the battery is calibrated with a
+// reference measurement (e.g. from a multimeter) and the configuration is
+// saved with the limits of the servo. On the next runs, it is read from the
+// flash in a single read and applied to the drivers.
+// In the simulator, run it twice with "--storage config.bin" (the second run
+// shows "loaded").
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// Variables
+
+VespaBattery battery;
+VespaButton button;
+VespaConfig config;
+VespaMotors motors;
+VespaServo servo;
+
+const uint32_t MEASURED_VOLTAGE = 7350; // voltage of the battery measured with a multimeter [mV]
+const uint16_t SERVO_MIN = 600; // [us]
+const uint16_t SERVO_MAX = 2400; // [us]
+const uint32_t PRINT_PERIOD = 1000; // [ms]
+
+uint32_t print_time = 0;
+
+// --------------------------------------------------
+
+void setup(){
+  // read the configuration before the drivers are initialized
+  uint32_t start = micros();
+  config.begin();
+  uint32_t elapsed = micros() - start;
+
+  Vespa::begin(); // initialize all the drivers
+  Serial.begin(115200);
+
+  // first run: calibrate and save
+  if(!config.loaded()){
+    uint32_t conversion = ((uint64_t)config.get().battery_conversion * MEASURED_VOLTAGE) / battery.readVoltage();
+    config.setBatteryConversion(conversion);
+    config.setServoLimits(0, SERVO_MIN, SERVO_MAX);
+    Serial.println(config.save() ? "Configuration saved" : "Error: the configuration was not saved");
+  } else {
+    Serial.print("Configuration loaded in ");
+    Serial.print(elapsed);
+    Serial.println(" us");
+  }
+
+  // apply to the drivers
+  config.apply(battery);
+  config.apply(button);
+  config.apply(motors);
+  config.apply(servo, VESPA_SERVO_S1, 0);
+
+  Serial.print("Conversion: ");
+  Serial.println(config.get().battery_conversion);
+  Serial.print("Servo 0: ");
+  Serial.print(config.get().servo_min[0]);
+  Serial.print(" - ");
+  Serial.println(config.get().servo_max[0]);
+}
+
+// --------------------------------------------------
+
+void loop(){
+  if(millis() - print_time >= PRINT_PERIOD){
+    print_time = millis();
+    Serial.print("Battery: ");
+    Serial.print(battery.readVoltage());
+    Serial.println(" mV");
+  }
+}
+
+// --------------------------------------------------
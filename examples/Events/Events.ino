@@ -0,0 +1,104 @@
+/*******************************************************************************
+* RoboCore - Events (v1.0)
+* 
+* Handle the events of the board in the loop, with context.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+// The events of the button and of a hardware timer are posted to a queue and
+// handled by the methods of an object in <loop()>, so the handlers don't run in
+// the middle of <pressed()> or of the interrupt, and don't need global variables.
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// Classes
+
+class Robot {
+  public:
+    Robot(VespaLED &led) : _led(led), _ticks(0) {}
+
+    void onButton(uint32_t pressed){
+      if(pressed){
+        this->_led.on();
+      } else {
+        this->_led.off();
+      }
+      Serial.print("Button: ");
+      Serial.println(pressed ? "pressed" : "released");
+    }
+
+    void onTick(uint32_t time){
+      this->_ticks++;
+      Serial.print("Tick ");
+      Serial.print(this->_ticks);
+      Serial.print(" at ");
+      Serial.print(time);
+      Serial.println(" us");
+    }
+
+  private:
+    VespaLED &_led;
+    uint32_t _ticks;
+};
+
+// --------------------------------------------------
+// Variables
+
+VespaButton button;
+VespaLED led;
+VespaEventQueue events;
+Robot robot(led);
+
+const uint32_t TICK_PERIOD = 500000; // [us]
+const uint8_t DISPATCH_MAX = 4; // events per loop
+
+VespaDelegate tick_delegate = VespaDelegate::fromMethod<Robot, &Robot::onTick>(robot);
+
+// --------------------------------------------------
+
+// Interrupt of the timer
+void IRAM_ATTR onTimer(void *){
+  events.post(tick_delegate, micros()); // only posted, handled in <loop()>
+}
+
+// --------------------------------------------------
+
+void setup(){
+  Vespa::begin(); // initialize all the drivers
+  Serial.begin(115200);
+
+  button.onChange(VespaDelegate::fromMethod<Robot, &Robot::onButton>(robot), &events);
+  VespaHAL::timerStart(TICK_PERIOD, onTimer, nullptr);
+}
+
+// --------------------------------------------------
+
+void loop(){
+  button.pressed();
+  events.dispatch(DISPATCH_MAX); // bounded time
+}
+
+// --------------------------------------------------
@@ -0,0 +1,108 @@
+/*******************************************************************************
+* RoboCore - Low Power (v1.0)
+* 
+* Sleep between the ticks of the control loop.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+
+// The control loop runs every 50 ms and the CPU sleeps between the ticks.
+// Pressing the button wakes up the board and runs the motors for 1 second:
+// the PWM of the motors is clocked by RC_FAST, so the CPU keeps sleeping while
+// they run. Every second, the time in light sleep and the last wake-up source are
+// printed. Any data received by <Serial> also wakes up the board.
+// In the simulator: --duration 5000 --button 2010:2100 --events low_power.csv
+// (the "sleep" and "wakeup" events show the decisions)
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// Variables
+
+VespaButton button;
+VespaMotors motors;
+VespaPower power;
+
+const uint32_t TICK_PERIOD = 50000; // [us]
+const uint32_t MOTORS_DURATION = 1000; // [ms]
+const uint32_t PRINT_PERIOD = 1000; // [ms]
+
+uint32_t next_tick = 0;
+uint32_t motors_time = 0;
+bool motors_running = false;
+uint32_t print_time = 0;
+const char *wakeup_names[] = { "none", "timer", "uart", "gpio" };
+
+// --------------------------------------------------
+
+void setup(){
+  Vespa::begin(); // initialize all the drivers
+  Serial.begin(115200);
+  next_tick = micros();
+}
+
+// --------------------------------------------------
+
+void loop(){
+  // checked on every wake-up (no debounce delay, unlike <pressed()>)
+  if(button.read() && !motors_running){
+    motors.forward(50);
+    motors_time = millis();
+    motors_running = true;
+  }
+
+  // control tick
+  if((int32_t)(micros() - next_tick) >= 0){
+    next_tick += TICK_PERIOD;
+
+    if(motors_running && (millis() - motors_time >= MOTORS_DURATION)){
+      motors.stop();
+      motors_running = false;
+    }
+
+    while(Serial.available() > 0){
+      Serial.write(Serial.read()); // echo
+    }
+
+    if(millis() - print_time >= PRINT_PERIOD){
+      print_time = millis();
+      Serial.print("Sleep: ");
+      Serial.print(power.getSleepTime());
+      Serial.print(" ms of ");
+      Serial.print(millis());
+      Serial.print(" ms, wake-ups: ");
+      Serial.print(power.getWakeups());
+      Serial.print(", last: ");
+      Serial.print(wakeup_names[power.getWakeup()]);
+      Serial.print(", max latency: ");
+      Serial.print(power.getMaxLatency());
+      Serial.println(" us");
+    }
+  }
+
+  power.sleepUntil(next_tick);
+}
+
+// --------------------------------------------------
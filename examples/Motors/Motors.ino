@@ -37,6 +37,7 @@ const int PAUSE_TIME = 2000;
 // --------------------------------------------------
 
 void setup(){
+  Vespa::begin(); // initialize all the drivers
   Serial.begin(115200);
 }
 
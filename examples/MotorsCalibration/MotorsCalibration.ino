@@ -0,0 +1,134 @@
+/*******************************************************************************
+* RoboCore - Motors Calibration (v1.0)
+* 
+* Calibrate the deadband and the nonlinearity of the motors with encoders.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+// The speed of each motor is measured with an encoder (e.g. a slotted disk with
+// an optical sensor) for increasing duty cycles, then the calibration is built
+// so that the same speed (0-100%) moves both motors equally, without deadband.
+// The calibration is printed and saved in the flash (see <VespaConfig>), so
+// it is applied on the next runs (see the example "Config").
+// In the simulator, run it with "--plant" (the encoders are simulated).
+// Note: the motors are activated, so keep the wheels off the ground.
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// Variables
+
+VespaConfig config;
+VespaMotors motors;
+
+const uint8_t ENCODER_LEFT_PIN = 36;
+const uint8_t ENCODER_RIGHT_PIN = 39;
+const uint16_t SETTLE_TIME = 500; // [ms]
+
+volatile int32_t encoder_left = 0;
+volatile int32_t encoder_right = 0;
+
+// --------------------------------------------------
+// Prototypes
+
+void printPoints(const char *, const uint16_t *);
+int32_t readEncoder(uint8_t, void *);
+
+// --------------------------------------------------
+
+void IRAM_ATTR countLeft(){
+  encoder_left = encoder_left + 1;
+}
+
+// --------------------------------------------------
+
+void IRAM_ATTR countRight(){
+  encoder_right = encoder_right + 1;
+}
+
+// --------------------------------------------------
+
+void setup(){
+  Vespa::begin(); // initialize all the drivers
+  Serial.begin(115200);
+
+  pinMode(ENCODER_LEFT_PIN, INPUT);
+  pinMode(ENCODER_RIGHT_PIN, INPUT);
+  attachInterrupt(digitalPinToInterrupt(ENCODER_LEFT_PIN), countLeft, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(ENCODER_RIGHT_PIN), countRight, CHANGE);
+
+  Serial.println("Calibrating...");
+  VespaMotorsCalibration calibration;
+  if(!motors.calibrate(calibration, readEncoder, nullptr, SETTLE_TIME)){
+    Serial.println("Error: the motors or the encoders are not working");
+    return;
+  }
+
+  // duty cycles (0.01%) at 0, 10, ..., 100%
+  printPoints("left", calibration.left);
+  printPoints("right", calibration.right);
+
+  // keep the calibration for the next runs
+  config.setMotorsCalibration(calibration);
+  if(!config.save()){
+    Serial.println("Error: the calibration was not saved");
+  }
+
+  // the lowest speed now moves both motors
+  motors.forward(5);
+}
+
+// --------------------------------------------------
+
+void loop(){
+  // nothing to do here
+}
+
+// --------------------------------------------------
+
+// Print the points of a motor
+//  @param (name) : the name of the motor [const char *]
+//         (points) : the duty cycles [const uint16_t *]
+void printPoints(const char *name, const uint16_t *points){
+  Serial.print(name);
+  Serial.print(": { ");
+  for(uint8_t i=0 ; i < VESPA_MOTORS_CALIBRATION_POINTS ; i++){
+    Serial.print(points[i]);
+    Serial.print((i < VESPA_MOTORS_CALIBRATION_POINTS - 1) ? ", " : " }");
+  }
+  Serial.println();
+}
+
+// --------------------------------------------------
+
+// Read the count of an encoder
+//  @param (motor) : VespaMotors::LEFT or VespaMotors::RIGHT [uint8_t]
+//         (context) : not used [void *]
+//  @returns the count of the encoder [int32_t]
+int32_t readEncoder(uint8_t motor, void *){
+  return (motor == VespaMotors::LEFT) ? encoder_left : encoder_right;
+}
+
+// --------------------------------------------------
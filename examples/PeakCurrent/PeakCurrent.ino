@@ -0,0 +1,77 @@
+/*******************************************************************************
+* RoboCore - Peak Current (v1.0)
+* 
+* Drive four servos and both motors at the same time.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+// The four servos and the motors are driven at the same time, which is the
+// worst case for the current of the battery. By default, the library staggers
+// the phases of the PWM channels (<VESPA_PWM_STAGGER>), so the pulses of the
+// servos and of the motors don't start at the same time.
+// In the simulator, the peak current is printed at the end with "--plant". Build
+// with "-DVESPA_PWM_STAGGER=OFF" to compare with all the pulses in phase.
+// Note: the motors are activated, so keep the wheels off the ground.
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// Variables
+
+VespaMotors motors;
+VespaServo servos[VESPA_SERVO_QTY];
+
+const uint8_t SERVO_PINS[VESPA_SERVO_QTY] = { VESPA_SERVO_S1, VESPA_SERVO_S2, VESPA_SERVO_S3, VESPA_SERVO_S4 };
+const uint32_t STEP_PERIOD = 500; // [ms]
+
+uint32_t next_step = 0;
+bool side = false;
+
+// --------------------------------------------------
+
+void setup(){
+  Vespa::begin(); // initialize all the drivers
+  Serial.begin(115200);
+
+  for(uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+    servos[i].attach(SERVO_PINS[i]);
+  }
+  motors.forward(45);
+}
+
+// --------------------------------------------------
+
+void loop(){
+  // move all the servos from one side to the other
+  if(millis() >= next_step){
+    next_step += STEP_PERIOD;
+    side = !side;
+    for(uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+      servos[i].write(side ? 170 : 10);
+    }
+  }
+}
+
+// --------------------------------------------------
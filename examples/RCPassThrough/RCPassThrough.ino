@@ -0,0 +1,99 @@
+/*******************************************************************************
+* RoboCore - RC Pass Through (v1.0)
+* 
+* Drive the motors and a servo with a RC receiver.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+
+// Connect the outputs of a RC receiver to the servo pins: the channels 1 and 2
+// (left and right sticks, tank mode) to S1 and S2, and the channel 3 to S3.
+// The pulses drive the motors and the servo on S4 directly from the interrupt
+// of the capture. If the receiver is turned off, the motors stop after the
+// timeout and the event is printed in <loop()>.
+// In the simulator: --pulses 26:2000 --pulses 25:1250:3000 --pulses 33:1800
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// Variables
+
+VespaMotors motors;
+VespaRCInput receiver;
+VespaServo servo;
+VespaEventQueue events;
+
+const uint8_t CHANNEL_LEFT = 0;
+const uint8_t CHANNEL_RIGHT = 1;
+const uint8_t CHANNEL_SERVO = 2;
+const uint32_t PRINT_PERIOD = 500; // [ms]
+
+uint32_t print_time = 0;
+
+// --------------------------------------------------
+
+// Handle the signal loss of a channel (in <loop()>)
+void onLost(void *, uint32_t channel){
+  Serial.print("Signal lost on channel ");
+  Serial.println(channel + 1);
+}
+
+// --------------------------------------------------
+
+void setup(){
+  Vespa::begin(); // initialize all the drivers
+  Serial.begin(115200);
+
+  servo.attach(VESPA_SERVO_S4);
+  receiver.attach(CHANNEL_LEFT, VESPA_SERVO_S1);
+  receiver.attach(CHANNEL_RIGHT, VESPA_SERVO_S2);
+  receiver.attach(CHANNEL_SERVO, VESPA_SERVO_S3);
+
+  receiver.passThrough(CHANNEL_LEFT, CHANNEL_RIGHT, motors);
+  receiver.passThrough(CHANNEL_SERVO, servo);
+  receiver.onLost(VespaDelegate(onLost), &events);
+}
+
+// --------------------------------------------------
+
+void loop(){
+  events.dispatch();
+
+  if(millis() - print_time >= PRINT_PERIOD){
+    print_time = millis();
+    for(uint8_t i=0 ; i < 3 ; i++){
+      Serial.print("CH");
+      Serial.print(i + 1);
+      Serial.print(": ");
+      Serial.print(receiver.read(i));
+      Serial.print(" us (");
+      Serial.print(receiver.readSpeed(i));
+      Serial.print(" %)  ");
+    }
+    Serial.println();
+  }
+}
+
+// --------------------------------------------------
@@ -0,0 +1,102 @@
+/*******************************************************************************
+* RoboCore - Record (v1.0)
+* 
+* Record the calls to the actuators and write the log.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+// The calls are recorded only when the library is compiled with <VESPA_RECORD_ENABLED>
+// defined (e.g. "build_flags = -DVESPA_RECORD_ENABLED" in PlatformIO, or
+// "cmake -DVESPA_RECORD=ON" in the simulator). Otherwise, the log is empty.
+// A scenario is run for SCENARIO_DURATION, then the binary log is written to the
+// serial port. The log can be replayed with the example <Replay>.
+// Note: the motors are activated, so keep the wheels off the ground.
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// Variables
+
+VespaLED led;
+VespaMotors motors;
+VespaServo servo;
+
+const size_t LOG_SIZE = 4096; // [bytes]
+const uint32_t LOOP_PERIOD = 20; // [ms]
+const uint32_t SCENARIO_DURATION = 3000; // [ms]
+
+uint8_t log_buffer[LOG_SIZE];
+VespaRecorder recorder(log_buffer, LOG_SIZE);
+
+uint32_t next_loop = 0;
+bool dumped = false;
+int8_t speed = 0;
+
+// --------------------------------------------------
+
+void setup(){
+  Vespa::begin(); // initialize all the drivers
+  Serial.begin(115200);
+
+  servo.attach(VESPA_SERVO_S1);
+
+  // the same order must be used in the replay
+  recorder.attach(led);
+  recorder.attach(motors);
+  recorder.attach(servo);
+  recorder.start();
+
+  led.blink(250);
+}
+
+// --------------------------------------------------
+
+void loop(){
+  led.update(); // not recorded, the blink is replayed by the LED
+
+  if (dumped || (millis() < next_loop)){
+    return;
+  }
+  next_loop += LOOP_PERIOD;
+
+  // scenario
+  if (millis() < SCENARIO_DURATION){
+    if (speed < 100){
+      speed += 2;
+      motors.turn(speed, speed / 2);
+    }
+    servo.write(90 + (millis() / 20) % 90);
+    return;
+  }
+
+  // write the log
+  motors.stop();
+  led.off();
+  recorder.stop();
+  recorder.dump(Serial);
+  dumped = true;
+}
+
+// --------------------------------------------------
@@ -0,0 +1,92 @@
+/*******************************************************************************
+* RoboCore - Replay (v1.0)
+* 
+* Replay a log of the calls to the actuators.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+// The log written by the example <Record> is received through the serial port
+// and replayed with the same timing, once no byte is received for RECEIVE_TIMEOUT.
+// In the simulator, the log can be given with "--serial <file>".
+// Note: the motors are activated, so keep the wheels off the ground.
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// Variables
+
+VespaLED led;
+VespaMotors motors;
+VespaServo servo;
+
+const size_t LOG_SIZE = 4096; // [bytes]
+const uint32_t RECEIVE_TIMEOUT = 500; // [ms]
+
+uint8_t log_buffer[LOG_SIZE];
+size_t log_size = 0;
+uint32_t last_receive = 0;
+bool started = false;
+
+VespaReplay replay(log_buffer, LOG_SIZE); // the size of the entries is in the header
+
+// --------------------------------------------------
+
+void setup(){
+  Vespa::begin(); // initialize all the drivers
+  Serial.begin(115200);
+
+  servo.attach(VESPA_SERVO_S1);
+
+  // the same order as in the recording
+  replay.attach(led);
+  replay.attach(motors);
+  replay.attach(servo);
+}
+
+// --------------------------------------------------
+
+void loop(){
+  led.update();
+
+  // receive the log
+  if (!started){
+    while (Serial.available() && (log_size < LOG_SIZE)){
+      log_buffer[log_size++] = Serial.read();
+      last_receive = millis();
+    }
+    if ((log_size > 0) && (millis() - last_receive >= RECEIVE_TIMEOUT)){
+      started = replay.start();
+      if (!started){
+        Serial.println("Invalid log");
+        log_size = 0;
+      }
+    }
+    return;
+  }
+
+  replay.update();
+}
+
+// --------------------------------------------------
@@ -0,0 +1,116 @@
+/*******************************************************************************
+* RoboCore - Self Test (v1.0)
+* 
+* Check the motors at boot, with the battery and the encoders.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+
+// At boot, each motor runs briefly in each direction while the battery and the
+// encoders are measured, and the health of the motors is printed in a single
+// line. If a motor is not healthy, the LED blinks and the motors are not used.
+// In the simulator, run it with "--plant", and add "--motor-fault left:open" or
+// "--motor-fault right:stall" to see a failure.
+// Note: the motors are activated, so keep the wheels off the ground.
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// Variables
+
+VespaBattery battery;
+VespaLED led;
+VespaMotors motors;
+VespaSelfTest self_test(motors, battery);
+
+const uint8_t ENCODER_LEFT_PIN = 36;
+const uint8_t ENCODER_RIGHT_PIN = 39;
+
+volatile int32_t encoder_left = 0;
+volatile int32_t encoder_right = 0;
+
+// --------------------------------------------------
+// Prototypes
+
+int32_t readEncoder(uint8_t, void *);
+
+// --------------------------------------------------
+
+void IRAM_ATTR countLeft(){
+  encoder_left = encoder_left + 1;
+}
+
+// --------------------------------------------------
+
+void IRAM_ATTR countRight(){
+  encoder_right = encoder_right + 1;
+}
+
+// --------------------------------------------------
+
+void setup(){
+  Vespa::begin(); // initialize all the drivers
+  Serial.begin(115200);
+
+  // encoders (optional, without them the stall is detected by the current)
+  pinMode(ENCODER_LEFT_PIN, INPUT);
+  pinMode(ENCODER_RIGHT_PIN, INPUT);
+  attachInterrupt(digitalPinToInterrupt(ENCODER_LEFT_PIN), countLeft, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(ENCODER_RIGHT_PIN), countRight, CHANGE);
+  self_test.setEncoders(readEncoder);
+
+  VespaSelfTestReport report;
+  self_test.run(report);
+  VespaSelfTest::print(report, Serial);
+
+  if(self_test.passed()){
+    led.on();
+  } else {
+    led.blink(200);
+  }
+}
+
+// --------------------------------------------------
+
+void loop(){
+  led.update();
+
+  // drive only if the motors are healthy
+  if(self_test.passed()){
+    motors.forward(50);
+  }
+}
+
+// --------------------------------------------------
+
+// Read the count of an encoder
+//  @param (motor) : VespaMotors::LEFT or VespaMotors::RIGHT [uint8_t]
+//         (context) : not used [void *]
+//  @returns the count of the encoder [int32_t]
+int32_t readEncoder(uint8_t motor, void *){
+  return (motor == VespaMotors::LEFT) ? encoder_left : encoder_right;
+}
+
+// --------------------------------------------------
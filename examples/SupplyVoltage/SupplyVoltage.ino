@@ -36,6 +36,7 @@ VespaBattery vbat;
 // --------------------------------------------------
 
 void setup() {
+  Vespa::begin(); // initialize all the drivers
   Serial.begin(115200);
 }
 
@@ -0,0 +1,78 @@
+/*******************************************************************************
+* RoboCore - Telemetry (v1.0)
+* 
+* Stream the state of the board as binary records.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+// The state of the motors, servo, battery and button is sent at 100 Hz as
+// binary records (COBS + CRC), without blocking the loop. Decode them with
+// <extras/telemetry/vespa_telemetry.py>.
+// Note: the motors are activated, so keep the wheels off the ground.
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// Variables
+
+VespaBattery vbat;
+VespaButton button;
+VespaMotors motors;
+VespaServo servo;
+VespaTelemetry telemetry(Serial);
+
+const uint32_t STEP_PERIOD = 50; // [ms]
+
+uint32_t next_step = 0;
+int8_t speed = 0;
+
+// --------------------------------------------------
+
+void setup(){
+  Vespa::begin(); // initialize all the drivers
+  Serial.begin(115200);
+
+  servo.attach(VESPA_SERVO_S1);
+
+  telemetry.attach(vbat);
+  telemetry.attach(button);
+  telemetry.attach(motors);
+  telemetry.attach(servo);
+}
+
+// --------------------------------------------------
+
+void loop(){
+  // change the speed and the angle periodically
+  if (millis() >= next_step){
+    next_step += STEP_PERIOD;
+    speed = (speed >= 100) ? -100 : (speed + 5);
+    motors.turn(speed, -speed);
+    servo.write(90 + (speed * 9) / 10);
+  }
+
+  telemetry.update(); // never blocks
+}
+
+// --------------------------------------------------
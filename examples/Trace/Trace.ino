@@ -0,0 +1,90 @@
+/*******************************************************************************
+* RoboCore - Trace (v1.0)
+* 
+* Record the calls of a control loop and write the binary trace.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+// The trace is recorded only when the library is compiled with <VESPA_TRACE_ENABLED>
+// defined (e.g. "build_flags = -DVESPA_TRACE_ENABLED" in PlatformIO, or
+// "cmake -DVESPA_TRACE=ON" in the simulator). Otherwise, only the header is written.
+// The binary trace is written to the serial port when the button is pressed (or
+// once after DUMP_PERIOD). Decode it with <extras/trace/vespa_trace.py>.
+// Note: the motors are activated, so keep the wheels off the ground.
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// Variables
+
+VespaBattery vbat;
+VespaButton button;
+VespaLED led;
+VespaMotors motors;
+VespaServo servo;
+
+const uint32_t LOOP_PERIOD = 10; // [ms]
+const uint32_t DUMP_PERIOD = 2000; // [ms]
+
+uint32_t next_loop = 0;
+bool dumped = false;
+int8_t speed = 0;
+
+// --------------------------------------------------
+
+void setup(){
+  Vespa::begin(); // initialize all the drivers
+  Serial.begin(115200);
+
+  vbat.setBatteryType(BATTERY_LIPO);
+  servo.attach(VESPA_SERVO_S1);
+  led.blink(500);
+
+  VespaTrace::clear(); // only the control loop
+}
+
+// --------------------------------------------------
+
+void loop(){
+  if (millis() < next_loop){
+    return;
+  }
+  next_loop += LOOP_PERIOD;
+
+  // control loop
+  vbat.readCapacity();
+  motors.turn(speed, -speed);
+  servo.write(90 + speed);
+  led.update();
+  speed = (speed >= 50) ? -50 : (speed + 1);
+
+  // write the trace
+  if (button.pressed() || (!dumped && (millis() >= DUMP_PERIOD))){
+    motors.stop();
+    VespaTrace::dump(Serial);
+    VespaTrace::clear();
+    dumped = true;
+  }
+}
+
+// --------------------------------------------------
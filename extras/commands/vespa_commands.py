@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+# RoboCore - Vespa Commands
+#
+# Build the binary frames of <VespaCommands> and send them to a serial port
+# (requires pyserial) or write them to a file (e.g. for the simulator).
+#
+#   python3 vespa_commands.py --port /dev/ttyUSB0 motors 50 -50
+#   python3 vespa_commands.py --port /dev/ttyUSB0 battery
+#   python3 vespa_commands.py --output commands.bin --repeat 100 motors 30 30
+#
+# This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+# Licensed under the GNU Lesser General Public License v3 or later.
+
+import argparse
+import struct
+import sys
+
+PING = 0x01
+MOTORS = 0x10
+MOTORS_STOP = 0x11
+SERVO = 0x20
+LED = 0x30
+BATTERY = 0x40
+REPLY = 0x80
+
+LED_MODES = {'off': 0, 'on': 1, 'blink': 2}
+
+
+def crc16(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def encode_cobs(data):
+    output = bytearray([0])
+    index_code = 0
+    for byte in data:
+        if byte == 0:
+            output[index_code] = len(output) - index_code
+            index_code = len(output)
+            output.append(0)
+        else:
+            output.append(byte)
+            if len(output) - index_code == 0xFF:
+                output[index_code] = 0xFF
+                index_code = len(output)
+                output.append(0)
+    output[index_code] = len(output) - index_code
+    return bytes(output)
+
+
+def decode_cobs(frame):
+    output = bytearray()
+    index = 0
+    while index < len(frame):
+        code = frame[index]
+        if code == 0 or index + code > len(frame):
+            raise ValueError('invalid COBS frame')
+        output += frame[index + 1:index + code]
+        index += code
+        if code < 0xFF and index < len(frame):
+            output.append(0)
+    return bytes(output)
+
+
+def frame(command, sequence, arguments=b''):
+    record = bytes([command, sequence & 0xFF]) + arguments
+    return encode_cobs(record + struct.pack('<H', crc16(record))) + b'\x00'
+
+
+def build(args, sequence):
+    if args.command == 'ping':
+        return frame(PING, sequence)
+    if args.command == 'motors':
+        return frame(MOTORS, sequence, struct.pack('<bb', int(args.values[0]), int(args.values[1])))
+    if args.command == 'stop':
+        return frame(MOTORS_STOP, sequence)
+    if args.command == 'servo':
+        return frame(SERVO, sequence, struct.pack('<BH', int(args.values[0]), int(args.values[1])))
+    if args.command == 'led':
+        period = int(args.values[1]) if len(args.values) > 1 else 0
+        return frame(LED, sequence, struct.pack('<BH', LED_MODES[args.values[0]], period))
+    if args.command == 'battery':
+        return frame(BATTERY, sequence)
+    raise ValueError('unknown command')
+
+
+def print_reply(data):
+    try:
+        record = decode_cobs(data)
+    except ValueError:
+        return
+    if len(record) < 4 or crc16(record[:-2]) != struct.unpack('<H', record[-2:])[0]:
+        return
+    if record[0] == PING | REPLY:
+        print('pong %d' % record[1])
+    elif record[0] == BATTERY | REPLY:
+        voltage, capacity = struct.unpack('<HB', record[2:5])
+        print('battery %d mV %d %%' % (voltage, capacity))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Send commands to a Vespa')
+    parser.add_argument('command', choices=['ping', 'motors', 'stop', 'servo', 'led', 'battery'])
+    parser.add_argument('values', nargs='*', help='motors <left> <right> | servo <index> <value> | led <off|on|blink> [period]')
+    parser.add_argument('--port', help='serial port')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--output', help='file to write the frames (instead of the serial port)')
+    parser.add_argument('--repeat', type=int, default=1, help='number of frames')
+    args = parser.parse_args()
+
+    data = b''.join(build(args, i) for i in range(args.repeat))
+    if args.output:
+        open(args.output, 'wb').write(data)
+    elif args.port:
+        import serial
+        port = serial.Serial(args.port, args.baud, timeout=0.2)
+        port.write(data)
+        for reply in port.read(1024).split(b'\x00'):
+            if reply:
+                print_reply(reply)
+    else:
+        sys.stdout.buffer.write(data)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,183 @@
+/*******************************************************************************
+* RoboCore - Vespa Simulator (Arduino API)
+* 
+* Minimal Arduino API to build the library and its examples on Linux.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+// --------------------------------------------------
+// Libraries
+
+#include "VespaSim.h"
+
+// --------------------------------------------------
+// Variables
+
+HardwareSerial Serial;
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+void analogSetPinAttenuation(uint8_t pin, adc_attenuation_t attenuation){
+  VespaHAL::analogSetPinAttenuation(pin, attenuation);
+}
+
+uint32_t analogReadMilliVolts(uint8_t pin){
+  return VespaHAL::analogReadMilliVolts(pin);
+}
+
+int digitalRead(uint8_t pin){
+  return VespaHAL::digitalRead(pin);
+}
+
+void digitalWrite(uint8_t pin, uint8_t level){
+  VespaHAL::digitalWrite(pin, level);
+}
+
+void pinMode(uint8_t pin, uint8_t mode){
+  VespaHAL::pinMode(pin, mode);
+}
+
+void attachInterrupt(uint8_t pin, void (*callback)(void), int mode){
+  VespaSim::attachInterrupt(pin, callback, mode);
+}
+
+void detachInterrupt(uint8_t pin){
+  VespaSim::attachInterrupt(pin, nullptr, 0);
+}
+
+// --------------------------------------------------
+
+void delay(uint32_t duration){
+  VespaHAL::delay(duration);
+}
+
+void delayMicroseconds(uint32_t duration){
+  VespaSim::advance(duration);
+}
+
+unsigned long micros(void){
+  return VespaHAL::micros();
+}
+
+unsigned long millis(void){
+  return VespaHAL::millis();
+}
+
+void yield(void){
+  // nothing to do here
+}
+
+// --------------------------------------------------
+
+// Same implementation as in the Arduino core
+long map(long x, long in_min, long in_max, long out_min, long out_max){
+  const long dividend = out_max - out_min;
+  const long divisor = in_max - in_min;
+  const long delta = x - in_min;
+  if(divisor == 0){
+    return -1; // AVR returns -1, SAM returns 0
+  }
+  return (delta * dividend + (divisor / 2)) / divisor + out_min;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+size_t Print::write(const uint8_t * buffer, size_t size){
+  size_t res = 0;
+  while(size--){
+    res += this->write(*buffer++);
+  }
+  return res;
+}
+
+size_t Print::write(const char * text){
+  if(text == nullptr){
+    return 0;
+  }
+  return this->write((const uint8_t *)text, strlen(text));
+}
+
+// --------------------------------------------------
+
+size_t Print::print(const char * text){
+  return this->write(text);
+}
+
+size_t Print::print(char value){
+  return this->write((uint8_t)value);
+}
+
+size_t Print::print(unsigned char value, int base){
+  return this->print((unsigned long)value, base);
+}
+
+size_t Print::print(int value, int base){
+  return this->print((long)value, base);
+}
+
+size_t Print::print(unsigned int value, int base){
+  return this->print((unsigned long)value, base);
+}
+
+size_t Print::print(long value, int base){
+  if((base == DEC) && (value < 0)){
+    size_t res = this->print('-');
+    return res + this->_printNumber((unsigned long)(-(value + 1)) + 1, DEC);
+  }
+  return this->_printNumber((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base){
+  return this->_printNumber(value, base);
+}
+
+size_t Print::print(double value, int digits){
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+  return this->write(buffer);
+}
+
+size_t Print::println(void){
+  return this->write("\r\n");
+}
+
+// --------------------------------------------------
+
+size_t Print::_printNumber(unsigned long value, int base){
+  char buffer[8 * sizeof(long) + 1];
+  char *text = &buffer[sizeof(buffer) - 1];
+  *text = '\0';
+
+  if(base < 2){
+    base = 10;
+  }
+  do {
+    char digit = value % base;
+    value /= base;
+    *--text = (digit < 10) ? (digit + '0') : (digit + 'A' - 10);
+  } while(value);
+
+  return this->write(text);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
@@ -0,0 +1,173 @@
+#ifndef VESPA_SIM_ARDUINO_H
+#define VESPA_SIM_ARDUINO_H
+
+/*******************************************************************************
+* RoboCore - Vespa Simulator (Arduino API)
+* 
+* Minimal Arduino API to build the library and its examples on Linux.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+// Note: only the functions used by the library and by the examples are
+//       available. They are implemented over the simulated HAL (see <VespaSim.h>).
+
+// --------------------------------------------------
+// Libraries
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --------------------------------------------------
+// Macros
+
+#ifndef VESPA_HAL_LINUX
+#define VESPA_HAL_LINUX
+#endif
+
+#define HIGH (0x1)
+#define LOW (0x0)
+
+// same values as in the Arduino ESP package
+#define INPUT (0x01)
+#define OUTPUT (0x03)
+#define PULLUP (0x04)
+#define INPUT_PULLUP (0x05)
+#define PULLDOWN (0x08)
+#define INPUT_PULLDOWN (0x09)
+
+// interrupts (same values as in the Arduino ESP package)
+#define RISING (0x01)
+#define FALLING (0x02)
+#define CHANGE (0x03)
+#define digitalPinToInterrupt(pin) (pin)
+
+#define DEC (10)
+#define HEX (16)
+#define BIN (2)
+
+// there is no IRAM on the host
+#define IRAM_ATTR
+#define ARDUINO_ISR_ATTR
+
+// --------------------------------------------------
+// Types
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+typedef enum {
+  ADC_0db,
+  ADC_2_5db,
+  ADC_6db,
+  ADC_11db
+} adc_attenuation_t;
+
+// --------------------------------------------------
+// Functions
+
+void analogSetPinAttenuation(uint8_t, adc_attenuation_t);
+uint32_t analogReadMilliVolts(uint8_t);
+int digitalRead(uint8_t);
+void digitalWrite(uint8_t, uint8_t);
+void pinMode(uint8_t, uint8_t);
+
+void attachInterrupt(uint8_t, void (*)(void), int);
+void detachInterrupt(uint8_t);
+
+void delay(uint32_t);
+void delayMicroseconds(uint32_t);
+unsigned long micros(void);
+unsigned long millis(void);
+void yield(void);
+
+long map(long, long, long, long, long);
+
+// sketch
+void setup(void);
+void loop(void);
+
+// --------------------------------------------------
+// Class - Print
+
+class Print {
+  public:
+    virtual ~Print(void) {}
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t *, size_t);
+    virtual int availableForWrite(void) { return 0; }
+    size_t write(const char *);
+
+    size_t print(const char *);
+    size_t print(char);
+    size_t print(unsigned char, int = DEC);
+    size_t print(int, int = DEC);
+    size_t print(unsigned int, int = DEC);
+    size_t print(long, int = DEC);
+    size_t print(unsigned long, int = DEC);
+    size_t print(double, int = 2);
+
+    size_t println(void);
+    template <typename T> size_t println(T value) { size_t res = this->print(value); return res + this->println(); }
+    template <typename T> size_t println(T value, int format) { size_t res = this->print(value, format); return res + this->println(); }
+
+  private:
+    size_t _printNumber(unsigned long, int);
+};
+
+// --------------------------------------------------
+// Class - Stream
+
+class Stream : public Print {
+  public:
+    virtual int available(void) = 0;
+    virtual int peek(void) = 0;
+    virtual int read(void) = 0;
+};
+
+// --------------------------------------------------
+// Class - Hardware Serial
+
+// Simulated UART
+//  Note: the output goes to <stdout> and the input comes from <VespaSim::serialInject()>.
+//        The transmission takes time according to the baud rate, like in the hardware.
+class HardwareSerial : public Stream {
+  public:
+    HardwareSerial(void);
+    void begin(unsigned long);
+    void end(void);
+    int available(void) override;
+    int availableForWrite(void) override;
+    void flush(void);
+    int peek(void) override;
+    int read(void) override;
+    size_t write(uint8_t) override;
+    size_t write(const uint8_t *, size_t) override;
+    using Print::write;
+    operator bool(void) const;
+};
+
+extern HardwareSerial Serial;
+
+// --------------------------------------------------
+
+#endif // VESPA_SIM_ARDUINO_H
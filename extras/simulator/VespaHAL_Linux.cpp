@@ -0,0 +1,1389 @@
+/*******************************************************************************
+* RoboCore - Vespa Simulator (HAL)
+* 
+* Linux backend of the HAL, with simulated GPIO, ADC, LEDC, UART and clock.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+// --------------------------------------------------
+// Libraries
+
+#include "VespaSim.h"
+
+#include <map>
+#include <string>
+#include <time.h>
+
+// --------------------------------------------------
+// Macros
+
+#define VESPA_SIM_EVENTS_MAX (1000000) // limit of the recorded events
+#define VESPA_SIM_INPUT_CHANGES (16) // scheduled changes of the inputs
+#define VESPA_SIM_LEDC_TIMER_QTY (8) // 4 per group of 8 channels
+#define VESPA_SIM_SLEEP_STEP (100) // resolution of the wake-up sources in light sleep [us]
+#define VESPA_SIM_TIMER_QTY (4) // as in the ESP32
+#define VESPA_SIM_UART_FIFO (128) // [bytes]
+
+// --------------------------------------------------
+// Structures
+
+// Periodic timer
+struct VespaSimTimer {
+  bool active;
+  uint32_t period; // [us]
+  uint64_t next; // time of the next call [us]
+  void (*callback)(void *);
+  void *arg;
+};
+
+// --------------------------------------------------
+
+// Capture of the pulses of a pin (see <VespaHAL::captureStart()>)
+struct VespaSimCapture {
+  void (*callback)(void *, uint32_t);
+  void *arg;
+  uint64_t rise; // time of the last rising edge [us]
+};
+
+// --------------------------------------------------
+
+// Pulse generator of a pin (see <VespaSim::setPulses()>)
+struct VespaSimPulses {
+  VespaSimTimer timer; // next edge
+  uint8_t pin;
+  uint32_t width; // [us]
+  uint32_t period; // [us]
+  uint64_t rise; // time of the last rising edge [us]
+};
+
+// --------------------------------------------------
+
+// Scheduled change of an input (see <VespaSim::setInputAt()>)
+struct VespaSimInputChange {
+  VespaSimTimer timer; // one shot
+  uint8_t pin;
+  uint8_t level;
+};
+
+// --------------------------------------------------
+
+// State of the simulated peripherals
+struct VespaSimState {
+  uint64_t time; // [us]
+  bool recording;
+
+  // GPIO
+  uint8_t mode[VESPA_SIM_PIN_QTY];
+  uint8_t level[VESPA_SIM_PIN_QTY]; // output level
+  uint8_t input[VESPA_SIM_PIN_QTY]; // level applied externally
+  void (*interrupt[VESPA_SIM_PIN_QTY])(void); // called on the edges of <input>
+  uint8_t interrupt_mode[VESPA_SIM_PIN_QTY]; // RISING, FALLING or CHANGE
+  VespaSimCapture capture[VESPA_SIM_PIN_QTY];
+  VespaSimPulses pulses[VESPA_SIM_PIN_QTY];
+  VespaSimInputChange input_changes[VESPA_SIM_INPUT_CHANGES];
+
+  // ADC
+  uint32_t millivolts[VESPA_SIM_PIN_QTY];
+
+  // LEDC
+  uint8_t attached[VESPA_SIM_PIN_QTY]; // channel attached by the driver
+  uint8_t route[VESPA_SIM_PIN_QTY]; // channel routed in the GPIO matrix
+  uint32_t duty[VESPA_SIM_CHANNEL_QTY];
+  uint32_t phase[VESPA_SIM_CHANNEL_QTY]; // hpoint
+  uint32_t frequency[VESPA_SIM_CHANNEL_QTY]; // [Hz]
+  uint8_t resolution[VESPA_SIM_CHANNEL_QTY]; // [bits]
+  uint16_t used_channels; // bit mask
+  uint16_t active_channels; // bit mask of the channels with a duty cycle
+  uint16_t sleep_channels; // bit mask of the channels that keep running in light sleep
+  uint64_t ledc_timer_start[VESPA_SIM_LEDC_TIMER_QTY]; // time when the timer was configured [us]
+
+  // timers
+  VespaSimTimer timers[VESPA_SIM_TIMER_QTY];
+  VespaSimTimer step; // fixed step of the models (see <VespaSim::setStep()>)
+  bool in_timer; // a callback is running
+
+  // UART
+  bool uart_started;
+  uint32_t uart_baud;
+  uint64_t uart_tx_end; // time when the last byte is transmitted [us]
+  std::vector<uint8_t> uart_rx;
+  size_t uart_rx_index;
+
+  // storage (kept by <VespaSim::reset()>, like the flash)
+  std::map<std::string, std::vector<uint8_t>> storage;
+  std::string storage_path; // file of the records, or empty
+
+  std::vector<VespaSimEvent> events;
+};
+
+// --------------------------------------------------
+// Variables
+
+static VespaSimState *_sim = nullptr; // created on the first use (global objects are constructed before <main()>)
+
+// --------------------------------------------------
+// Prototypes
+
+static void _inputChange(void *);
+static uint8_t _ledcTimer(uint8_t);
+static void _pulseEdge(void *);
+static VespaSimState & _state(void);
+static void _record(uint8_t, uint8_t, uint8_t, uint32_t);
+static bool _writeStorage(void);
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Set the attenuation of an ADC pin
+//  @param (pin) : the pin [uint8_t]
+//         (attenuation) : the attenuation [adc_attenuation_t]
+void VespaHAL::analogSetPinAttenuation(uint8_t pin, adc_attenuation_t attenuation){
+  _record(SIM_ADC_ATTENUATION, pin, VESPA_SIM_NONE, attenuation);
+}
+
+// --------------------------------------------------
+
+// Read the calibrated voltage of an ADC pin
+//  @param (pin) : the pin [uint8_t]
+//  @returns the voltage (in mV) [uint32_t]
+uint32_t VespaHAL::analogReadMilliVolts(uint8_t pin){
+  if(pin >= VESPA_SIM_PIN_QTY){
+    return 0;
+  }
+  return _state().millivolts[pin];
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Read the level of a pin
+//  @param (pin) : the pin [uint8_t]
+//  @returns HIGH or LOW [int]
+int VespaHAL::digitalRead(uint8_t pin){
+  if(pin >= VESPA_SIM_PIN_QTY){
+    return LOW;
+  }
+
+  VespaSimState & state = _state();
+  if(state.mode[pin] == OUTPUT){
+    return state.level[pin];
+  }
+  return state.input[pin];
+}
+
+// --------------------------------------------------
+
+// Set the level of a pin
+//  @param (pin) : the pin [uint8_t]
+//         (level) : HIGH or LOW [uint8_t]
+void VespaHAL::digitalWrite(uint8_t pin, uint8_t level){
+  if(pin >= VESPA_SIM_PIN_QTY){
+    return;
+  }
+  _state().level[pin] = (level == LOW) ? LOW : HIGH;
+  _record(SIM_DIGITAL_WRITE, pin, VESPA_SIM_NONE, level);
+}
+
+// --------------------------------------------------
+
+// Set the mode of a pin
+//  @param (pin) : the pin [uint8_t]
+//         (mode) : the mode (e.g. INPUT, OUTPUT) [uint8_t]
+void VespaHAL::pinMode(uint8_t pin, uint8_t mode){
+  if(pin >= VESPA_SIM_PIN_QTY){
+    return;
+  }
+
+  VespaSimState & state = _state();
+  state.mode[pin] = mode;
+  if(mode == INPUT_PULLUP){
+    state.input[pin] = HIGH;
+  } else if(mode == INPUT_PULLDOWN){
+    state.input[pin] = LOW;
+  }
+  _record(SIM_PIN_MODE, pin, VESPA_SIM_NONE, mode);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Attach a pin to a LEDC channel selected automatically
+//  @param (pin) : the pin [uint8_t]
+//         (frequency) : the frequency of the PWM [Hz] [uint32_t]
+//         (resolution) : the resolution of the PWM [bits] [uint8_t]
+//  @returns true if successful [bool]
+//  Note: like in the Arduino ESP package, the lowest free channel is selected.
+bool VespaHAL::ledcAttach(uint8_t pin, uint32_t frequency, uint8_t resolution){
+  VespaSimState & state = _state();
+  for(uint8_t channel=0 ; channel < VESPA_SIM_CHANNEL_QTY ; channel++){
+    if((state.used_channels & (1 << channel)) == 0){
+      return VespaHAL::ledcAttachChannel(pin, frequency, resolution, channel);
+    }
+  }
+  return false;
+}
+
+// --------------------------------------------------
+
+// Attach a pin to a LEDC channel
+//  @param (pin) : the pin [uint8_t]
+//         (frequency) : the frequency of the PWM [Hz] [uint32_t]
+//         (resolution) : the resolution of the PWM [bits] [uint8_t]
+//         (channel) : the LEDC channel (0-15) [uint8_t]
+//  @returns true if successful [bool]
+bool VespaHAL::ledcAttachChannel(uint8_t pin, uint32_t frequency, uint8_t resolution, uint8_t channel){
+  if((pin >= VESPA_SIM_PIN_QTY) || (channel >= VESPA_SIM_CHANNEL_QTY) || (frequency == 0) || (resolution == 0) || (resolution > 20)){
+    return false;
+  }
+
+  VespaSimState & state = _state();
+  if(state.attached[pin] != VESPA_SIM_NONE){
+    return false; // already attached
+  }
+
+  state.attached[pin] = channel;
+  state.route[pin] = channel;
+  state.phase[channel] = 0;
+  state.frequency[channel] = frequency;
+  state.resolution[channel] = resolution;
+  state.used_channels |= (1 << channel);
+  state.ledc_timer_start[_ledcTimer(channel)] = state.time; // the timer is configured (and reset) again
+  _record(SIM_LEDC_ATTACH, pin, channel, frequency);
+
+  return true;
+}
+
+// --------------------------------------------------
+
+// Attach a pin to a LEDC channel that keeps running in light sleep
+//  @param (pin) : the pin [uint8_t]
+//         (frequency) : the frequency of the PWM [Hz] [uint32_t]
+//         (resolution) : the resolution of the PWM [bits] [uint8_t]
+//         (channel) : the LEDC channel, of the low speed group (8-15) [uint8_t]
+//  @returns true if successful [bool]
+//  Note: like in the ESP32, only the channels of the low speed group can be clocked
+//        by RC_FAST. The clock of the simulator is exact, so there is no calibration.
+bool VespaHAL::ledcAttachSleep(uint8_t pin, uint32_t frequency, uint8_t resolution, uint8_t channel){
+  if(!VespaHAL::ledcAttachChannel(pin, frequency, resolution, channel)){
+    return false;
+  }
+  if(VESPA_PWM_SLEEP_CLOCK && (channel >= 8)){
+    _state().sleep_channels |= (1 << channel);
+  }
+  return true;
+}
+
+// --------------------------------------------------
+
+// Detach a pin from the LEDC
+//  @param (pin) : the pin [uint8_t]
+//  @returns true if successful [bool]
+bool VespaHAL::ledcDetach(uint8_t pin){
+  if(pin >= VESPA_SIM_PIN_QTY){
+    return false;
+  }
+
+  VespaSimState & state = _state();
+  uint8_t channel = state.attached[pin];
+  if(channel == VESPA_SIM_NONE){
+    return false;
+  }
+
+  state.attached[pin] = VESPA_SIM_NONE;
+  state.route[pin] = VESPA_SIM_NONE;
+  state.used_channels &= ~(1 << channel);
+  state.active_channels &= ~(1 << channel);
+  state.sleep_channels &= ~(1 << channel);
+  _record(SIM_LEDC_DETACH, pin, channel, 0);
+
+  return true;
+}
+
+// --------------------------------------------------
+
+// Get the LEDC channel attached to a pin
+//  @param (pin) : the pin [uint8_t]
+//  @returns the channel, or 0xFF if the pin is not attached [uint8_t]
+uint8_t VespaHAL::ledcGetChannel(uint8_t pin){
+  if(pin >= VESPA_SIM_PIN_QTY){
+    return 0xFF;
+  }
+  return _state().attached[pin];
+}
+
+// --------------------------------------------------
+
+// Check if a LEDC channel is generating a PWM signal
+//  @returns true if a channel has a duty cycle [bool]
+//  Note: like in the ESP32, the channels are tracked by <ledcWriteChannel()> and
+//        <ledcDetach()>, even if no pin is routed to them.
+bool VespaHAL::ledcActive(void){
+  return (_state().active_channels != 0);
+}
+
+// --------------------------------------------------
+
+// Check if the PWM outputs keep running in light sleep
+//  @returns true if all the channels with a duty cycle keep running [bool]
+//  Note: see <ledcAttachSleep()>.
+bool VespaHAL::ledcCanSleep(void){
+  VespaSimState & state = _state();
+  return ((state.active_channels & ~state.sleep_channels) == 0);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Route a GPIO to the output signal of a LEDC channel
+//  @param (pin) : the pin to route [uint8_t]
+//         (channel) : the LEDC channel (0-15) [uint8_t]
+void VespaHAL::ledcConnect(uint8_t pin, uint8_t channel){
+  if((pin >= VESPA_SIM_PIN_QTY) || (channel >= VESPA_SIM_CHANNEL_QTY)){
+    return;
+  }
+  _state().route[pin] = channel;
+  _record(SIM_LEDC_CONNECT, pin, channel, 0);
+}
+
+// --------------------------------------------------
+
+// Disconnect a GPIO from any peripheral and drive it LOW
+//  @param (pin) : the pin to disconnect [uint8_t]
+void VespaHAL::ledcDisconnect(uint8_t pin){
+  if(pin >= VESPA_SIM_PIN_QTY){
+    return;
+  }
+
+  VespaSimState & state = _state();
+  state.level[pin] = LOW;
+  state.route[pin] = VESPA_SIM_NONE;
+  _record(SIM_LEDC_DISCONNECT, pin, VESPA_SIM_NONE, 0);
+}
+
+// --------------------------------------------------
+
+// Set the phase of a LEDC channel
+//  @param (channel) : the LEDC channel (0-15) [uint8_t]
+//         (hpoint) : the tick of the period where the output goes high [uint32_t]
+void VespaHAL::ledcSetPhase(uint8_t channel, uint32_t hpoint){
+  if(channel >= VESPA_SIM_CHANNEL_QTY){
+    return;
+  }
+  _state().phase[channel] = hpoint;
+  _record(SIM_LEDC_PHASE, VESPA_SIM_NONE, channel, hpoint);
+}
+
+// --------------------------------------------------
+
+// Write the duty cycle of a LEDC channel
+//  @param (channel) : the LEDC channel (0-15) [uint8_t]
+//         (duty) : the duty cycle, in ticks of the channel resolution [uint32_t]
+void VespaHAL::ledcWriteChannel(uint8_t channel, uint32_t duty){
+  if(channel >= VESPA_SIM_CHANNEL_QTY){
+    return;
+  }
+  VespaSimState & state = _state();
+  state.duty[channel] = duty;
+  if(duty > 0){
+    state.active_channels |= (1 << channel);
+  } else {
+    state.active_channels &= ~(1 << channel);
+  }
+  _record(SIM_LEDC_WRITE, VESPA_SIM_NONE, channel, duty);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Get the core that is running the code
+//  @returns the ID of the core [uint8_t]
+//  Note: the simulator has a single core.
+uint8_t VespaHAL::coreID(void){
+  return 0;
+}
+
+// --------------------------------------------------
+
+// Check if the code is running in an interrupt
+//  @returns true if called from an interrupt [bool]
+//  Note: the callbacks of the timers, of the interrupts of the pins and of the
+//        captures are the interrupts of the simulator.
+bool VespaHAL::inInterrupt(void){
+  return _state().in_timer;
+}
+
+// --------------------------------------------------
+
+// Enter light sleep
+//  @param (duration) : the maximum time to sleep [us] [uint32_t]
+//         (pin) : the pin that wakes up on a change of level, or <VESPA_POWER_NONE> [uint8_t]
+//         (uart) : true to wake up when <Serial> has data to read [bool]
+//  @returns the source of the wake-up [VespaWakeup]
+//  Note: the clock advances in steps of <VESPA_SIM_SLEEP_STEP> until a source wakes
+//        up, so the models (e.g. <VespaPlant>) keep running. The sleep and the
+//        wake-up are recorded as events.
+VespaWakeup VespaHAL::lightSleep(uint32_t duration, uint8_t pin, bool uart){
+  VespaSimState & state = _state();
+  bool with_pin = (pin < VESPA_SIM_PIN_QTY);
+  uint8_t level = with_pin ? state.input[pin] : LOW;
+  uint64_t end = state.time + duration;
+  VespaWakeup wakeup = WAKEUP_TIMER;
+
+  _record(SIM_SLEEP, with_pin ? pin : VESPA_SIM_NONE, VESPA_SIM_NONE, duration);
+  while(state.time < end){
+    if(uart && (state.uart_rx_index < state.uart_rx.size())){
+      wakeup = WAKEUP_UART;
+      break;
+    }
+    if(with_pin && (state.input[pin] != level)){
+      wakeup = WAKEUP_GPIO;
+      break;
+    }
+
+    uint64_t step = end - state.time;
+    if(step > VESPA_SIM_SLEEP_STEP){
+      step = VESPA_SIM_SLEEP_STEP;
+    }
+    VespaSim::advance(step);
+  }
+  _record(SIM_WAKEUP, with_pin ? pin : VESPA_SIM_NONE, VESPA_SIM_NONE, wakeup);
+
+  return wakeup;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Start the capture of the pulses of a pin
+//  @param (pin) : the pin [uint8_t]
+//         (callback) : the function to call with the width of each high pulse [us] [void (*)(void *, uint32_t)]
+//         (arg) : the argument of the callback [void *]
+//  @returns the handle of the capture, or null if not available [void *]
+//  Note: the callback is called by <VespaSim::setInput()> on the falling edge (the
+//        ESP32 reports the pulse a few [ms] later, when the line is idle).
+void * VespaHAL::captureStart(uint8_t pin, void (*callback)(void *, uint32_t), void *arg){
+  VespaSimState & state = _state();
+  if((pin >= VESPA_SIM_PIN_QTY) || (callback == nullptr) || (state.capture[pin].callback != nullptr)){
+    return nullptr;
+  }
+
+  VespaSimCapture & capture = state.capture[pin];
+  capture.callback = callback;
+  capture.arg = arg;
+  capture.rise = state.time;
+  return &capture;
+}
+
+// --------------------------------------------------
+
+// Stop the capture of the pulses of a pin
+//  @param (capture) : the handle returned by <captureStart()> [void *]
+void VespaHAL::captureStop(void *capture){
+  if(capture != nullptr){
+    ((VespaSimCapture *)capture)->callback = nullptr;
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Read a record from the storage
+//  @param (key) : the name of the record [const char *]
+//         (data) : the buffer [void *]
+//         (size) : the size of the record [bytes] [size_t]
+//  @returns true if the record exists and has this size [bool]
+bool VespaHAL::storageRead(const char *key, void *data, size_t size){
+  VespaSimState & state = _state();
+  auto record = state.storage.find(key);
+  if((record == state.storage.end()) || (record->second.size() != size)){
+    return false;
+  }
+
+  memcpy(data, record->second.data(), size);
+  return true;
+}
+
+// --------------------------------------------------
+
+// Write a record to the storage
+//  @param (key) : the name of the record [const char *]
+//         (data) : the record [const void *]
+//         (size) : the size of the record [bytes] [size_t]
+//  @returns true if successful [bool]
+//  Note: the write is recorded as an event (with the size). If a file was set
+//        with <VespaSim::setStorageFile()>, it is replaced atomically.
+bool VespaHAL::storageWrite(const char *key, const void *data, size_t size){
+  VespaSimState & state = _state();
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  state.storage[key].assign(bytes, bytes + size);
+  _record(SIM_STORAGE_WRITE, VESPA_SIM_NONE, VESPA_SIM_NONE, size);
+  return _writeStorage();
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Start a periodic timer
+//  @param (period) : the period [us] [uint32_t]
+//         (callback) : the function to call [void (*)(void *)]
+//         (arg) : the argument of the callback [void *]
+//  @returns the handle of the timer, or null if not available [void *]
+//  Note: the callbacks are called by <VespaSim::advance()>, at their simulated time.
+void * VespaHAL::timerStart(uint32_t period, void (*callback)(void *), void *arg){
+  VespaSimState & state = _state();
+  if((period == 0) || (callback == nullptr)){
+    return nullptr;
+  }
+
+  for(uint8_t i=0 ; i < VESPA_SIM_TIMER_QTY ; i++){
+    VespaSimTimer & timer = state.timers[i];
+    if(!timer.active){
+      timer.active = true;
+      timer.period = period;
+      timer.next = state.time + period;
+      timer.callback = callback;
+      timer.arg = arg;
+      return &timer;
+    }
+  }
+
+  return nullptr;
+}
+
+// --------------------------------------------------
+
+// Get the time until the next call of a timer
+//  @returns the time, or 0xFFFFFFFF if no timer is running [us] [uint32_t]
+uint32_t VespaHAL::timerNext(void){
+  VespaSimState & state = _state();
+  uint64_t next = 0xFFFFFFFF;
+  for(uint8_t i=0 ; i < VESPA_SIM_TIMER_QTY ; i++){
+    const VespaSimTimer & timer = state.timers[i];
+    if(timer.active){
+      uint64_t remaining = (timer.next > state.time) ? (timer.next - state.time) : 0;
+      if(remaining < next){
+        next = remaining;
+      }
+    }
+  }
+  return next;
+}
+
+// --------------------------------------------------
+
+// Stop a timer
+//  @param (timer) : the handle returned by <timerStart()> [void *]
+void VespaHAL::timerStop(void *timer){
+  if(timer != nullptr){
+    ((VespaSimTimer *)timer)->active = false;
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Read the cycle counter of the CPU
+//  @returns the number of cycles [uint32_t]
+//  Note: on the host, the counter is the monotonic clock in [ns] (real time, not simulated).
+uint32_t VespaHAL::cycles(void){
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)((uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+
+// --------------------------------------------------
+
+// Get the frequency of the cycle counter
+//  @returns the number of cycles per [us] [uint32_t]
+uint32_t VespaHAL::cyclesPerMicrosecond(void){
+  return 1000; // [ns]
+}
+
+// --------------------------------------------------
+
+// Wait for some time
+//  @param (duration) : the time to wait [ms] [uint32_t]
+//  Note: the simulated clock advances immediately.
+void VespaHAL::delay(uint32_t duration){
+  VespaSim::advance((uint64_t)duration * 1000);
+}
+
+// --------------------------------------------------
+
+// Get the time since the boot
+//  @returns the time [us] [uint32_t]
+uint32_t VespaHAL::micros(void){
+  return (uint32_t)_state().time;
+}
+
+// --------------------------------------------------
+
+// Get the time since the boot
+//  @returns the time [ms] [uint32_t]
+uint32_t VespaHAL::millis(void){
+  return (uint32_t)(_state().time / 1000);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Reset the simulator to the state of the board after the boot
+//  Note: the battery is at 7.4 V (2S LiPo) and the button is released.
+void VespaSim::reset(void){
+  VespaSimState & state = _state();
+
+  state.time = 0;
+  state.recording = true;
+  for(uint8_t i=0 ; i < VESPA_SIM_PIN_QTY ; i++){
+    state.mode[i] = INPUT;
+    state.level[i] = LOW;
+    state.input[i] = LOW;
+    state.interrupt[i] = nullptr;
+    state.capture[i].callback = nullptr;
+    state.pulses[i].timer.active = false;
+    state.millivolts[i] = 0;
+    state.attached[i] = VESPA_SIM_NONE;
+    state.route[i] = VESPA_SIM_NONE;
+  }
+  for(uint8_t i=0 ; i < VESPA_SIM_CHANNEL_QTY ; i++){
+    state.duty[i] = 0;
+    state.phase[i] = 0;
+    state.frequency[i] = 0;
+    state.resolution[i] = 0;
+  }
+  state.used_channels = 0;
+  state.active_channels = 0;
+  state.sleep_channels = 0;
+  for(uint8_t i=0 ; i < VESPA_SIM_LEDC_TIMER_QTY ; i++){
+    state.ledc_timer_start[i] = 0;
+  }
+
+  for(uint8_t i=0 ; i < VESPA_SIM_TIMER_QTY ; i++){
+    state.timers[i].active = false;
+  }
+  for(uint8_t i=0 ; i < VESPA_SIM_INPUT_CHANGES ; i++){
+    state.input_changes[i].timer.active = false;
+  }
+  state.step.active = false;
+  state.in_timer = false;
+
+  state.uart_started = false;
+  state.uart_baud = 0;
+  state.uart_tx_end = 0;
+  state.uart_rx.clear();
+  state.uart_rx_index = 0;
+
+  state.events.clear();
+
+  // board defaults
+  state.input[VESPA_BUTTON_PIN] = HIGH; // external pull-up
+  state.millivolts[VESPA_BATTERY_PIN] = (7400UL * 1000) / VESPA_BATTERY_VOLTAGE_CONVERSION;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Advance the simulated clock
+//  @param (duration) : the time to advance [us] [uint64_t]
+//  Note: the timers that expire are called in order, at their time.
+void VespaSim::advance(uint64_t duration){
+  VespaSimState & state = _state();
+  uint64_t end = state.time + duration;
+
+  // the callbacks are interrupts, so they don't call other callbacks
+  if(state.in_timer){
+    state.time = end;
+    return;
+  }
+
+  while(true){
+    // find the next timer to expire (the step of the models first)
+    VespaSimTimer *next = nullptr;
+    if(state.step.active && (state.step.next <= end)){
+      next = &state.step;
+    }
+    for(uint8_t i=0 ; i < VESPA_SIM_TIMER_QTY ; i++){
+      VespaSimTimer & timer = state.timers[i];
+      if(timer.active && (timer.next <= end) && ((next == nullptr) || (timer.next < next->next))){
+        next = &timer;
+      }
+    }
+    for(uint8_t i=0 ; i < VESPA_SIM_PIN_QTY ; i++){
+      VespaSimTimer & timer = state.pulses[i].timer;
+      if(timer.active && (timer.next <= end) && ((next == nullptr) || (timer.next < next->next))){
+        next = &timer;
+      }
+    }
+    for(uint8_t i=0 ; i < VESPA_SIM_INPUT_CHANGES ; i++){
+      VespaSimTimer & timer = state.input_changes[i].timer;
+      if(timer.active && (timer.next <= end) && ((next == nullptr) || (timer.next < next->next))){
+        next = &timer;
+      }
+    }
+    if(next == nullptr){
+      break;
+    }
+
+    // call it
+    if(next->next > state.time){
+      state.time = next->next;
+    }
+    next->next += next->period;
+    state.in_timer = true;
+    next->callback(next->arg);
+    state.in_timer = false;
+  }
+
+  state.time = end;
+}
+
+// --------------------------------------------------
+
+// Set the fixed step of a model of the environment (e.g. <VespaPlant>)
+//  @param (period) : the period of the step, or 0 to remove it [us] [uint32_t]
+//         (callback) : the function to call at each step [void (*)(void *)]
+//         (arg) : the argument of the callback [void *]
+//  Note: the steps are aligned to multiples of the period, so the result doesn't
+//        depend on how the clock is advanced.
+void VespaSim::setStep(uint32_t period, void (*callback)(void *), void *arg){
+  VespaSimState & state = _state();
+  if((period == 0) || (callback == nullptr)){
+    state.step.active = false;
+    return;
+  }
+
+  state.step.active = true;
+  state.step.period = period;
+  state.step.next = (state.time / period + 1) * period;
+  state.step.callback = callback;
+  state.step.arg = arg;
+}
+
+// --------------------------------------------------
+
+// Get the simulated time
+//  @returns the time since the boot [us] [uint64_t]
+uint64_t VespaSim::now(void){
+  return _state().time;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Attach an interrupt to an input pin
+//  @param (pin) : the pin [uint8_t]
+//         (callback) : the function to call, or null to detach [void (*)(void)]
+//         (mode) : RISING, FALLING or CHANGE [uint8_t]
+//  Note: the callback is called by <setInput()>, so with the time of the model that changes the input.
+void VespaSim::attachInterrupt(uint8_t pin, void (*callback)(void), uint8_t mode){
+  if(pin >= VESPA_SIM_PIN_QTY){
+    return;
+  }
+  VespaSimState & state = _state();
+  state.interrupt[pin] = callback;
+  state.interrupt_mode[pin] = mode;
+}
+
+// --------------------------------------------------
+
+// Get the output level of a pin (set with <digitalWrite()>)
+//  @param (pin) : the pin [uint8_t]
+//  @returns HIGH or LOW [uint8_t]
+uint8_t VespaSim::getLevel(uint8_t pin){
+  if(pin >= VESPA_SIM_PIN_QTY){
+    return LOW;
+  }
+  return _state().level[pin];
+}
+
+// --------------------------------------------------
+
+// Get the mode of a pin
+//  @param (pin) : the pin [uint8_t]
+//  @returns the mode (e.g. INPUT, OUTPUT) [uint8_t]
+uint8_t VespaSim::getMode(uint8_t pin){
+  if(pin >= VESPA_SIM_PIN_QTY){
+    return INPUT;
+  }
+  return _state().mode[pin];
+}
+
+// --------------------------------------------------
+
+// Schedule a level to apply to an input pin
+//  @param (pin) : the pin [uint8_t]
+//         (level) : HIGH or LOW [uint8_t]
+//         (time) : the time to apply it, since the boot [us] [uint64_t]
+//  @returns false if there are already <VESPA_SIM_INPUT_CHANGES> changes scheduled [bool]
+//  Note: the level is applied with <setInput()> by <advance()>, so it also wakes
+//        up the light sleep.
+bool VespaSim::setInputAt(uint8_t pin, uint8_t level, uint64_t time){
+  if(pin >= VESPA_SIM_PIN_QTY){
+    return false;
+  }
+  VespaSimState & state = _state();
+
+  for(uint8_t i=0 ; i < VESPA_SIM_INPUT_CHANGES ; i++){
+    VespaSimInputChange & change = state.input_changes[i];
+    if(!change.timer.active){
+      change.timer.active = true;
+      change.timer.period = 0;
+      change.timer.next = time;
+      change.timer.callback = _inputChange;
+      change.timer.arg = &change;
+      change.pin = pin;
+      change.level = level;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// --------------------------------------------------
+
+// Generate periodic pulses on an input pin (e.g. the signal of a RC receiver)
+//  @param (pin) : the pin [uint8_t]
+//         (width) : the width of the high pulses, or 0 to stop [us] [uint32_t]
+//         (period) : the period of the pulses (default: 20000) [us] [uint32_t]
+//  Note: the edges are applied with <setInput()> by <advance()>, at their time.
+//        When stopped, the pin stays low (signal loss).
+void VespaSim::setPulses(uint8_t pin, uint32_t width, uint32_t period){
+  if(pin >= VESPA_SIM_PIN_QTY){
+    return;
+  }
+  VespaSimState & state = _state();
+  VespaSimPulses & pulses = state.pulses[pin];
+
+  if((width == 0) || (width >= period)){
+    pulses.timer.active = false;
+    setInput(pin, LOW);
+    return;
+  }
+
+  pulses.pin = pin;
+  pulses.width = width;
+  pulses.period = period;
+  if(!pulses.timer.active){
+    pulses.timer.active = true;
+    pulses.timer.next = state.time; // first rising edge now
+    pulses.timer.callback = _pulseEdge;
+    pulses.timer.arg = &pulses;
+    setInput(pin, LOW);
+  }
+}
+
+// --------------------------------------------------
+
+// Apply a level to an input pin
+//  @param (pin) : the pin [uint8_t]
+//         (level) : HIGH or LOW [uint8_t]
+void VespaSim::setInput(uint8_t pin, uint8_t level){
+  if(pin >= VESPA_SIM_PIN_QTY){
+    return;
+  }
+  VespaSimState & state = _state();
+  level = (level == LOW) ? LOW : HIGH;
+  if(level == state.input[pin]){
+    return;
+  }
+  state.input[pin] = level;
+
+  // interrupt
+  uint8_t edge = (level == HIGH) ? RISING : FALLING;
+  if((state.interrupt[pin] != nullptr) && (state.interrupt_mode[pin] & edge)){
+    bool in_timer = state.in_timer;
+    state.in_timer = true;
+    state.interrupt[pin]();
+    state.in_timer = in_timer;
+  }
+
+  // capture
+  VespaSimCapture & capture = state.capture[pin];
+  if(capture.callback != nullptr){
+    if(level == HIGH){
+      capture.rise = state.time;
+    } else {
+      bool in_timer = state.in_timer;
+      state.in_timer = true;
+      capture.callback(capture.arg, (uint32_t)(state.time - capture.rise));
+      state.in_timer = in_timer;
+    }
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Apply a voltage to an ADC pin
+//  @param (pin) : the pin [uint8_t]
+//         (millivolts) : the voltage on the pin [mV] [uint32_t]
+void VespaSim::setMilliVolts(uint8_t pin, uint32_t millivolts){
+  if(pin >= VESPA_SIM_PIN_QTY){
+    return;
+  }
+  _state().millivolts[pin] = millivolts;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Get the duty cycle of a LEDC channel
+//  @param (channel) : the LEDC channel [uint8_t]
+//  @returns the duty cycle, in ticks of the resolution [uint32_t]
+uint32_t VespaSim::getDuty(uint8_t channel){
+  if(channel >= VESPA_SIM_CHANNEL_QTY){
+    return 0;
+  }
+  return _state().duty[channel];
+}
+
+// --------------------------------------------------
+
+// Get the frequency of a LEDC channel
+//  @param (channel) : the LEDC channel [uint8_t]
+//  @returns the frequency [Hz] [uint32_t]
+uint32_t VespaSim::getFrequency(uint8_t channel){
+  if(channel >= VESPA_SIM_CHANNEL_QTY){
+    return 0;
+  }
+  return _state().frequency[channel];
+}
+
+// --------------------------------------------------
+
+// Get the average output of a pin
+//  @param (pin) : the pin [uint8_t]
+//  @returns the fraction of the time the pin is HIGH (0.0-1.0) [float]
+float VespaSim::getOutput(uint8_t pin){
+  if(pin >= VESPA_SIM_PIN_QTY){
+    return 0.0;
+  }
+
+  VespaSimState & state = _state();
+  uint8_t channel = state.route[pin];
+  if(channel != VESPA_SIM_NONE){
+    if(state.resolution[channel] == 0){
+      return 0.0; // not configured
+    }
+    float output = (float)state.duty[channel] / (float)(1UL << state.resolution[channel]);
+    return (output > 1.0) ? 1.0 : output;
+  }
+  if(state.mode[pin] == OUTPUT){
+    return (state.level[pin] == HIGH) ? 1.0 : 0.0;
+  }
+  return 0.0;
+}
+
+// --------------------------------------------------
+
+// Get the phase of a LEDC channel
+//  @param (channel) : the LEDC channel [uint8_t]
+//  @returns the tick of the period where the output goes high [uint32_t]
+uint32_t VespaSim::getPhase(uint8_t channel){
+  if(channel >= VESPA_SIM_CHANNEL_QTY){
+    return 0;
+  }
+  return _state().phase[channel];
+}
+
+// --------------------------------------------------
+
+// Get the time when the timer of a LEDC channel was started
+//  @param (channel) : the LEDC channel [uint8_t]
+//  @returns the time of the last configuration of the timer [us] [uint64_t]
+//  Note: the channels with the same frequency but different timers keep the
+//        offset between the start of their timers.
+uint64_t VespaSim::getTimerStart(uint8_t channel){
+  if(channel >= VESPA_SIM_CHANNEL_QTY){
+    return 0;
+  }
+  return _state().ledc_timer_start[_ledcTimer(channel)];
+}
+
+// --------------------------------------------------
+
+// Get the LEDC channel routed to a pin
+//  @param (pin) : the pin [uint8_t]
+//  @returns the channel, or VESPA_SIM_NONE [uint8_t]
+uint8_t VespaSim::getPinChannel(uint8_t pin){
+  if(pin >= VESPA_SIM_PIN_QTY){
+    return VESPA_SIM_NONE;
+  }
+  return _state().route[pin];
+}
+
+// --------------------------------------------------
+
+// Get the resolution of a LEDC channel
+//  @param (channel) : the LEDC channel [uint8_t]
+//  @returns the resolution [bits] [uint8_t]
+uint8_t VespaSim::getResolution(uint8_t channel){
+  if(channel >= VESPA_SIM_CHANNEL_QTY){
+    return 0;
+  }
+  return _state().resolution[channel];
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Set the file of the storage, to keep the records between the runs
+//  @param (path) : the path of the file, created on the first write [const char *]
+//  @returns false if the file exists but is invalid [bool]
+//  Note: the file has, for each record, the size of the name (uint8_t), the
+//        name, the size of the data (uint32_t, host byte order) and the data.
+bool VespaSim::setStorageFile(const char *path){
+  VespaSimState & state = _state();
+  state.storage_path = path;
+  state.storage.clear();
+
+  FILE *file = fopen(path, "rb");
+  if(file == nullptr){
+    return true; // not written yet
+  }
+
+  bool valid = true;
+  uint8_t length;
+  while(fread(&length, 1, 1, file) == 1){
+    char key[256];
+    uint32_t size;
+    if((fread(key, 1, length, file) != length) || (fread(&size, sizeof(size), 1, file) != 1)){
+      valid = false;
+      break;
+    }
+    std::vector<uint8_t> data(size);
+    if(fread(data.data(), 1, size, file) != size){
+      valid = false;
+      break;
+    }
+    state.storage[std::string(key, length)] = data;
+  }
+  fclose(file);
+
+  if(!valid){
+    state.storage.clear();
+  }
+  return valid;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Add bytes to the reception buffer of the UART
+//  @param (data) : the bytes received [const uint8_t *]
+//         (size) : the number of bytes [size_t]
+void VespaSim::serialInject(const uint8_t * data, size_t size){
+  VespaSimState & state = _state();
+  state.uart_rx.insert(state.uart_rx.end(), data, data + size);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Delete the events recorded
+void VespaSim::clearEvents(void){
+  _state().events.clear();
+}
+
+// --------------------------------------------------
+
+// Get the events recorded
+//  @returns the list of events [const std::vector<VespaSimEvent> &]
+const std::vector<VespaSimEvent> & VespaSim::events(void){
+  return _state().events;
+}
+
+// --------------------------------------------------
+
+// Enable or disable the recording of the events
+//  @param (recording) : true to record [bool]
+void VespaSim::setRecording(bool recording){
+  _state().recording = recording;
+}
+
+// --------------------------------------------------
+
+// Write the events recorded in CSV format
+//  @param (file) : the output file [FILE *]
+void VespaSim::writeEvents(FILE * file){
+  const char *names[] = { "pin_mode", "digital_write", "adc_attenuation", "ledc_attach", "ledc_detach", "ledc_connect", "ledc_disconnect", "ledc_write", "ledc_phase", "sleep", "wakeup", "storage_write" };
+
+  fprintf(file, "time_us,event,pin,channel,value\n");
+  for(const VespaSimEvent & event : _state().events){
+    fprintf(file, "%llu,%s,", (unsigned long long)event.time, names[event.type]);
+    if(event.pin != VESPA_SIM_NONE){
+      fprintf(file, "%u", event.pin);
+    }
+    fprintf(file, ",");
+    if(event.channel != VESPA_SIM_NONE){
+      fprintf(file, "%u", event.channel);
+    }
+    fprintf(file, ",%lu\n", (unsigned long)event.value);
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Constructor
+HardwareSerial::HardwareSerial(void){
+  // nothing to do here
+}
+
+// --------------------------------------------------
+
+// Start the UART
+//  @param (baud) : the baud rate [unsigned long]
+void HardwareSerial::begin(unsigned long baud){
+  VespaSimState & state = _state();
+  state.uart_started = (baud > 0);
+  state.uart_baud = baud;
+  state.uart_tx_end = state.time;
+}
+
+// --------------------------------------------------
+
+// Stop the UART
+void HardwareSerial::end(void){
+  _state().uart_started = false;
+}
+
+// --------------------------------------------------
+
+// Get the number of bytes received
+//  @returns the number of bytes available to read [int]
+int HardwareSerial::available(void){
+  VespaSimState & state = _state();
+  return (int)(state.uart_rx.size() - state.uart_rx_index);
+}
+
+// --------------------------------------------------
+
+// Get the free space in the transmission FIFO
+//  @returns the number of bytes that can be written without blocking [int]
+int HardwareSerial::availableForWrite(void){
+  VespaSimState & state = _state();
+  if(!state.uart_started){
+    return 0;
+  }
+
+  uint64_t pending = 0;
+  if(state.uart_tx_end > state.time){
+    pending = ((state.uart_tx_end - state.time) * state.uart_baud + 9999999) / 10000000; // 10 bits per byte
+  }
+  return (pending >= VESPA_SIM_UART_FIFO) ? 0 : (int)(VESPA_SIM_UART_FIFO - pending);
+}
+
+// --------------------------------------------------
+
+// Wait for the transmission of all the bytes
+void HardwareSerial::flush(void){
+  VespaSimState & state = _state();
+  if(state.uart_tx_end > state.time){
+    VespaSim::advance(state.uart_tx_end - state.time);
+  }
+}
+
+// --------------------------------------------------
+
+// Get the next byte received without removing it
+//  @returns the byte or -1 if none [int]
+int HardwareSerial::peek(void){
+  VespaSimState & state = _state();
+  if(state.uart_rx_index >= state.uart_rx.size()){
+    return -1;
+  }
+  return state.uart_rx[state.uart_rx_index];
+}
+
+// --------------------------------------------------
+
+// Read the next byte received
+//  @returns the byte or -1 if none [int]
+int HardwareSerial::read(void){
+  VespaSimState & state = _state();
+  if(state.uart_rx_index >= state.uart_rx.size()){
+    return -1;
+  }
+
+  int res = state.uart_rx[state.uart_rx_index++];
+  if(state.uart_rx_index == state.uart_rx.size()){
+    state.uart_rx.clear(); // release
+    state.uart_rx_index = 0;
+  }
+  return res;
+}
+
+// --------------------------------------------------
+
+// Write a byte
+//  @param (value) : the byte to write [uint8_t]
+//  @returns the number of bytes written [size_t]
+size_t HardwareSerial::write(uint8_t value){
+  return this->write(&value, 1);
+}
+
+// --------------------------------------------------
+
+// Write bytes
+//  @param (buffer) : the bytes to write [const uint8_t *]
+//         (size) : the number of bytes [size_t]
+//  @returns the number of bytes written [size_t]
+//  Note: blocks (the simulated clock advances) while the FIFO is full.
+size_t HardwareSerial::write(const uint8_t * buffer, size_t size){
+  VespaSimState & state = _state();
+  if(!state.uart_started){
+    return 0;
+  }
+
+  uint64_t byte_time = (10000000ULL + state.uart_baud - 1) / state.uart_baud; // [us] (10 bits per byte)
+  for(size_t i=0 ; i < size ; i++){
+    // wait for space in the FIFO
+    uint64_t limit = state.time + VESPA_SIM_UART_FIFO * byte_time;
+    if(state.uart_tx_end + byte_time > limit){
+      VespaSim::advance(state.uart_tx_end + byte_time - limit);
+    }
+    // queue the byte
+    if(state.uart_tx_end < state.time){
+      state.uart_tx_end = state.time;
+    }
+    state.uart_tx_end += byte_time;
+  }
+
+  fwrite(buffer, 1, size, stdout);
+  return size;
+}
+
+// --------------------------------------------------
+
+// Check if the UART is ready
+//  @returns true if started [bool]
+HardwareSerial::operator bool(void) const {
+  return _state().uart_started;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Apply a scheduled change of an input (called by <VespaSim::advance()>)
+//  @param (arg) : the change [VespaSimInputChange *]
+static void _inputChange(void *arg){
+  VespaSimInputChange & change = *(VespaSimInputChange *)arg;
+  change.timer.active = false; // one shot
+  VespaSim::setInput(change.pin, change.level);
+}
+
+// --------------------------------------------------
+
+// Get the timer of a LEDC channel
+//  @param (channel) : the LEDC channel (0-15) [uint8_t]
+//  @returns the index of the timer (0-7) [uint8_t]
+//  Note: like in the Arduino ESP package, each pair of channels of a group shares a timer.
+static uint8_t _ledcTimer(uint8_t channel){
+  return ((channel / 8) * 4) + ((channel / 2) % 4);
+}
+
+// --------------------------------------------------
+
+// Apply the next edge of a pulse generator (called by <VespaSim::advance()>)
+//  @param (arg) : the pulse generator [VespaSimPulses *]
+static void _pulseEdge(void *arg){
+  VespaSimPulses & pulses = *(VespaSimPulses *)arg;
+  uint64_t now = _state().time;
+
+  if(_state().input[pulses.pin] == LOW){
+    pulses.rise = now;
+    pulses.timer.next = now + pulses.width;
+    VespaSim::setInput(pulses.pin, HIGH);
+  } else {
+    pulses.timer.next = pulses.rise + pulses.period;
+    VespaSim::setInput(pulses.pin, LOW);
+  }
+}
+
+// --------------------------------------------------
+
+// Get the state of the simulator
+//  @returns the state [VespaSimState &]
+static VespaSimState & _state(void){
+  if(_sim == nullptr){
+    _sim = new VespaSimState();
+    VespaSim::reset();
+  }
+  return *_sim;
+}
+
+// --------------------------------------------------
+
+// Record a write to a peripheral
+//  @param (type) : the type of the event [uint8_t]
+//         (pin) : the pin [uint8_t]
+//         (channel) : the channel [uint8_t]
+//         (value) : the value written [uint32_t]
+static void _record(uint8_t type, uint8_t pin, uint8_t channel, uint32_t value){
+  VespaSimState & state = _state();
+  if(!state.recording || (state.events.size() >= VESPA_SIM_EVENTS_MAX)){
+    return;
+  }
+
+  VespaSimEvent event;
+  event.time = state.time;
+  event.type = type;
+  event.pin = pin;
+  event.channel = channel;
+  event.value = value;
+  state.events.push_back(event);
+}
+
+// --------------------------------------------------
+
+// Write the records to the file of the storage
+//  @returns true if successful or if there is no file [bool]
+//  Note: the records are written to a temporary file, which then replaces the
+//        previous one, so the file is never partial (as the NVS of the ESP32).
+static bool _writeStorage(void){
+  VespaSimState & state = _state();
+  if(state.storage_path.empty()){
+    return true;
+  }
+
+  std::string temporary = state.storage_path + ".tmp";
+  FILE *file = fopen(temporary.c_str(), "wb");
+  if(file == nullptr){
+    return false;
+  }
+
+  bool success = true;
+  for(const auto & record : state.storage){
+    uint8_t length = record.first.size();
+    uint32_t size = record.second.size();
+    success &= (fwrite(&length, 1, 1, file) == 1);
+    success &= (fwrite(record.first.data(), 1, length, file) == length);
+    success &= (fwrite(&size, sizeof(size), 1, file) == 1);
+    success &= (fwrite(record.second.data(), 1, size, file) == size);
+  }
+  success &= (fclose(file) == 0);
+
+  return success && (rename(temporary.c_str(), state.storage_path.c_str()) == 0);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
@@ -0,0 +1,487 @@
+/*******************************************************************************
+* RoboCore - Vespa Simulator (plant)
+* 
+* Physical model of a robot with the Vespa board (motors, battery and servos).
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+// --------------------------------------------------
+// Libraries
+
+#include "VespaPlant.h"
+
+#include <math.h>
+
+// --------------------------------------------------
+// Variables
+
+static const uint8_t _SERVO_PINS[VESPA_SERVO_QTY] = { VESPA_SERVO_S1, VESPA_SERVO_S2, VESPA_SERVO_S3, VESPA_SERVO_S4 };
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Constructor
+//  Note: the default parameters are of a small robot with two TT gear motors
+//        (deadband of about 20%), a 2S 1000 mAh LiPo battery (at 7.4 V), SG90 servos
+//        and slotted disk encoders (20 slots) on pins 36 and 39.
+VespaPlant::VespaPlant(void) :
+  _attached(false),
+  _log(nullptr),
+  _log_period(0),
+  _log_count(0)
+{
+  for(uint8_t i=0 ; i < 2 ; i++){
+    this->motors[i].resistance = 4.0;
+    this->motors[i].inductance = 0.002;
+    this->motors[i].constant = 0.25;
+    this->motors[i].inertia = 0.0002;
+    this->motors[i].damping = 0.0001;
+    this->motors[i].friction = 0.1;
+  }
+  this->encoders[VESPA_PLANT_LEFT].pin = VESPA_PLANT_ENCODER_LEFT_PIN;
+  this->encoders[VESPA_PLANT_RIGHT].pin = VESPA_PLANT_ENCODER_RIGHT_PIN;
+  for(uint8_t i=0 ; i < 2 ; i++){
+    this->encoders[i].resolution = 20;
+  }
+
+  this->battery.capacity = 1.0;
+  this->battery.resistance = 0.15;
+  this->battery.voltage_full = 8.4;
+  this->battery.voltage_empty = 6.4;
+  this->battery.charge = 0.5;
+  this->battery.idle_current = 0.05;
+
+  this->servo.speed = 600; // 0.1 s/60 degrees
+  this->servo.current_moving = 0.25;
+  this->servo.current_idle = 0.01;
+
+  this->robot.wheel_radius = 0.033;
+  this->robot.track = 0.13;
+
+  this->reset();
+}
+
+// --------------------------------------------------
+
+// Destructor
+VespaPlant::~VespaPlant(void){
+  this->detach();
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Start the model with the simulated clock
+void VespaPlant::attach(void){
+  VespaSim::setStep(VESPA_PLANT_STEP, VespaPlant::_step, this);
+  this->_attached = true;
+  this->_update(0); // update the ADC
+}
+
+// --------------------------------------------------
+
+// Stop the model
+void VespaPlant::detach(void){
+  if(this->_attached){
+    VespaSim::setStep(0, nullptr, nullptr);
+    this->_attached = false;
+  }
+}
+
+// --------------------------------------------------
+
+// Reset the state of the model (robot stopped at the origin)
+void VespaPlant::reset(void){
+  this->_charge = this->battery.charge;
+  this->_battery_current = 0;
+  this->_peak_current = 0;
+  this->_max_peak_current = 0;
+  this->_battery_voltage = this->battery.voltage_empty + this->_charge * (this->battery.voltage_full - this->battery.voltage_empty);
+  for(uint8_t i=0 ; i < 2 ; i++){
+    this->_current[i] = 0;
+    this->_speed[i] = 0;
+    this->_angle[i] = 0;
+  }
+  for(uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+    this->_servo_angle[i] = 90;
+  }
+  this->_x = 0;
+  this->_y = 0;
+  this->_heading = 0;
+  this->_log_count = 0;
+}
+
+// --------------------------------------------------
+
+// Write the state of the model in a CSV file
+//  @param (file) : the file, or null to stop [FILE *]
+//         (period) : the period between two lines [us] [uint32_t]
+void VespaPlant::setLog(FILE *file, uint32_t period){
+  this->_log = file;
+  this->_log_period = (period + VESPA_PLANT_STEP - 1) / VESPA_PLANT_STEP; // [steps]
+  if(this->_log_period == 0){
+    this->_log_period = 1;
+  }
+  this->_log_count = 0;
+
+  if(this->_log != nullptr){
+    fprintf(this->_log, "time_us,battery_v,battery_a,peak_a,charge,left_a,left_rad_s,right_a,right_rad_s,x_m,y_m,heading_rad");
+    for(uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+      fprintf(this->_log, ",servo%u_deg", i + 1);
+    }
+    fprintf(this->_log, "\n");
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Get the current of the battery
+//  @returns the current [A] [double]
+double VespaPlant::getBatteryCurrent(void){
+  return this->_battery_current;
+}
+
+// --------------------------------------------------
+
+// Get the voltage of the battery (with the sag)
+//  @returns the voltage [V] [double]
+double VespaPlant::getBatteryVoltage(void){
+  return this->_battery_voltage;
+}
+
+// --------------------------------------------------
+
+// Get the state of charge of the battery
+//  @returns the state of charge (0-1) [double]
+double VespaPlant::getCharge(void){
+  return this->_charge;
+}
+
+// --------------------------------------------------
+
+// Get the heading of the robot
+//  @returns the heading (counterclockwise) [rad] [double]
+double VespaPlant::getHeading(void){
+  return this->_heading;
+}
+
+// --------------------------------------------------
+
+// Get the current of a motor
+//  @param (side) : VESPA_PLANT_LEFT or VESPA_PLANT_RIGHT [uint8_t]
+//  @returns the current [A] [double]
+double VespaPlant::getMotorCurrent(uint8_t side){
+  return (side < 2) ? this->_current[side] : 0;
+}
+
+// --------------------------------------------------
+
+// Get the speed of a wheel
+//  @param (side) : VESPA_PLANT_LEFT or VESPA_PLANT_RIGHT [uint8_t]
+//  @returns the speed [rad/s] [double]
+double VespaPlant::getMotorSpeed(uint8_t side){
+  return (side < 2) ? this->_speed[side] : 0;
+}
+
+// --------------------------------------------------
+
+// Get the peak current of the battery
+//  @returns the maximum since the reset [A] [double]
+//  Note: the instantaneous current is the sum of the loads whose PWM output is high,
+//        so it depends on the phases of the channels (see <_peak()>).
+double VespaPlant::getPeakCurrent(void){
+  return this->_max_peak_current;
+}
+
+// --------------------------------------------------
+
+// Get the angle of a servo
+//  @param (index) : the index of the servo (0 = S1) [uint8_t]
+//  @returns the angle [degrees] [double]
+double VespaPlant::getServoAngle(uint8_t index){
+  return (index < VESPA_SERVO_QTY) ? this->_servo_angle[index] : 0;
+}
+
+// --------------------------------------------------
+
+// Get the position of the robot
+//  @returns the position in X [m] [double]
+double VespaPlant::getX(void){
+  return this->_x;
+}
+
+// --------------------------------------------------
+
+// Get the position of the robot
+//  @returns the position in Y [m] [double]
+double VespaPlant::getY(void){
+  return this->_y;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Step of the simulated clock
+//  @param (arg) : the plant [VespaPlant *]
+void VespaPlant::_step(void *arg){
+  ((VespaPlant *)arg)->_update(VESPA_PLANT_STEP * 1e-6);
+}
+
+// --------------------------------------------------
+
+// Calculate the peak of the current of the loads driven by PWM
+//  @param (channels) : the LEDC channel of each load [const uint8_t *]
+//         (currents) : the current of each load while its output is high [A] [const double *]
+//         (count) : the number of loads (up to VESPA_PLANT_LOADS) [uint8_t]
+//  @returns the peak current [A] [double]
+//  Note: each LEDC timer counts from the time it was configured, so the high phases are
+//        shifted by the start of their timer. The channels with the same frequency keep
+//        this offset, so the peak of each group is the maximum sum at the rising edges.
+//        The groups have independent periods, so they add up.
+//  Note: like the LEDC, an output stays high if (hpoint + duty) reaches the end of the period.
+double VespaPlant::_peak(const uint8_t *channels, const double *currents, uint8_t count){
+  double total = 0;
+  bool done[VESPA_PLANT_LOADS];
+  uint32_t frequency[VESPA_PLANT_LOADS];
+  double start[VESPA_PLANT_LOADS][2], end[VESPA_PLANT_LOADS][2]; // high phase (fraction of the period), split at the end of the period
+  for(uint8_t i=0 ; i < count ; i++){
+    frequency[i] = (channels[i] == VESPA_SIM_NONE) ? 0 : VespaSim::getFrequency(channels[i]);
+    done[i] = (frequency[i] == 0);
+    start[i][0] = end[i][0] = start[i][1] = end[i][1] = 0;
+    if(done[i]){
+      continue;
+    }
+    double period = (double)(1UL << VespaSim::getResolution(channels[i]));
+    uint32_t phase = VespaSim::getPhase(channels[i]);
+    uint32_t duty = VespaSim::getDuty(channels[i]);
+    if(duty == 0){
+      continue; // always low
+    }
+    double offset = (double)((VespaSim::getTimerStart(channels[i]) * frequency[i]) % 1000000) / 1e6; // start of the timer in its period
+    double high = ((phase + duty) >= period) ? (1.0 - phase / period) : (duty / period);
+    start[i][0] = fmod(offset + phase / period, 1.0);
+    end[i][0] = start[i][0] + high;
+    if(end[i][0] > 1.0){
+      end[i][1] = end[i][0] - 1.0;
+      end[i][0] = 1.0;
+    }
+  }
+
+  for(uint8_t i=0 ; i < count ; i++){
+    if(done[i]){
+      continue;
+    }
+
+    // peak of the group, at the rising edges
+    double peak = 0;
+    for(uint8_t j=i ; j < count ; j++){
+      if(done[j] || (frequency[j] != frequency[i])){
+        continue;
+      }
+      for(uint8_t p=0 ; p < 2 ; p++){
+        if(start[j][p] == end[j][p]){
+          continue;
+        }
+        double sum = 0;
+        for(uint8_t k=i ; k < count ; k++){
+          if(!done[k] && (frequency[k] == frequency[i]) &&
+              (((start[k][0] <= start[j][p]) && (start[j][p] < end[k][0])) || ((start[k][1] <= start[j][p]) && (start[j][p] < end[k][1])))){
+            sum += currents[k];
+          }
+        }
+        peak = (sum > peak) ? sum : peak;
+      }
+    }
+    total += peak;
+
+    for(uint8_t j=i ; j < count ; j++){
+      if(frequency[j] == frequency[i]){
+        done[j] = true;
+      }
+    }
+  }
+  return total;
+}
+
+// --------------------------------------------------
+
+// Integrate a motor
+//  @param (side) : the index of the motor [uint8_t]
+//         (voltage) : the average voltage applied [V] [double]
+//         (dt) : the step [s] [double]
+//  Note: the current is integrated exactly for a constant speed during the step
+//        (stable for any step), then the speed with the resulting torque.
+void VespaPlant::_stepMotor(uint8_t side, double voltage, double dt){
+  const VespaPlantMotor & motor = this->motors[side];
+  double & current = this->_current[side];
+  double & speed = this->_speed[side];
+
+  // electrical
+  double steady = (voltage - motor.constant * speed) / motor.resistance;
+  current = steady + (current - steady) * exp(-dt * motor.resistance / motor.inductance);
+
+  // mechanical
+  double torque = motor.constant * current - motor.damping * speed;
+  if((speed == 0) && (fabs(torque) <= motor.friction)){
+    return; // static friction
+  }
+  double direction = (speed != 0) ? ((speed > 0) ? 1.0 : -1.0) : ((torque > 0) ? 1.0 : -1.0);
+  double next = speed + (torque - direction * motor.friction) / motor.inertia * dt;
+  if((next * direction < 0) && (fabs(torque) <= motor.friction)){
+    next = 0; // stopped by the friction
+  }
+  speed = next;
+}
+
+// --------------------------------------------------
+
+// Move a servo towards the angle of its pulse width
+//  @param (index) : the index of the servo [uint8_t]
+//         (pin) : the pin of the servo [uint8_t]
+//         (dt) : the step [s] [double]
+//  @returns the current of the servo [A] [double]
+double VespaPlant::_stepServo(uint8_t index, uint8_t pin, double dt){
+  uint8_t channel = VespaSim::getPinChannel(pin);
+  if(channel == VESPA_SIM_NONE){
+    return 0; // not connected
+  }
+  uint32_t frequency = VespaSim::getFrequency(channel);
+  if(frequency == 0){
+    return 0;
+  }
+
+  // pulse width to angle (the servo ignores invalid pulses)
+  double pulse_width = VespaSim::getOutput(pin) * 1e6 / frequency; // [us]
+  if((pulse_width < VESPA_SERVO_PULSE_WIDTH_MIN - 100) || (pulse_width > VESPA_SERVO_PULSE_WIDTH_MAX + 100)){
+    return this->servo.current_idle;
+  }
+  double target = (pulse_width - VESPA_SERVO_PULSE_WIDTH_MIN) * 180 / (VESPA_SERVO_PULSE_WIDTH_MAX - VESPA_SERVO_PULSE_WIDTH_MIN);
+  target = (target < 0) ? 0 : ((target > 180) ? 180 : target);
+
+  // limited speed
+  double & angle = this->_servo_angle[index];
+  double step = this->servo.speed * dt;
+  if(fabs(target - angle) <= step){
+    bool moving = (angle != target);
+    angle = target;
+    return moving ? this->servo.current_moving : this->servo.current_idle;
+  }
+  angle += (target > angle) ? step : -step;
+  return this->servo.current_moving;
+}
+
+// --------------------------------------------------
+
+// Update the model
+//  @param (dt) : the step [s] [double]
+void VespaPlant::_update(double dt){
+  // battery voltage with the current of the previous step
+  double open_voltage = this->battery.voltage_empty + this->_charge * (this->battery.voltage_full - this->battery.voltage_empty);
+  this->_battery_voltage = open_voltage - this->_battery_current * this->battery.resistance;
+  if(this->_battery_voltage < 0){
+    this->_battery_voltage = 0;
+  }
+  uint32_t millivolts = (uint32_t)(this->_battery_voltage * 1000 * 1000 / VESPA_BATTERY_VOLTAGE_CONVERSION);
+  VespaSim::setMilliVolts(VESPA_BATTERY_PIN, millivolts);
+
+  if(dt <= 0){
+    return;
+  }
+
+  // loads driven by PWM, for the peak current
+  uint8_t channels[VESPA_PLANT_LOADS];
+  double currents[VESPA_PLANT_LOADS];
+
+  // motors (average voltage of the H-bridge, braking when both inputs are low)
+  double current = this->battery.idle_current;
+  const uint8_t pins[2][2] = { { VespaBoard::MOTORS_PIN_A1, VespaBoard::MOTORS_PIN_A2 }, { VespaBoard::MOTORS_PIN_B1, VespaBoard::MOTORS_PIN_B2 } };
+  for(uint8_t side=0 ; side < 2 ; side++){
+    double duty = VespaSim::getOutput(pins[side][0]) - VespaSim::getOutput(pins[side][1]);
+    this->_stepMotor(side, duty * this->_battery_voltage, dt);
+    current += duty * this->_current[side]; // negative when braking with regeneration
+
+    channels[side] = VespaSim::getPinChannel(pins[side][0]);
+    if(channels[side] == VESPA_SIM_NONE){
+      channels[side] = VespaSim::getPinChannel(pins[side][1]);
+    }
+    currents[side] = fabs(this->_current[side]);
+  }
+
+  // servos (analog servos drive their motor after each pulse)
+  for(uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+    double servo_current = this->_stepServo(i, _SERVO_PINS[i], dt);
+    current += servo_current;
+
+    channels[2 + i] = VespaSim::getPinChannel(_SERVO_PINS[i]);
+    currents[2 + i] = servo_current;
+  }
+
+  // peak current
+  this->_peak_current = this->battery.idle_current + this->_peak(channels, currents, VESPA_PLANT_LOADS);
+  if(this->_peak_current > this->_max_peak_current){
+    this->_max_peak_current = this->_peak_current;
+  }
+
+  // battery
+  this->_battery_current = current;
+  this->_charge -= current * dt / (3600 * this->battery.capacity);
+  this->_charge = (this->_charge < 0) ? 0 : ((this->_charge > 1) ? 1 : this->_charge);
+
+  // encoders
+  for(uint8_t side=0 ; side < 2 ; side++){
+    this->_angle[side] += this->_speed[side] * dt;
+    const VespaPlantEncoder & encoder = this->encoders[side];
+    if(encoder.pin != VESPA_SIM_NONE){
+      int64_t edges = (int64_t)floor(this->_angle[side] * encoder.resolution / M_PI); // 2 edges per period
+      VespaSim::setInput(encoder.pin, (edges & 0x01) ? HIGH : LOW);
+    }
+  }
+
+  // pose of the robot
+  double linear = this->robot.wheel_radius * (this->_speed[VESPA_PLANT_LEFT] + this->_speed[VESPA_PLANT_RIGHT]) / 2;
+  double angular = this->robot.wheel_radius * (this->_speed[VESPA_PLANT_RIGHT] - this->_speed[VESPA_PLANT_LEFT]) / this->robot.track;
+  this->_x += linear * cos(this->_heading) * dt;
+  this->_y += linear * sin(this->_heading) * dt;
+  this->_heading += angular * dt;
+
+  // log
+  if((this->_log != nullptr) && (++this->_log_count >= this->_log_period)){
+    this->_log_count = 0;
+    this->_writeLog();
+  }
+}
+
+// --------------------------------------------------
+
+// Write the state in the log
+void VespaPlant::_writeLog(void){
+  fprintf(this->_log, "%llu,%.4f,%.4f,%.4f,%.6f,%.4f,%.3f,%.4f,%.3f,%.5f,%.5f,%.5f",
+    (unsigned long long)VespaSim::now(), this->_battery_voltage, this->_battery_current, this->_peak_current, this->_charge,
+    this->_current[VESPA_PLANT_LEFT], this->_speed[VESPA_PLANT_LEFT],
+    this->_current[VESPA_PLANT_RIGHT], this->_speed[VESPA_PLANT_RIGHT],
+    this->_x, this->_y, this->_heading);
+  for(uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+    fprintf(this->_log, ",%.2f", this->_servo_angle[i]);
+  }
+  fprintf(this->_log, "\n");
+}
+
+// --------------------------------------------------
@@ -0,0 +1,141 @@
+#ifndef VESPA_PLANT_H
+#define VESPA_PLANT_H
+
+/*******************************************************************************
+* RoboCore - Vespa Simulator (plant)
+* 
+* Physical model of a robot with the Vespa board (motors, battery and servos).
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+// --------------------------------------------------
+// Libraries
+
+#include "VespaSim.h"
+
+// --------------------------------------------------
+// Macros
+
+#define VESPA_PLANT_LEFT (0)
+#define VESPA_PLANT_RIGHT (1)
+#define VESPA_PLANT_STEP (50) // [us]
+#define VESPA_PLANT_LOADS (2 + VESPA_SERVO_QTY) // driven by PWM
+#define VESPA_PLANT_ENCODER_LEFT_PIN (36)
+#define VESPA_PLANT_ENCODER_RIGHT_PIN (39)
+
+// --------------------------------------------------
+// Structures
+
+// DC motor with gearbox (values at the output shaft)
+struct VespaPlantMotor {
+  double resistance; // [ohm]
+  double inductance; // [H]
+  double constant; // torque and back-EMF constant [N.m/A] or [V.s/rad]
+  double inertia; // with the wheel and the share of the robot [kg.m^2]
+  double damping; // viscous friction [N.m.s/rad]
+  double friction; // Coulomb friction [N.m]
+};
+
+// Battery (2S LiPo by default)
+struct VespaPlantBattery {
+  double capacity; // [Ah]
+  double resistance; // internal resistance [ohm]
+  double voltage_full; // open circuit voltage when charged [V]
+  double voltage_empty; // open circuit voltage when discharged [V]
+  double charge; // initial state of charge (0-1)
+  double idle_current; // current of the board [A]
+};
+
+// Hobby servo
+struct VespaPlantServo {
+  double speed; // maximum speed [degrees/s]
+  double current_moving; // [A]
+  double current_idle; // [A]
+};
+
+// Differential drive robot
+struct VespaPlantEncoder {
+  uint8_t pin; // input pin of the square wave, VESPA_SIM_NONE if disabled
+  uint16_t resolution; // periods per revolution of the wheel
+};
+
+struct VespaPlantRobot {
+  double wheel_radius; // [m]
+  double track; // distance between the wheels [m]
+};
+
+// --------------------------------------------------
+// Class - Vespa Plant
+
+// Model of the robot, stepped by the simulated clock (see <VespaSim::setStep()>).
+//  Note: the motors are driven by the outputs of the pins of <VespaBoard> and the
+//        battery voltage, which sags with the current and feeds the ADC of the
+//        battery. The servos follow the pulse width of the pins S1-S4 with a
+//        limited speed. The steps are fixed, so the results are deterministic.
+class VespaPlant {
+  public:
+    VespaPlant(void);
+    ~VespaPlant(void);
+    void attach(void);
+    void detach(void);
+    void reset(void);
+    void setLog(FILE *, uint32_t);
+
+    // state
+    double getBatteryCurrent(void);
+    double getBatteryVoltage(void);
+    double getCharge(void);
+    double getHeading(void);
+    double getMotorCurrent(uint8_t);
+    double getMotorSpeed(uint8_t);
+    double getPeakCurrent(void);
+    double getServoAngle(uint8_t);
+    double getX(void);
+    double getY(void);
+
+    // parameters (change before <attach()> or <reset()>)
+    VespaPlantMotor motors[2];
+    VespaPlantEncoder encoders[2];
+    VespaPlantBattery battery;
+    VespaPlantServo servo;
+    VespaPlantRobot robot;
+
+  private:
+    bool _attached;
+    double _battery_current, _battery_voltage, _charge;
+    double _peak_current, _max_peak_current; // [A]
+    double _current[2], _speed[2], _angle[2]; // [A], [rad/s] and [rad]
+    double _servo_angle[VESPA_SERVO_QTY]; // [degrees]
+    double _x, _y, _heading; // [m] and [rad]
+
+    FILE *_log;
+    uint32_t _log_period, _log_count; // [steps]
+
+    static void _step(void *);
+    double _peak(const uint8_t *, const double *, uint8_t);
+    void _stepMotor(uint8_t, double, double);
+    double _stepServo(uint8_t, uint8_t, double);
+    void _update(double);
+    void _writeLog(void);
+};
+
+// --------------------------------------------------
+
+#endif // VESPA_PLANT_H
@@ -0,0 +1,120 @@
+#ifndef VESPA_SIM_H
+#define VESPA_SIM_H
+
+/*******************************************************************************
+* RoboCore - Vespa Simulator
+* 
+* Simulated peripherals of the Vespa board (Linux backend of the HAL).
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+#include <stdio.h>
+#include <vector>
+
+// --------------------------------------------------
+// Macros
+
+#define VESPA_SIM_PIN_QTY (40)
+#define VESPA_SIM_CHANNEL_QTY (16)
+#define VESPA_SIM_NONE (0xFF)
+
+// --------------------------------------------------
+// Enumerators
+
+enum VespaSimEventType : uint8_t {
+  SIM_PIN_MODE = 0,
+  SIM_DIGITAL_WRITE,
+  SIM_ADC_ATTENUATION,
+  SIM_LEDC_ATTACH,
+  SIM_LEDC_DETACH,
+  SIM_LEDC_CONNECT,
+  SIM_LEDC_DISCONNECT,
+  SIM_LEDC_WRITE,
+  SIM_LEDC_PHASE,
+  SIM_SLEEP,
+  SIM_WAKEUP,
+  SIM_STORAGE_WRITE
+};
+
+// --------------------------------------------------
+// Structures
+
+// Write to a peripheral, recorded by the simulator
+struct VespaSimEvent {
+  uint64_t time; // [us]
+  uint8_t type; // see <VespaSimEventType>
+  uint8_t pin; // VESPA_SIM_NONE if not applicable
+  uint8_t channel; // VESPA_SIM_NONE if not applicable
+  uint32_t value; // mode, level, attenuation, frequency, duty, phase, sleep time, wake-up source or size
+};
+
+// --------------------------------------------------
+// Class - Vespa Simulator
+
+class VespaSim {
+  public:
+    static void reset(void);
+
+    // clock
+    static void advance(uint64_t);
+    static uint64_t now(void);
+    static void setStep(uint32_t, void (*)(void *), void *);
+
+    // GPIO
+    static void attachInterrupt(uint8_t, void (*)(void), uint8_t);
+    static uint8_t getLevel(uint8_t);
+    static uint8_t getMode(uint8_t);
+    static void setInput(uint8_t, uint8_t);
+    static bool setInputAt(uint8_t, uint8_t, uint64_t);
+    static void setPulses(uint8_t, uint32_t, uint32_t = 20000);
+
+    // ADC
+    static void setMilliVolts(uint8_t, uint32_t);
+
+    // LEDC
+    static uint32_t getDuty(uint8_t);
+    static uint32_t getFrequency(uint8_t);
+    static float getOutput(uint8_t);
+    static uint32_t getPhase(uint8_t);
+    static uint8_t getPinChannel(uint8_t);
+    static uint8_t getResolution(uint8_t);
+    static uint64_t getTimerStart(uint8_t);
+
+    // storage
+    static bool setStorageFile(const char *);
+
+    // UART
+    static void serialInject(const uint8_t *, size_t);
+
+    // recorded events
+    static void clearEvents(void);
+    static const std::vector<VespaSimEvent> & events(void);
+    static void setRecording(bool);
+    static void writeEvents(FILE *);
+};
+
+// --------------------------------------------------
+
+#endif // VESPA_SIM_H
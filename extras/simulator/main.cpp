@@ -0,0 +1,192 @@
+/*******************************************************************************
+* RoboCore - Vespa Simulator (main)
+* 
+* Run an Arduino sketch with the simulated Vespa board.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+// Usage: <sketch> [--duration <ms>] [--loop-period <us>] [--events <file.csv>] [--serial <file>]
+//                 [--plant] [--plant-log <file.csv>] [--pulses <pin>:<width>[:<stop>]]
+//                 [--button <press>[:<release>]] [--storage <file>] [--motor-fault <motor>:<fault>]
+//  --duration : simulated time to run (default: 10000 ms)
+//  --loop-period : simulated time of each call to <loop()> (default: 100 us)
+//  --events : file to write the peripheral writes (CSV)
+//  --serial : file with the bytes received by <Serial> (available after <setup()>)
+//  --plant : simulate the robot (motors, battery and servos, see <VespaPlant>)
+//  --plant-log : file to write the state of the robot every 1 ms (CSV), implies --plant
+//  --pulses : pulses of a RC receiver on a pin, with the width [us] and the time to stop them [ms]
+//             (default: never), can be repeated (see <VespaSim::setPulses()>)
+//  --button : time to press and to release the button [ms] (default: never released)
+//  --storage : file of the non-volatile storage (e.g. <VespaConfig>), kept between the runs
+//  --motor-fault : fault of a motor of the robot, "left" or "right" and "open" (disconnected)
+//                  or "stall" (blocked), implies --plant, can be repeated
+
+// --------------------------------------------------
+// Libraries
+
+#include "VespaPlant.h"
+#include "VespaSim.h"
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+int main(int argc, char *argv[]){
+  uint64_t duration = 10000; // [ms]
+  uint64_t loop_period = 100; // [us]
+  const char *events_path = nullptr;
+  const char *serial_path = nullptr;
+  const char *plant_path = nullptr;
+  bool plant_enabled = false;
+  struct {
+    unsigned int pin;
+    unsigned int width; // [us]
+    unsigned long stop; // [ms]
+  } pulses[VESPA_SIM_PIN_QTY];
+  uint8_t pulses_count = 0;
+  unsigned long button_press = 0; // [ms]
+  unsigned long button_release = 0; // [ms]
+  bool motor_open[2] = { false, false };
+  bool motor_stall[2] = { false, false };
+  char fault_motor[8], fault_type[8];
+
+  // parse the arguments
+  for(int i=1 ; i < argc ; i++){
+    if((strcmp(argv[i], "--duration") == 0) && (i + 1 < argc)){
+      duration = strtoull(argv[++i], nullptr, 10);
+    } else if((strcmp(argv[i], "--loop-period") == 0) && (i + 1 < argc)){
+      loop_period = strtoull(argv[++i], nullptr, 10);
+    } else if((strcmp(argv[i], "--events") == 0) && (i + 1 < argc)){
+      events_path = argv[++i];
+    } else if((strcmp(argv[i], "--serial") == 0) && (i + 1 < argc)){
+      serial_path = argv[++i];
+    } else if(strcmp(argv[i], "--plant") == 0){
+      plant_enabled = true;
+    } else if((strcmp(argv[i], "--plant-log") == 0) && (i + 1 < argc)){
+      plant_path = argv[++i];
+      plant_enabled = true;
+    } else if((strcmp(argv[i], "--pulses") == 0) && (i + 1 < argc) && (pulses_count < VESPA_SIM_PIN_QTY) &&
+        (sscanf(argv[i + 1], "%u:%u", &pulses[pulses_count].pin, &pulses[pulses_count].width) == 2)){
+      pulses[pulses_count].stop = 0;
+      sscanf(argv[++i], "%*u:%*u:%lu", &pulses[pulses_count].stop);
+      pulses_count++;
+    } else if((strcmp(argv[i], "--button") == 0) && (i + 1 < argc) &&
+        (sscanf(argv[i + 1], "%lu", &button_press) == 1)){
+      sscanf(argv[++i], "%*u:%lu", &button_release);
+      VespaSim::setInputAt(VESPA_BUTTON_PIN, LOW, button_press * 1000); // active low
+      if(button_release > button_press){
+        VespaSim::setInputAt(VESPA_BUTTON_PIN, HIGH, button_release * 1000);
+      }
+    } else if((strcmp(argv[i], "--storage") == 0) && (i + 1 < argc)){
+      if(!VespaSim::setStorageFile(argv[++i])){
+        fprintf(stderr, "Invalid storage <%s>\n", argv[i]);
+        return 1;
+      }
+    } else if((strcmp(argv[i], "--motor-fault") == 0) && (i + 1 < argc) &&
+        (sscanf(argv[i + 1], "%7[a-z]:%7[a-z]", fault_motor, fault_type) == 2) &&
+        ((strcmp(fault_motor, "left") == 0) || (strcmp(fault_motor, "right") == 0)) &&
+        ((strcmp(fault_type, "open") == 0) || (strcmp(fault_type, "stall") == 0))){
+      uint8_t side = (strcmp(fault_motor, "left") == 0) ? VESPA_PLANT_LEFT : VESPA_PLANT_RIGHT;
+      motor_open[side] |= (strcmp(fault_type, "open") == 0);
+      motor_stall[side] |= (strcmp(fault_type, "stall") == 0);
+      plant_enabled = true;
+      i++;
+    } else {
+      fprintf(stderr, "Usage: %s [--duration <ms>] [--loop-period <us>] [--events <file.csv>] [--serial <file>] [--plant] [--plant-log <file.csv>] [--pulses <pin>:<width>[:<stop>]] [--button <press>[:<release>]] [--storage <file>] [--motor-fault <motor>:<fault>]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  // simulate the robot
+  VespaPlant plant;
+  FILE *plant_file = nullptr;
+  if(plant_enabled){
+    for(uint8_t side=0 ; side < 2 ; side++){
+      if(motor_open[side]){
+        plant.motors[side].resistance = 1e9; // no current
+      }
+      if(motor_stall[side]){
+        plant.motors[side].friction = 1e3; // never moves
+      }
+    }
+    if(plant_path != nullptr){
+      plant_file = fopen(plant_path, "w");
+      if(plant_file == nullptr){
+        fprintf(stderr, "Could not open <%s>\n", plant_path);
+        return 1;
+      }
+      plant.setLog(plant_file, 1000); // [us]
+    }
+    plant.attach();
+  }
+
+  // generate the pulses
+  for(uint8_t i=0 ; i < pulses_count ; i++){
+    VespaSim::setPulses(pulses[i].pin, pulses[i].width);
+  }
+
+  // run the sketch
+  setup();
+  if(serial_path != nullptr){
+    FILE *file = fopen(serial_path, "rb");
+    if(file == nullptr){
+      fprintf(stderr, "Could not open <%s>\n", serial_path);
+      return 1;
+    }
+    uint8_t buffer[256];
+    size_t size;
+    while((size = fread(buffer, 1, sizeof(buffer), file)) > 0){
+      VespaSim::serialInject(buffer, size);
+    }
+    fclose(file);
+  }
+  while(VespaSim::now() < duration * 1000){
+    loop();
+    VespaSim::advance(loop_period);
+    for(uint8_t i=0 ; i < pulses_count ; i++){
+      if((pulses[i].stop > 0) && (VespaSim::now() >= pulses[i].stop * 1000)){
+        VespaSim::setPulses(pulses[i].pin, 0);
+        pulses[i].stop = 0;
+      }
+    }
+  }
+  fflush(stdout);
+  if(plant_enabled){
+    fprintf(stderr, "Peak current: %.3f A\n", plant.getPeakCurrent());
+  }
+  plant.detach();
+  if(plant_file != nullptr){
+    fclose(plant_file);
+  }
+
+  // write the events
+  if(events_path != nullptr){
+    FILE *file = fopen(events_path, "w");
+    if(file == nullptr){
+      fprintf(stderr, "Could not open <%s>\n", events_path);
+      return 1;
+    }
+    VespaSim::writeEvents(file);
+    fclose(file);
+  }
+
+  return 0;
+}
+
+// --------------------------------------------------
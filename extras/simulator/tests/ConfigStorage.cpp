@@ -0,0 +1,136 @@
+/*******************************************************************************
+* RoboCore - Vespa Simulator (test of the configuration)
+* 
+* The record of the configuration is validated on load and written at once.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+
+// A record with a byte corrupted or of another version falls back to the
+// defaults. A saved record is read back by <begin()>, also from the file of
+// the storage, and a write interrupted before the rename of the file keeps the
+// previous record.
+
+// --------------------------------------------------
+// Libraries
+
+#include "VespaTest.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+
+// --------------------------------------------------
+// Variables
+
+static const char *STORAGE_FILE = "ConfigStorage.bin";
+static const uint32_t CONVERSION = 3300; // Vin/Vout (x1000)
+
+// --------------------------------------------------
+
+// Read the stored record
+//  @param (data) : the record read [VespaConfigData &]
+//  @returns true if successful [bool]
+static bool readRecord(VespaConfigData &data){
+  return VespaHAL::storageRead(VESPA_CONFIG_KEY, &data, sizeof(data));
+}
+
+// --------------------------------------------------
+
+// Read the configuration with a new object
+//  @param (conversion) : the conversion of the battery read [uint32_t &]
+//  @returns true if the record was loaded, false if the defaults are used [bool]
+static bool load(uint32_t &conversion){
+  VespaConfig config;
+  bool loaded = config.loaded();
+  conversion = config.get().battery_conversion;
+  return loaded;
+}
+
+// --------------------------------------------------
+
+int main(void){
+  uint32_t conversion;
+  remove(STORAGE_FILE);
+  VESPA_CHECK(VespaSim::setStorageFile(STORAGE_FILE));
+
+  // not saved yet
+  VESPA_CHECK(!load(conversion) && (conversion == VESPA_BATTERY_VOLTAGE_CONVERSION));
+
+  // round trip
+  {
+    VespaConfig config;
+    config.setBatteryConversion(CONVERSION);
+    VESPA_CHECK(config.setServoLimits(1, 600, 2400));
+    VESPA_CHECK(config.save());
+  }
+  VESPA_CHECK(load(conversion) && (conversion == CONVERSION));
+  {
+    VespaConfig config;
+    VESPA_CHECK(config.loaded());
+    VESPA_CHECK((config.get().servo_min[1] == 600) && (config.get().servo_max[1] == 2400));
+  }
+  VespaConfigData saved;
+  VESPA_CHECK(readRecord(saved));
+
+  // from the file
+  VESPA_CHECK(VespaSim::setStorageFile(STORAGE_FILE));
+  VESPA_CHECK(load(conversion) && (conversion == CONVERSION));
+
+  // write interrupted before the rename (the previous record is kept)
+  FILE *file = fopen((std::string(STORAGE_FILE) + ".tmp").c_str(), "wb");
+  VESPA_CHECK(file != nullptr);
+  fputs("partial", file);
+  fclose(file);
+  VESPA_CHECK(VespaSim::setStorageFile(STORAGE_FILE));
+  VESPA_CHECK(load(conversion) && (conversion == CONVERSION));
+
+  // byte corrupted
+  VespaConfigData data = saved;
+  reinterpret_cast<uint8_t *>(&data)[offsetof(VespaConfigData, battery_conversion)] ^= 0x01;
+  VESPA_CHECK(VespaHAL::storageWrite(VESPA_CONFIG_KEY, &data, sizeof(data)));
+  VESPA_CHECK(!load(conversion) && (conversion == VESPA_BATTERY_VOLTAGE_CONVERSION));
+
+  // other version (with a valid CRC)
+  data = saved;
+  data.version++;
+  data.crc = VespaCodec::crc16(reinterpret_cast<const uint8_t *>(&data), offsetof(VespaConfigData, crc));
+  VESPA_CHECK(VespaHAL::storageWrite(VESPA_CONFIG_KEY, &data, sizeof(data)));
+  VESPA_CHECK(!load(conversion) && (conversion == VESPA_BATTERY_VOLTAGE_CONVERSION));
+
+  // other size (with a valid CRC)
+  data = saved;
+  data.size--;
+  data.crc = VespaCodec::crc16(reinterpret_cast<const uint8_t *>(&data), offsetof(VespaConfigData, crc));
+  VESPA_CHECK(VespaHAL::storageWrite(VESPA_CONFIG_KEY, &data, sizeof(data)));
+  VESPA_CHECK(!load(conversion) && (conversion == VESPA_BATTERY_VOLTAGE_CONVERSION));
+
+  // the saved record is valid again
+  VESPA_CHECK(VespaHAL::storageWrite(VESPA_CONFIG_KEY, &saved, sizeof(saved)));
+  VESPA_CHECK(load(conversion) && (conversion == CONVERSION));
+
+  remove(STORAGE_FILE);
+  remove((std::string(STORAGE_FILE) + ".tmp").c_str());
+  return 0;
+}
+
+// --------------------------------------------------
@@ -0,0 +1,78 @@
+/*******************************************************************************
+* RoboCore - Vespa Simulator (test of the calibration)
+* 
+* The duty cycles reported during the calibration are the ones written.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+
+// <calibrate()> calls the function that reads the encoders while each duty
+// cycle is applied. There, <getDutyLeft()> and <getDutyRight()> (used by the
+// telemetry) must report the duty cycle of the LEDC channels.
+
+// --------------------------------------------------
+// Libraries
+
+#include "VespaTest.h"
+
+#include <algorithm>
+
+// --------------------------------------------------
+// Variables
+
+static VespaMotors motors;
+static uint32_t mismatches = 0;
+static uint32_t readings = 0;
+static int32_t position = 0;
+
+// --------------------------------------------------
+
+// Read the position of a motor (and compare the duty cycles)
+//  @param (motor) : VespaMotors::LEFT or VespaMotors::RIGHT [uint8_t]
+//         (context) : not used [void *]
+//  @returns a position that increases with the duty cycle [int32_t]
+static int32_t readPosition(uint8_t motor, void *){
+  const uint32_t max_duty = (1UL << VespaBoard::MOTORS_PWM_RESOLUTION) - 1; // "full on" is written as max + 1
+  uint32_t left = std::min(VespaSim::getDuty(VespaBoard::MOTORS_CHANNEL_A), max_duty);
+  uint32_t right = std::min(VespaSim::getDuty(VespaBoard::MOTORS_CHANNEL_B), max_duty);
+  if((motors.getDutyLeft() != (int32_t)left) || (motors.getDutyRight() != (int32_t)right)){
+    mismatches++;
+  }
+  readings++;
+
+  position += (motor == VespaMotors::LEFT) ? left : right;
+  return position;
+}
+
+// --------------------------------------------------
+
+int main(void){
+  VespaMotorsCalibration calibration;
+  VESPA_CHECK(motors.calibrate(calibration, readPosition, nullptr, 10));
+  VESPA_CHECK(readings == 4 * VESPA_MOTORS_CALIBRATION_STEPS);
+  VESPA_CHECK(mismatches == 0);
+  VESPA_CHECK((motors.getDutyLeft() == 0) && (motors.getDutyRight() == 0)); // stopped at the end
+
+  return 0;
+}
+
+// --------------------------------------------------
@@ -0,0 +1,97 @@
+/*******************************************************************************
+* RoboCore - Vespa Simulator (test of the power management)
+* 
+* The decision of light sleep with the PWM outputs on and off, by clock.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+
+// <sleepUntil()> only enters light sleep when every LEDC channel with a duty
+// cycle is clocked by RC_FAST (the motors and the servos), with the same rule as
+// the ESP32: a channel counts from the duty cycle written until it is detached
+// or written with 0, even if no pin is routed to it.
+
+// --------------------------------------------------
+// Libraries
+
+#include "VespaTest.h"
+
+// --------------------------------------------------
+// Variables
+
+static const uint32_t TICK = 20000; // [us]
+static const VespaPowerMode OUTPUTS = VESPA_PWM_SLEEP_CLOCK ? POWER_LIGHT_SLEEP : POWER_IDLE; // with the motors or the servos
+
+static VespaPower power;
+static VespaMotors motors;
+static VespaServo servo;
+
+// --------------------------------------------------
+
+// Wait for the next tick
+//  @returns the mode used [VespaPowerMode]
+static VespaPowerMode waitTick(void){
+  return power.sleepUntil(VespaHAL::micros() + TICK);
+}
+
+// --------------------------------------------------
+
+int main(void){
+  // no outputs
+  VESPA_CHECK(waitTick() == POWER_LIGHT_SLEEP);
+
+  // servo (clocked by RC_FAST)
+  VESPA_CHECK(servo.attach(VESPA_SERVO_S1));
+  VESPA_CHECK(VespaHAL::ledcGetChannel(VESPA_SERVO_S1) == VESPA_SERVO_CHANNEL_FIRST);
+  VESPA_CHECK(VespaHAL::ledcActive());
+  VESPA_CHECK(waitTick() == OUTPUTS);
+
+  // motors (clocked by RC_FAST)
+  motors.forward(50);
+  VESPA_CHECK(waitTick() == OUTPUTS);
+  motors.stop();
+  servo.detach();
+  VESPA_CHECK(!VespaHAL::ledcActive());
+  VESPA_CHECK(waitTick() == POWER_LIGHT_SLEEP);
+
+  // channel clocked by the APB, with a duty cycle but no pin routed
+  VESPA_CHECK(VespaHAL::ledcAttach(VESPA_SERVO_S2, 1000, 10));
+  uint8_t channel = VespaHAL::ledcGetChannel(VESPA_SERVO_S2);
+  VespaHAL::ledcWriteChannel(channel, 512);
+  VespaHAL::ledcDisconnect(VESPA_SERVO_S2);
+  VESPA_CHECK(waitTick() == POWER_IDLE);
+
+  // the servo and the motors don't change it
+  VESPA_CHECK(servo.attach(VESPA_SERVO_S1));
+  motors.forward(50);
+  VESPA_CHECK(waitTick() == POWER_IDLE);
+  motors.stop();
+  servo.detach();
+
+  // without a duty cycle
+  VespaHAL::ledcWriteChannel(channel, 0);
+  VESPA_CHECK(waitTick() == POWER_LIGHT_SLEEP);
+
+  return 0;
+}
+
+// --------------------------------------------------
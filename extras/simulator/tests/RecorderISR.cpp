@@ -0,0 +1,104 @@
+/*******************************************************************************
+* RoboCore - Vespa Simulator (test of the recorder)
+* 
+* A call from an interrupt is recorded while the task is inside the same object.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+
+// The task enters a recorded method of the motors and, while inside it, the
+// deadman timer calls <stopFromISR()> on the same object. Both calls must be
+// in the log, as on the robot, but not the call nested in the task.
+// The scopes are created directly (as by <VESPA_RECORD()>), so the test
+// doesn't depend on <VESPA_RECORD_ENABLED>.
+
+// --------------------------------------------------
+// Libraries
+
+#include "VespaTest.h"
+
+// --------------------------------------------------
+// Variables
+
+static VespaMotors motors;
+
+// --------------------------------------------------
+
+// Deadman (interrupt)
+static void expire(void *){
+  VespaRecordScope scope(&motors, TRACE_MOTORS_STOP_ISR, 0, true);
+}
+
+// --------------------------------------------------
+
+// Read the events of a log
+//  @param (buffer) : the entries [const uint8_t *]
+//         (size) : the size of the entries [size_t]
+//         (events) : the events read [uint8_t *]
+//  @returns the number of events [uint8_t]
+static uint8_t readEvents(const uint8_t *buffer, size_t size, uint8_t *events){
+  uint8_t count = 0;
+  size_t position = 0;
+  while(position < size){
+    while(buffer[position++] & 0x80); // time
+    events[count++] = buffer[position++];
+    position++; // object
+    while(buffer[position++] & 0x80); // argument
+  }
+  return count;
+}
+
+// --------------------------------------------------
+
+int main(void){
+  uint8_t buffer[256];
+  VespaRecorder recorder(buffer, sizeof(buffer));
+  VESPA_CHECK(recorder.attach(motors));
+  recorder.start();
+
+  void *timer = VespaHAL::timerStart(1000, expire, nullptr);
+  VESPA_CHECK(timer != nullptr);
+  {
+    VespaRecordScope scope(&motors, TRACE_MOTORS_TURN, 50, true); // task
+    {
+      VespaRecordScope nested(&motors, TRACE_MOTORS_SET_SPEED_LEFT, 50, true); // called by <turn()>
+    }
+    VespaSim::advance(1500); // the timer interrupts the task
+  }
+  VespaHAL::timerStop(timer);
+  {
+    VespaRecordScope scope(&motors, TRACE_MOTORS_STOP, 0, true); // the task is not muted
+  }
+  recorder.stop();
+
+  uint8_t events[16];
+  uint8_t count = readEvents(buffer, recorder.getSize(), events);
+  VESPA_CHECK(count == 3);
+  VESPA_CHECK(events[0] == TRACE_MOTORS_TURN);
+  VESPA_CHECK(events[1] == TRACE_MOTORS_STOP_ISR);
+  VESPA_CHECK(events[2] == TRACE_MOTORS_STOP);
+  VESPA_CHECK(recorder.getDropped() == 0);
+
+  return 0;
+}
+
+// --------------------------------------------------
@@ -0,0 +1,150 @@
+/*******************************************************************************
+* RoboCore - Vespa Simulator (test of the self-test)
+* 
+* The health of the motors found by the self-test, with faults of the plant.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+
+// The plant models the sag of the battery and the encoders, so each verdict of
+// <VespaSelfTest> is reproduced with a fault of the left or right motor:
+//  - healthy: OK;
+//  - very high resistance (disconnected): DISCONNECTED;
+//  - very high friction (blocked): STALLED, with and without the encoders;
+//  - very high friction only while running backward: DEGRADED.
+
+// --------------------------------------------------
+// Libraries
+
+#include "VespaTest.h"
+#include "VespaPlant.h"
+
+// --------------------------------------------------
+// Variables
+
+static const double BLOCKED = 1e3; // friction that never moves [N.m]
+static const uint32_t DURATION = 440; // expected duration of the test [ms]
+static const uint32_t DURATION_TOLERANCE = 20; // [ms]
+
+static VespaMotors motors;
+static VespaBattery battery;
+static VespaSelfTest self_test(motors, battery);
+static VespaPlant plant;
+static VespaPlantMotor healthy;
+
+static volatile int32_t encoder_left = 0;
+static volatile int32_t encoder_right = 0;
+static uint8_t weak_side = VESPA_SIM_NONE; // blocked backward
+static uint8_t reads[2];
+
+// --------------------------------------------------
+
+// Count the edges of the encoders
+static void countLeft(void){
+  encoder_left = encoder_left + 1;
+}
+
+static void countRight(void){
+  encoder_right = encoder_right + 1;
+}
+
+// --------------------------------------------------
+
+// Read the count of an encoder
+//  @param (motor) : VespaMotors::LEFT or VespaMotors::RIGHT [uint8_t]
+//         (context) : not used [void *]
+//  @returns the count of the encoder [int32_t]
+//  Note: called before and after each pulse, so the third call is before the pulse backward.
+static int32_t readEncoder(uint8_t motor, void *){
+  if((motor == weak_side) && (++reads[motor] == 3)){
+    plant.motors[motor].friction = BLOCKED;
+  }
+  return (motor == VespaMotors::LEFT) ? encoder_left : encoder_right;
+}
+
+// --------------------------------------------------
+
+// Run the self-test with a fault
+//  @param (side) : the motor with the fault, or VESPA_SIM_NONE [uint8_t]
+//         (resistance) : the resistance of the motor [ohm] [double]
+//         (friction) : the friction of the motor [N.m] [double]
+//         (report) : the result [VespaSelfTestReport &]
+static void run(uint8_t side, double resistance, double friction, VespaSelfTestReport &report){
+  plant.motors[VESPA_PLANT_LEFT] = healthy;
+  plant.motors[VESPA_PLANT_RIGHT] = healthy;
+  if(side != VESPA_SIM_NONE){
+    plant.motors[side].resistance = resistance;
+    plant.motors[side].friction = friction;
+  }
+  plant.reset();
+  reads[0] = reads[1] = 0;
+
+  self_test.run(report);
+  VespaSelfTest::print(report, Serial);
+  VespaSim::advance(100000); // the motors stop
+}
+
+// --------------------------------------------------
+
+int main(void){
+  Vespa::begin();
+  Serial.begin(115200);
+  healthy = plant.motors[VESPA_PLANT_LEFT];
+  plant.attach();
+
+  attachInterrupt(digitalPinToInterrupt(VESPA_PLANT_ENCODER_LEFT_PIN), countLeft, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(VESPA_PLANT_ENCODER_RIGHT_PIN), countRight, CHANGE);
+  self_test.setEncoders(readEncoder);
+
+  VespaSelfTestReport report;
+
+  // healthy
+  run(VESPA_SIM_NONE, 0, 0, report);
+  VESPA_CHECK(self_test.passed());
+  VESPA_CHECK((report.health[VespaMotors::LEFT] == HEALTH_OK) && (report.health[VespaMotors::RIGHT] == HEALTH_OK));
+  VESPA_CHECK((report.duration + DURATION_TOLERANCE >= DURATION) && (report.duration <= DURATION + DURATION_TOLERANCE));
+
+  // disconnected
+  run(VESPA_PLANT_LEFT, 1e9, healthy.friction, report);
+  VESPA_CHECK(!self_test.passed());
+  VESPA_CHECK((report.health[VespaMotors::LEFT] == HEALTH_DISCONNECTED) && (report.health[VespaMotors::RIGHT] == HEALTH_OK));
+
+  // stalled
+  run(VESPA_PLANT_RIGHT, healthy.resistance, BLOCKED, report);
+  VESPA_CHECK((report.health[VespaMotors::LEFT] == HEALTH_OK) && (report.health[VespaMotors::RIGHT] == HEALTH_STALLED));
+
+  // stalled, without the encoders (by the current)
+  self_test.setEncoders(nullptr);
+  run(VESPA_PLANT_RIGHT, healthy.resistance, BLOCKED, report);
+  VESPA_CHECK((report.health[VespaMotors::LEFT] == HEALTH_OK) && (report.health[VespaMotors::RIGHT] == HEALTH_STALLED));
+  self_test.setEncoders(readEncoder);
+
+  // one weak direction
+  weak_side = VESPA_PLANT_LEFT;
+  run(VESPA_SIM_NONE, 0, 0, report);
+  VESPA_CHECK(!self_test.passed());
+  VESPA_CHECK((report.health[VespaMotors::LEFT] == HEALTH_DEGRADED) && (report.health[VespaMotors::RIGHT] == HEALTH_OK));
+
+  return 0;
+}
+
+// --------------------------------------------------
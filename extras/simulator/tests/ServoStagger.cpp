@@ -0,0 +1,126 @@
+/*******************************************************************************
+* RoboCore - Vespa Simulator (test of the plant)
+* 
+* The peak current of the servos, with the pulses staggered and in phase.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+
+// The servos are staggered by their LEDC channel. Each pair of channels shares
+// a timer, while the timers of the pairs start when they are configured. The
+// peak current of the plant must follow the timer of each channel: with the
+// pairs attached at different times, the pulses in phase only add up by pair.
+// With the motors running, the pulse of the right motor is aligned to the end
+// of the period, so the combined peak is also lower than with all in phase.
+// Without <VESPA_PWM_STAGGER>, the test is skipped.
+
+// --------------------------------------------------
+// Libraries
+
+#include "VespaTest.h"
+#include "VespaPlant.h"
+
+// --------------------------------------------------
+// Variables
+
+static const uint8_t SERVO_PINS[VESPA_SERVO_QTY] = { VESPA_SERVO_S1, VESPA_SERVO_S2, VESPA_SERVO_S3, VESPA_SERVO_S4 };
+static const uint16_t ANGLE = 10; // short pulses [degrees]
+static const int8_t SPEED = 40; // both pulses fit in the period [%]
+
+static VespaMotors motors;
+static VespaServo servos[VESPA_SERVO_QTY];
+static VespaPlant plant;
+
+// --------------------------------------------------
+
+// Measure the peak current while the servos move from the center
+//  @param (in_phase) : true to align the pulses of all the channels [bool]
+//         (speed) : the speed of the motors, started with the servos [int8_t]
+//  @returns the peak current [A] [double]
+static double measure(bool in_phase, int8_t speed = 0){
+  motors.forward(speed);
+  if(in_phase){
+    VespaHAL::ledcSetPhase(VespaBoard::MOTORS_CHANNEL_B, 0); // kept until the next write
+  }
+  for(uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+    if(in_phase){
+      VespaHAL::ledcSetPhase(VespaHAL::ledcGetChannel(SERVO_PINS[i]), 0);
+    }
+    servos[i].write(ANGLE);
+  }
+  plant.reset(); // the servos move from 90 degrees and the motors start stopped
+  VespaSim::advance(50000);
+  return plant.getPeakCurrent();
+}
+
+// --------------------------------------------------
+
+// Attach the servos
+//  @param (delay) : the time between the pairs of servos [us] [uint32_t]
+static void attachServos(uint32_t delay){
+  for(uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+    servos[i].detach();
+  }
+  for(uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+    if(i == 2){
+      VespaSim::advance(delay); // start the timer of the second pair later
+    }
+    servos[i].attach(SERVO_PINS[i]);
+  }
+}
+
+// --------------------------------------------------
+
+int main(void){
+  if(!VESPA_PWM_STAGGER){
+    return VESPA_TEST_SKIP;
+  }
+  plant.attach();
+
+  // timers started together
+  attachServos(0);
+  double staggered = measure(false);
+  double in_phase = measure(true);
+  VESPA_CHECK(staggered < in_phase);
+
+  // timers with an offset (3 ms)
+  attachServos(3000);
+  double staggered_offset = measure(false);
+  double in_phase_offset = measure(true);
+  VESPA_CHECK(staggered_offset < in_phase_offset);
+  VESPA_CHECK(in_phase_offset < in_phase); // only the pulses of each pair are aligned
+
+  // motors running with the servos
+  attachServos(0);
+  double staggered_motors = measure(false, SPEED);
+  uint32_t period = 1UL << VespaSim::getResolution(VespaBoard::MOTORS_CHANNEL_B);
+  VESPA_CHECK(VespaSim::getPhase(VespaBoard::MOTORS_CHANNEL_A) == 0);
+  VESPA_CHECK((VespaSim::getPhase(VespaBoard::MOTORS_CHANNEL_B) + VespaSim::getDuty(VespaBoard::MOTORS_CHANNEL_B)) == (period - 1)); // aligned to the end
+  double in_phase_motors = measure(true, SPEED);
+  VESPA_CHECK(staggered_motors > staggered); // the motors add to the peak
+  VESPA_CHECK(staggered_motors < in_phase_motors);
+  VESPA_CHECK((in_phase_motors - in_phase) > (staggered_motors - staggered)); // the pulses of the motors don't overlap
+
+  return 0;
+}
+
+// --------------------------------------------------
@@ -0,0 +1,50 @@
+/*******************************************************************************
+* RoboCore - Vespa Simulator (tests)
+* 
+* Checks used by the tests of the library, with the simulated board.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+#ifndef VESPA_TEST_H
+#define VESPA_TEST_H
+
+// --------------------------------------------------
+// Libraries
+
+#include "VespaSim.h"
+
+// --------------------------------------------------
+// Macros
+
+// Return code of a test that doesn't apply to the configuration (see <SKIP_RETURN_CODE>)
+#define VESPA_TEST_SKIP (77)
+
+// Fail the test (return 1 from <main()>) if the condition is false
+#define VESPA_CHECK(condition) do { \
+    if(!(condition)){ \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      return 1; \
+    } \
+  } while(0)
+
+// --------------------------------------------------
+
+#endif // VESPA_TEST_H
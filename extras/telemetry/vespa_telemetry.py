@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+# RoboCore - Vespa Telemetry Decoder
+#
+# Decode the records sent by <VespaTelemetry> and print them as CSV.
+#
+#   python3 vespa_telemetry.py telemetry.bin
+#   python3 vespa_telemetry.py /dev/ttyUSB0 --baud 115200   (requires pyserial)
+#
+# This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+# Licensed under the GNU Lesser General Public License v3 or later.
+
+import argparse
+import struct
+import sys
+
+RECORD_TYPE = 0x01
+SERVO_QTY = 4
+RECORD = struct.Struct('<BHIBhhH%dH' % SERVO_QTY)
+
+
+def crc16(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def decode_cobs(frame):
+    output = bytearray()
+    index = 0
+    while index < len(frame):
+        code = frame[index]
+        if code == 0 or index + code > len(frame) + 1:
+            raise ValueError('invalid COBS frame')
+        output += frame[index + 1:index + code]
+        index += code
+        if code < 0xFF and index < len(frame):
+            output.append(0)
+    return bytes(output)
+
+
+def records(stream):
+    buffer = bytearray()
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            return
+        buffer += chunk
+        while 0 in buffer:
+            end = buffer.index(0)
+            frame, buffer = bytes(buffer[:end]), buffer[end + 1:]
+            try:
+                data = decode_cobs(frame)
+            except ValueError:
+                yield None
+                continue
+            if len(data) != RECORD.size + 2 or crc16(data[:-2]) != struct.unpack('<H', data[-2:])[0]:
+                yield None
+                continue
+            yield RECORD.unpack(data[:-2])
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode the Vespa telemetry')
+    parser.add_argument('source', help='file, serial port or "-" for stdin')
+    parser.add_argument('--baud', type=int, help='baud rate of the serial port')
+    args = parser.parse_args()
+
+    if args.baud:
+        import serial
+        stream = serial.Serial(args.source, args.baud)
+    elif args.source == '-':
+        stream = sys.stdin.buffer
+    else:
+        stream = open(args.source, 'rb')
+
+    print('sequence,time_ms,duty_left,duty_right,battery_mv,button,' +
+          ','.join('servo%d_us' % (i + 1) for i in range(SERVO_QTY)))
+    errors = 0
+    for record in records(stream):
+        if record is None or record[0] != RECORD_TYPE:
+            errors += 1
+            continue
+        _, sequence, time, flags, left, right, voltage = record[:7]
+        button = (flags >> 3) & 0x01 if flags & 0x04 else ''
+        print('%d,%d,%d,%d,%d,%s,%s' % (sequence, time, left, right, voltage, button,
+                                         ','.join(str(value) for value in record[7:])))
+    if errors:
+        print('%d invalid frames' % errors, file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
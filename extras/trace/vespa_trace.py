@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+# RoboCore - Vespa Trace Decoder
+#
+# Decode the binary trace written by <VespaTrace::dump()> and print the
+# execution time of each method (from the entry to the exit events).
+#
+#   python3 vespa_trace.py trace.bin           # statistics per method
+#   python3 vespa_trace.py trace.bin --events  # all the events
+#
+# This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+# Licensed under the GNU Lesser General Public License v3 or later.
+
+import argparse
+import struct
+import sys
+
+EXIT = 0x80
+
+EVENTS = {
+    0x10: 'battery.readCapacity', 0x11: 'battery.readVoltage', 0x12: 'battery.setBatteryType',
+    0x13: 'battery.onCritical',
+    0x14: 'battery.setConversion',
+    0x20: 'button.pressed', 0x21: 'button.setActiveMode', 0x22: 'button.setDebounce',
+    0x23: 'button.onChange',
+    0x30: 'led.blink', 0x31: 'led.on', 0x32: 'led.off', 0x33: 'led.toggle', 0x34: 'led.update',
+    0x40: 'motors.backward', 0x41: 'motors.forward', 0x42: 'motors.setSpeedLeft',
+    0x43: 'motors.setSpeedRight', 0x44: 'motors.stop', 0x45: 'motors.turn',
+    0x46: 'motors.applyPending', 0x47: 'motors.post', 0x48: 'motors.postLeft',
+    0x49: 'motors.postRight', 0x4A: 'motors.postStop', 0x4B: 'motors.setSpeedLeftFromISR',
+    0x4C: 'motors.setSpeedRightFromISR', 0x4D: 'motors.stopFromISR', 0x4E: 'motors.turnFromISR',
+    0x4F: 'motors.setCalibration',
+    0x50: 'servo.attach', 0x51: 'servo.detach', 0x52: 'servo.write',
+    0x53: 'servo.writeFromISR', 0x54: 'servo.applyPending', 0x55: 'servo.post',
+}
+
+
+def parse(data):
+    start = data.find(b'VTRC')  # skip any text printed before the trace
+    if start < 0:
+        raise ValueError('no trace found')
+    offset = start + 4
+    version, cores, size, cycles_per_us = struct.unpack_from('<BBHI', data, offset)
+    offset += 8
+    if version != 1:
+        raise ValueError('unknown version %d' % version)
+    blocks = []
+    for _ in range(cores):
+        core, count, total = struct.unpack_from('<BHI', data, offset)
+        offset += 7
+        entries = []
+        for _ in range(count):
+            entries.append(struct.unpack_from('<IIB', data, offset))
+            offset += 9
+        blocks.append((core, total, entries))
+    return cycles_per_us, blocks
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode a Vespa trace')
+    parser.add_argument('file', help='binary trace (or "-" for stdin)')
+    parser.add_argument('--events', action='store_true', help='print all the events')
+    args = parser.parse_args()
+
+    data = sys.stdin.buffer.read() if args.file == '-' else open(args.file, 'rb').read()
+    cycles_per_us, blocks = parse(data)
+
+    for core, total, entries in blocks:
+        print('core %d: %d entries (%d lost)' % (core, len(entries), total - len(entries)))
+        stack = []
+        durations = {}
+        for cycles, argument, event in entries:
+            name = EVENTS.get(event & ~EXIT, '0x%02X' % (event & ~EXIT))
+            if args.events:
+                print('  %10u %s %-28s %u' % (cycles, '<' if event & EXIT else '>', name, argument))
+            if not event & EXIT:
+                stack.append((event, cycles))
+                continue
+            # match the exit with its entry (the calls are nested)
+            while stack and stack[-1][0] != (event & ~EXIT):
+                stack.pop()
+            if stack:
+                _, begin = stack.pop()
+                durations.setdefault(name, []).append(((cycles - begin) & 0xFFFFFFFF) / cycles_per_us)
+
+        print('  %-28s %7s %9s %9s %9s' % ('method', 'calls', 'p50 [us]', 'p99 [us]', 'max [us]'))
+        for name, values in sorted(durations.items()):
+            values.sort()
+            print('  %-28s %7d %9.2f %9.2f %9.2f' % (name, len(values), values[len(values) // 2],
+                                                     values[len(values) * 99 // 100], values[-1]))
+
+
+if __name__ == '__main__':
+    main()
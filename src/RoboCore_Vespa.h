@@ -25,7 +25,7 @@
 * along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
 *******************************************************************************/
 
-#if !defined(ARDUINO_ESP32_DEV) // ESP32
+#if !defined(ARDUINO_ESP32_DEV) && !defined(VESPA_HAL_LINUX) // ESP32 or simulator (see <extras/simulator>)
 #error Use this library with the ESP32
 #endif
 
@@ -39,12 +39,15 @@ extern "C" {
   #include <stdint.h>
   #include <stdlib.h>
 
+#if defined(ARDUINO_ESP32_DEV)
   #include <esp_arduino_version.h>
 
   #include <esp32-hal-adc.h>
-  #include <esp32-hal-ledc.h>
+#endif
 }
 
+#include <atomic>
+
 #ifdef ESP_ARDUINO_VERSION_MAJOR
 #if ESP_ARDUINO_VERSION_MAJOR < 3
 #warning RoboCore Vespa v1.3 is meant to use the Arduino ESP package v3.0+
@@ -58,16 +61,35 @@ extern "C" {
 #define VESPA_VERSION_MINOR 3 // (x.X.x)
 #define VESPA_VERSION_PATCH 0 // (x.x.X)
 
+#define VESPA_BEGIN_OBJECTS (16) // drivers initialized by <Vespa::begin()>
+
 #define VESPA_BATTERY_ADC_ATTENUATION (ADC_11db)
 #define VESPA_BATTERY_PIN (34)
-#define VESPA_BATTERY_VOLTAGE_CONVERSION (5702) // Vin = Vout * (R1+R2)/R2
+#define VESPA_BATTERY_VOLTAGE_CONVERSION (5702) // Vin = Vout * (R1+R2)/R2 (default, see <VespaConfig>)
 
+#define VESPA_BUTTON_DEBOUNCE (20) // [ms]
 #define VESPA_BUTTON_PIN (35)
 
 #define VESPA_LED_PIN (15)
 
 #define VESPA_MOTORS_CHANNEL_A (14)
 #define VESPA_MOTORS_CHANNEL_B (15)
+#define VESPA_MOTORS_CALIBRATION_POINTS (11) // 0, 10, ..., 100 [%]
+#define VESPA_MOTORS_CALIBRATION_STEPS (50) // duty cycles measured by <calibrate()>
+
+// stagger the phases of the PWM channels that share a timer, so that their
+// high phases (and inrush currents) don't start at the same time
+#ifndef VESPA_PWM_STAGGER
+  #define VESPA_PWM_STAGGER (1)
+#endif
+
+// clock the PWM channels of the motors and of the servos from RC_FAST, so that
+// they keep running in light sleep (see <VespaHAL::ledcAttachSleep()>)
+#ifndef VESPA_PWM_SLEEP_CLOCK
+  #define VESPA_PWM_SLEEP_CLOCK (1)
+#endif
+
+#define VESPA_SERVO_CHANNEL_FIRST (8) // S1-S4 on 8-11 (low speed group of the LEDC)
 
 #define VESPA_SERVO_PULSE_WIDTH_MAX (2500) // [us]
 #define VESPA_SERVO_PULSE_WIDTH_MIN (500) // [us]
@@ -79,6 +101,64 @@ extern "C" {
 #define VESPA_SERVO_S3 (33)
 #define VESPA_SERVO_S4 (32)
 
+#define VESPA_COMMANDS_BUFFER_SIZE (32) // [bytes] (largest encoded frame)
+#define VESPA_COMMANDS_TIMEOUT (500) // [ms] (deadman)
+#define VESPA_COMMANDS_TIMEOUT_MAX (4294967) // [ms] (the timeout is kept in [us] in 32 bits)
+
+#define VESPA_CONFIG_KEY "config" // name of the record in the storage
+#define VESPA_CONFIG_VERSION (1) // layout of <VespaConfigData> (increment when changed)
+
+#ifndef VESPA_EVENTS_QUEUE_SIZE
+  #define VESPA_EVENTS_QUEUE_SIZE (16) // [events] (power of 2)
+#endif
+
+#define VESPA_RC_INPUT_CHANNELS (8) // RMT channels of the ESP32
+#define VESPA_RC_INPUT_DEADBAND (25) // around the neutral [us]
+#define VESPA_RC_INPUT_NEUTRAL (1500) // [us]
+#define VESPA_RC_INPUT_RANGE (500) // from the neutral to the full stick [us]
+#define VESPA_RC_INPUT_TIMEOUT (100) // [ms] (signal loss)
+#define VESPA_RC_INPUT_WIDTH_MAX (2200) // longer pulses are discarded [us]
+#define VESPA_RC_INPUT_WIDTH_MIN (800) // shorter pulses are discarded [us]
+
+#define VESPA_POWER_NONE (0xFF) // no wake-up pin
+#define VESPA_POWER_SLEEP_MIN (2000) // shorter waits don't enter light sleep [us]
+#define VESPA_POWER_WAKEUP_TIME (1000) // from a wake-up source to the code running [us]
+
+#define VESPA_RECORDER_CONTEXTS (2 * VESPA_TRACE_CORES) // task and interrupts of each core
+#define VESPA_RECORDER_OBJECTS (8) // objects attached to a recorder or a replay
+
+#define VESPA_SELF_TEST_BALANCE (50) // weakest direction relative to the strongest, below is degraded [%]
+#define VESPA_SELF_TEST_DIP_MIN (20) // battery dip of a connected motor [mV]
+#define VESPA_SELF_TEST_DIP_STALL (70) // battery dip of a stalled motor, without encoders [mV]
+#define VESPA_SELF_TEST_PAUSE (40) // between the pulses [ms]
+#define VESPA_SELF_TEST_PULSE (60) // duration of each direction [ms]
+#define VESPA_SELF_TEST_SAMPLES (8) // readings of the battery, 1 ms apart
+#define VESPA_SELF_TEST_SPEED (60) // [%]
+
+#define VESPA_TELEMETRY_PERIOD (10) // [ms] (100 Hz)
+
+// tracing (enabled with <VESPA_TRACE_ENABLED> in the build flags)
+#define VESPA_TRACE_CORES (2)
+#ifndef VESPA_TRACE_SIZE
+#define VESPA_TRACE_SIZE (256) // entries per core (power of 2)
+#endif
+#define VESPA_TRACE_EXIT (0x80) // flag added to the event when the method returns
+
+#if defined(VESPA_TRACE_ENABLED)
+#define VESPA_TRACE(event, argument) VespaTraceScope _vespa_trace_scope((event), (uint32_t)(argument))
+#else
+#define VESPA_TRACE(event, argument) ((void)0)
+#endif
+
+// recording of the actuator calls (enabled with <VESPA_RECORD_ENABLED> in the build flags)
+#if defined(VESPA_RECORD_ENABLED)
+#define VESPA_RECORD(event, argument) VespaRecordScope _vespa_record_scope(this, (event), (uint32_t)(argument), true)
+#define VESPA_RECORD_MUTE() VespaRecordScope _vespa_record_scope(this, 0, 0, false)
+#else
+#define VESPA_RECORD(event, argument) ((void)0)
+#define VESPA_RECORD_MUTE() ((void)0)
+#endif
+
 // --------------------------------------------------
 // Enumerators
 
@@ -87,6 +167,383 @@ enum BatteryType : uint8_t {
   BATTERY_LIPO
 };
 
+// Commands received by <VespaCommands> (the replies have the same type + <COMMAND_REPLY>)
+enum VespaCommand : uint8_t {
+  COMMAND_PING = 0x01,
+  COMMAND_MOTORS = 0x10, // left (int8_t) | right (int8_t)
+  COMMAND_MOTORS_STOP = 0x11,
+  COMMAND_SERVO = 0x20, // index (uint8_t) | value (uint16_t) [degrees or us]
+  COMMAND_LED = 0x30, // mode (uint8_t) | blink period (uint16_t) [ms]
+  COMMAND_BATTERY = 0x40, // reply: voltage (uint16_t) [mV] | capacity (uint8_t) [%]
+  COMMAND_REPLY = 0x80
+};
+
+// Modes of the LED in <COMMAND_LED>
+enum VespaCommandLED : uint8_t {
+  COMMAND_LED_OFF = 0,
+  COMMAND_LED_ON,
+  COMMAND_LED_BLINK
+};
+
+// Order of the initialization in <Vespa::begin()>
+enum VespaBeginOrder : uint8_t {
+  BEGIN_CONFIG = 0, // loaded before the drivers are initialized
+  BEGIN_OUTPUTS, // first, so the H-bridge and the LED are driven as soon as possible
+  BEGIN_INPUTS
+};
+
+// Modes chosen by <VespaPower::sleepUntil()>
+enum VespaPowerMode : uint8_t {
+  POWER_ACTIVE = 0, // the deadline is now (or an event is pending)
+  POWER_IDLE, // the CPU waits with the peripherals clocked (PWM outputs running)
+  POWER_LIGHT_SLEEP
+};
+
+// Health of a motor in <VespaSelfTest>
+enum VespaMotorHealth : uint8_t {
+  HEALTH_OK = 0,
+  HEALTH_DISCONNECTED, // no current in both directions (wiring or motor open)
+  HEALTH_STALLED, // current without movement (blocked or shorted)
+  HEALTH_DEGRADED // a direction without current, or much weaker than the other
+};
+
+// Sources of the wake-up from light sleep
+enum VespaWakeup : uint8_t {
+  WAKEUP_NONE = 0,
+  WAKEUP_TIMER,
+  WAKEUP_UART,
+  WAKEUP_GPIO
+};
+
+// Events recorded by the trace (the high nibble identifies the class)
+enum VespaTraceEvent : uint8_t {
+  TRACE_BATTERY_READ_CAPACITY = 0x10,
+  TRACE_BATTERY_READ_VOLTAGE,
+  TRACE_BATTERY_SET_TYPE,
+  TRACE_BATTERY_ON_CRITICAL,
+  TRACE_BATTERY_SET_CONVERSION,
+
+  TRACE_BUTTON_PRESSED = 0x20,
+  TRACE_BUTTON_SET_ACTIVE_MODE,
+  TRACE_BUTTON_SET_DEBOUNCE,
+  TRACE_BUTTON_ON_CHANGE,
+
+  TRACE_LED_BLINK = 0x30,
+  TRACE_LED_ON,
+  TRACE_LED_OFF,
+  TRACE_LED_TOGGLE,
+  TRACE_LED_UPDATE,
+
+  TRACE_MOTORS_BACKWARD = 0x40,
+  TRACE_MOTORS_FORWARD,
+  TRACE_MOTORS_SET_SPEED_LEFT,
+  TRACE_MOTORS_SET_SPEED_RIGHT,
+  TRACE_MOTORS_STOP,
+  TRACE_MOTORS_TURN,
+  TRACE_MOTORS_APPLY_PENDING,
+  TRACE_MOTORS_POST,
+  TRACE_MOTORS_POST_LEFT,
+  TRACE_MOTORS_POST_RIGHT,
+  TRACE_MOTORS_POST_STOP,
+  TRACE_MOTORS_SET_SPEED_LEFT_ISR,
+  TRACE_MOTORS_SET_SPEED_RIGHT_ISR,
+  TRACE_MOTORS_STOP_ISR,
+  TRACE_MOTORS_TURN_ISR,
+  TRACE_MOTORS_SET_CALIBRATION,
+
+  TRACE_SERVO_ATTACH = 0x50,
+  TRACE_SERVO_DETACH,
+  TRACE_SERVO_WRITE,
+  TRACE_SERVO_WRITE_ISR,
+  TRACE_SERVO_APPLY_PENDING,
+  TRACE_SERVO_POST
+};
+
+// --------------------------------------------------
+// Structures
+
+// Setpoint of the motors posted to the mailbox
+struct VespaMotorsSetpoint {
+  int8_t left, right; // [%]
+};
+
+// Calibration of the motors
+//  The duty cycle of each motor (0-10000 = 0-100.00%) at the speeds 0, 10, ..., 100 [%],
+//  interpolated linearly. A speed of 0 always stops the motor, so the first point is
+//  the duty cycle of the smallest speed (above the deadband).
+struct VespaMotorsCalibration {
+  uint16_t left[VESPA_MOTORS_CALIBRATION_POINTS];
+  uint16_t right[VESPA_MOTORS_CALIBRATION_POINTS];
+};
+
+// Configuration stored in the flash (see <VespaConfig>)
+//  Note: the record is read and written as is, so the members are ordered to
+//        have no padding. The CRC is the last member.
+struct VespaConfigData {
+  uint16_t version; // <VESPA_CONFIG_VERSION>
+  uint16_t size; // [bytes]
+  uint32_t battery_conversion; // Vin/Vout (x1000)
+  uint16_t button_debounce; // [ms]
+  uint16_t servo_min[VESPA_SERVO_QTY]; // [us]
+  uint16_t servo_max[VESPA_SERVO_QTY]; // [us]
+  VespaMotorsCalibration motors;
+  uint16_t crc; // CRC-16/CCITT-FALSE of the other members
+};
+
+// Result of <VespaSelfTest::run()>
+//  Note: the indexes are the motor (<VespaMotors::LEFT> or <VespaMotors::RIGHT>)
+//        and the direction (0 = forward, 1 = backward).
+struct VespaSelfTestReport {
+  uint16_t voltage; // battery at rest [mV]
+  uint16_t dip[2][2]; // drop of the battery voltage with the motor running [mV]
+  int32_t counts[2][2]; // movement measured by the encoders (0 without encoders)
+  uint8_t health[2]; // see <VespaMotorHealth>
+  uint16_t duration; // [ms]
+};
+
+// --------------------------------------------------
+// Boards
+
+// Pinout and PWM configuration of the Vespa board
+//  Note: to use the drivers with a board derived from the Vespa, create a
+//        structure with the same members and use it as the template argument
+//        (e.g. <VespaMotorsT<MyBoard>>).
+struct VespaBoard {
+  // motors
+  constexpr static uint8_t MOTORS_PIN_A1 = 13;
+  constexpr static uint8_t MOTORS_PIN_A2 = 14;
+  constexpr static uint8_t MOTORS_PIN_B1 = 27;
+  constexpr static uint8_t MOTORS_PIN_B2 = 4;
+  constexpr static uint8_t MOTORS_CHANNEL_A = VESPA_MOTORS_CHANNEL_A;
+  constexpr static uint8_t MOTORS_CHANNEL_B = VESPA_MOTORS_CHANNEL_B;
+  constexpr static uint32_t MOTORS_PWM_FREQUENCY = 5000; // [Hz]
+  constexpr static uint8_t MOTORS_PWM_RESOLUTION = 10; // [bits]
+
+  // servos
+  constexpr static uint8_t SERVO_PINS[] = { 25, 26, 32, 33, 5, 16, 17, 18, 19, 21, 22, 23 }; // available pins
+  constexpr static uint8_t SERVO_CHANNEL_FIRST = VESPA_SERVO_CHANNEL_FIRST; // one channel per slot
+  constexpr static uint32_t SERVO_PWM_FREQUENCY = 50; // [Hz] (20 ms)
+  constexpr static uint8_t SERVO_PWM_RESOLUTION = 10; // [bits]
+};
+
+// --------------------------------------------------
+// Class - Vespa HAL
+
+// Hardware abstraction layer used by all the classes of the library.
+//  Note: the ESP32 backend is in <VespaHAL_ESP32.cpp>. The Linux backend (simulator)
+//        is in <extras/simulator> and is selected with <VESPA_HAL_LINUX>.
+class VespaHAL {
+  public:
+    // ADC
+    static void analogSetPinAttenuation(uint8_t, adc_attenuation_t);
+    static uint32_t analogReadMilliVolts(uint8_t);
+
+    // GPIO
+    static int digitalRead(uint8_t);
+    static void digitalWrite(uint8_t, uint8_t);
+    static void pinMode(uint8_t, uint8_t);
+
+    // LEDC (driver)
+    static bool ledcAttach(uint8_t, uint32_t, uint8_t);
+    static bool ledcAttachChannel(uint8_t, uint32_t, uint8_t, uint8_t);
+    static bool ledcAttachSleep(uint8_t, uint32_t, uint8_t, uint8_t);
+    static bool ledcDetach(uint8_t);
+    static uint8_t ledcGetChannel(uint8_t);
+    static bool ledcActive(void);
+    static bool ledcCanSleep(void);
+
+    // LEDC (direct access, in IRAM and with a bounded execution time)
+    static void ledcConnect(uint8_t, uint8_t);
+    static void ledcDisconnect(uint8_t);
+    static void ledcSetPhase(uint8_t, uint32_t);
+    static void ledcWriteChannel(uint8_t, uint32_t);
+
+    // system
+    static uint8_t coreID(void);
+    static bool inInterrupt(void);
+    static VespaWakeup lightSleep(uint32_t, uint8_t, bool);
+
+    // pulse capture (the callback is called from an interrupt with the width of each high pulse [us])
+    static void * captureStart(uint8_t, void (*)(void *, uint32_t), void *);
+    static void captureStop(void *);
+
+    // storage (non-volatile, each record is written atomically)
+    static bool storageRead(const char *, void *, size_t);
+    static bool storageWrite(const char *, const void *, size_t);
+
+    // timers (periodic, the callback is called from an interrupt)
+    static void * timerStart(uint32_t, void (*)(void *), void *);
+    static uint32_t timerNext(void);
+    static void timerStop(void *);
+
+    // time
+    static uint32_t cycles(void);
+    static uint32_t cyclesPerMicrosecond(void);
+    static void delay(uint32_t);
+    static uint32_t micros(void);
+    static uint32_t millis(void);
+};
+
+// --------------------------------------------------
+// Class - Vespa
+
+// Initialization of all the drivers of the board in a batch
+//  Note: the constructors of the drivers don't access the hardware, so the global
+//        objects are safe to create before the Arduino core is ready. Each driver
+//        is added here when created, and <begin()> initializes all of them at
+//        once. The drivers not initialized are initialized on their first use.
+class Vespa {
+  public:
+    static bool add(void *, bool (*)(void *), uint8_t);
+    static bool begin(void);
+    static void remove(void *);
+
+  private:
+    struct Entry {
+      void *object;
+      bool (*begin)(void *);
+      uint8_t order; // see <VespaBeginOrder>
+    };
+
+    static Entry _entries[VESPA_BEGIN_OBJECTS];
+    static uint8_t _count;
+};
+
+// --------------------------------------------------
+// Class - Vespa Mailbox
+
+// Single-producer/single-consumer mailbox with "latest value wins" semantics.
+//  Note: a triple buffer is used, so <post()> and <fetch()> never wait for
+//        each other and never use a mutex. Values posted before the consumer
+//        fetches are overwritten by the newer ones.
+template <typename T>
+class VespaMailbox {
+  public:
+    VespaMailbox(void);
+    bool fetch(T &);
+    bool pending(void) const;
+    void post(const T &);
+
+  private:
+    const static uint32_t _FLAG_NEW = 0x04;
+    const static uint32_t _MASK_INDEX = 0x03;
+
+    T _buffers[3];
+    uint8_t _index_write; // owned by the producer
+    uint8_t _index_read; // owned by the consumer
+    std::atomic<uint32_t> _shared; // index of the middle buffer + new flag
+};
+
+// --------------------------------------------------
+// Class - Vespa Delegate
+
+// Function with a context (e.g. an object), called with the value of an event
+//  Note: only a function pointer and a pointer to the context are stored, so a
+//        delegate can be copied freely (also from an interrupt), without allocation.
+class VespaDelegate {
+  public:
+    typedef void (*Function)(void *, uint32_t);
+
+    constexpr VespaDelegate(void) : _function(nullptr), _context(nullptr) {}
+    constexpr VespaDelegate(Function function, void *context = nullptr) : _function(function), _context(context) {}
+
+    // delegate of a method (e.g. <VespaDelegate::fromMethod<Robot, &Robot::onPressed>(robot)>)
+    template <class C, void (C::*M)(uint32_t)>
+    static VespaDelegate fromMethod(C &object){ return VespaDelegate(VespaDelegate::_callMethod<C, M>, &object); }
+
+    bool attached(void) const { return (this->_function != nullptr); }
+    void call(uint32_t value) const {
+      if(this->_function != nullptr){
+        this->_function(this->_context, value);
+      }
+    }
+    void operator()(uint32_t value) const { this->call(value); }
+
+  private:
+    Function _function;
+    void *_context;
+
+    template <class C, void (C::*M)(uint32_t)>
+    static void _callMethod(void *object, uint32_t value){ (((C *)object)->*M)(value); }
+};
+
+// --------------------------------------------------
+// Class - Vespa Event Queue
+
+// Multiple-producer/single-consumer queue of deferred events
+//  Note: <post()> is lock-free and safe to call from interrupts and from any
+//        task or core. The delegates are called by <dispatch()>, in the order of
+//        the events, in the context chosen by the application (e.g. <loop()>).
+//        When the queue is full, the new events are dropped (and counted).
+class VespaEventQueue {
+  public:
+    VespaEventQueue(void);
+    uint8_t dispatch(uint8_t = 0xFF);
+    uint32_t getDropped(void);
+    bool pending(void);
+    bool post(const VespaDelegate &, uint32_t);
+
+  private:
+    const static uint32_t _MASK = VESPA_EVENTS_QUEUE_SIZE - 1;
+
+    struct Entry {
+      std::atomic<uint32_t> sequence; // position when free, position + 1 when ready
+      VespaDelegate delegate;
+      uint32_t value;
+    };
+
+    Entry _entries[VESPA_EVENTS_QUEUE_SIZE];
+    std::atomic<uint32_t> _head; // next position to post (producers)
+    uint32_t _tail; // next position to dispatch (consumer)
+    std::atomic<uint32_t> _dropped;
+};
+
+// --------------------------------------------------
+// Class - Vespa Trace
+
+// Ring buffers of the calls to the public methods of the library (one per core).
+//  Note: the methods record an entry event when called and an exit event
+//        (event | <VESPA_TRACE_EXIT>) when returning, each with the value of
+//        the cycle counter. Nothing is recorded (and no memory is used) if
+//        <VESPA_TRACE_ENABLED> is not defined.
+class VespaTrace {
+  public:
+    static void clear(void);
+    static size_t dump(Print &);
+    static void record(uint8_t, uint32_t);
+
+    const static uint8_t FORMAT_VERSION = 1;
+};
+
+// Records the entry and the exit of a method (see <VESPA_TRACE()>)
+class VespaTraceScope {
+  public:
+    __attribute__((always_inline)) inline VespaTraceScope(uint8_t event, uint32_t argument) : _event(event) {
+      VespaTrace::record(event, argument);
+    }
+    __attribute__((always_inline)) inline ~VespaTraceScope(void){
+      VespaTrace::record(this->_event | VESPA_TRACE_EXIT, 0);
+    }
+
+  private:
+    uint8_t _event;
+};
+
+// --------------------------------------------------
+// Class - Vespa Codec
+
+// Framing of the binary records (COBS) and their checksum (CRC-16/CCITT-FALSE)
+//  Note: the frames are delimited by 0x00, which never appears in an encoded record.
+class VespaCodec {
+  public:
+    static uint16_t crc16(const uint8_t *, size_t, uint16_t = 0xFFFF);
+    static size_t decodeCOBS(uint8_t *, size_t);
+    static size_t encodeCOBS(const uint8_t *, size_t, uint8_t *);
+
+    // maximum size of an encoded record (without the delimiter)
+    static constexpr size_t maxEncodedSize(size_t size){ return size + (size / 254) + 1; }
+};
+
 // --------------------------------------------------
 // Class - Vespa Battery
 
@@ -94,15 +551,26 @@ class VespaBattery {
   public:
     VespaBattery(void);
     ~VespaBattery(void);
+    bool begin(void);
     uint8_t readCapacity(void);
     uint32_t readVoltage(void);
     bool setBatteryType(uint8_t);
+    void setConversion(uint32_t);
+
+    // event with context, called directly or deferred to a queue
+    void onCritical(const VespaDelegate &, VespaEventQueue * = nullptr);
 
     void (*handler_critical)(uint8_t); // critical voltage (capacity)
 
   private:
     uint8_t _pin;
     uint8_t _battery_type;
+    bool _initialized;
+    uint32_t _conversion; // Vin/Vout (x1000)
+    VespaDelegate _critical;
+    VespaEventQueue *_critical_queue;
+
+    static bool _begin(void *);
 };
 
 // --------------------------------------------------
@@ -113,16 +581,26 @@ class VespaButton {
     VespaButton(void);
     VespaButton(uint8_t, uint8_t = INPUT);
     ~VespaButton(void);
+    bool begin(void);
     bool pressed(void);
+    bool read(void);
     bool setActiveMode(uint8_t);
     void setDebounce(uint16_t);
 
+    // event with context, called directly or deferred to a queue
+    void onChange(const VespaDelegate &, VespaEventQueue * = nullptr);
+
     void (*on_change)(bool);
 
   private:
-    uint8_t _pin, _active_mode;
+    uint8_t _pin, _mode, _active_mode;
     uint16_t _debounce;
+    bool _initialized;
     bool _last_state;
+    VespaDelegate _change;
+    VespaEventQueue *_change_queue;
+
+    static bool _begin(void *);
 };
 
 // --------------------------------------------------
@@ -133,6 +611,7 @@ class VespaLED {
     VespaLED(void);
     VespaLED(uint8_t);
     ~VespaLED(void);
+    bool begin(void);
     void blink(uint32_t);
     void on(void);
     void off(void);
@@ -141,16 +620,23 @@ class VespaLED {
 
   private:
     uint8_t _pin, _state;
+    bool _initialized;
     uint32_t _stop_time, _delay;
+
+    static bool _begin(void *);
 };
 
 // --------------------------------------------------
 // Class - Vespa Motors
 
-class VespaMotors {
+// Driver of the two DC motors
+//  @param (Board) : the configuration of the board (see <VespaBoard>)
+template <class Board>
+class VespaMotorsT {
   public:
-    VespaMotors(void);
-    ~VespaMotors(void);
+    VespaMotorsT(void);
+    ~VespaMotorsT(void);
+    bool begin(void);
     void backward(uint8_t);
     void forward(uint8_t);
     void setSpeedLeft(int8_t);
@@ -158,49 +644,538 @@ class VespaMotors {
     void stop(void);
     void turn(int8_t, int8_t);
 
+    // current state
+    int32_t getDutyLeft(void);
+    int32_t getDutyRight(void);
+
+    // calibration (deadband and nonlinearity of each motor)
+    bool calibrate(VespaMotorsCalibration &, int32_t (*)(uint8_t, void *), void * = nullptr, uint16_t = 200);
+    void getCalibration(VespaMotorsCalibration &);
+    void resetCalibration(void);
+    void setCalibration(const VespaMotorsCalibration &);
+
+    // cross-core commands (one producer, applied by the owner of the object)
+    bool applyPending(void);
+    void post(int8_t, int8_t);
+    void postLeft(int8_t);
+    void postRight(int8_t);
+    void postStop(void);
+
+    // ISR-safe setters (in IRAM, no LEDC reconfiguration)
+    void setSpeedLeftFromISR(int8_t);
+    void setSpeedRightFromISR(int8_t);
+    void stopFromISR(void);
+    void turnFromISR(int8_t, int8_t);
+
     const static uint8_t FORWARD = HIGH;  // MA1 & MB1
     const static uint8_t BACKWARD = LOW; // MA2 & MB2 (opposite of FORWARD)
+    const static uint8_t LEFT = 0; // motor A
+    const static uint8_t RIGHT = 1; // motor B
 
   private:
-    uint8_t _pinMA1, _pinMA2, _pinMB1, _pinMB2;
-    uint8_t *_active_pin_A, *_active_pin_B;
+    // values calculated at compile time
+    constexpr static uint16_t _MAX_DUTY_CYCLE = (1UL << Board::MOTORS_PWM_RESOLUTION) - 1;
+    constexpr static uint32_t _DUTY_SCALE = (((uint32_t)_MAX_DUTY_CYCLE << 16) + 99) / 100; // duty per [%] (Q16)
+
+    static_assert((Board::MOTORS_PWM_RESOLUTION >= 1) && (Board::MOTORS_PWM_RESOLUTION <= 16), "Invalid PWM resolution for the motors");
+    static_assert(Board::MOTORS_CHANNEL_A != Board::MOTORS_CHANNEL_B, "The motors must use different channels");
+    static_assert((Board::MOTORS_CHANNEL_A < 16) && (Board::MOTORS_CHANNEL_B < 16), "Invalid LEDC channel for the motors");
+    static_assert((Board::MOTORS_PIN_A1 != Board::MOTORS_PIN_A2) && (Board::MOTORS_PIN_B1 != Board::MOTORS_PIN_B2), "Each motor must use two different pins");
+
+    bool _initialized;
+    uint8_t _active_pin_A, _active_pin_B;
     uint16_t _pwmA, _pwmB;
-    uint8_t _pwm_channel_A, _pwm_channel_B;
-    double _pwm_frequency; // [Hz]
-    uint8_t _pwm_resolution;
-    uint16_t _max_duty_cyle;
+    VespaMotorsCalibration _calibration;
+    uint16_t _duties[2][101]; // duty cycle of each speed (0-100%), built from the calibration
+    VespaMailbox<VespaMotorsSetpoint> _mailbox;
+    VespaMotorsSetpoint _posted; // last setpoint posted (producer side)
 
-    bool _attachPin(uint8_t *);
+    static bool _begin(void *);
+    bool _attachPin(uint8_t);
     bool _configurePWM(void);
     void _setDirectionLeft(uint8_t);
     void _setDirectionRight(uint8_t);
+    void _setSpeedLeft(int8_t);
+    void _setSpeedRight(int8_t);
+    uint16_t _toDuty(uint8_t);
+    void _writeDuty(uint8_t, uint16_t);
 };
 
 // --------------------------------------------------
 // Class - Vespa Servo
 
-class VespaServo {
+// Driver of the servos
+//  @param (Board) : the configuration of the board (see <VespaBoard>)
+template <class Board>
+class VespaServoT {
   public:
-    VespaServo(void);
-    ~VespaServo(void);
+    VespaServoT(void);
+    ~VespaServoT(void);
     bool attach(uint8_t);
     bool attach(uint8_t, uint16_t, uint16_t);
     bool attached(void);
     void detach(void);
+    uint16_t getPulseWidth(void);
     void write(uint16_t);
+
+    // attach with the pin checked at compile time
+    template <uint8_t PIN> bool attach(void);
+    template <uint8_t PIN> bool attach(uint16_t, uint16_t);
+
+    // ISR-safe setter (in IRAM, integer math only)
+    void writeFromISR(uint16_t);
+
+    // cross-core commands (one producer, applied by the owner of the object)
+    bool applyPending(void);
+    void post(uint16_t);
+
+    static constexpr bool isValidPin(uint8_t);
     
   private:
+    // values calculated at compile time
+    constexpr static uint16_t _MAX_DUTY_CYCLE = (1UL << Board::SERVO_PWM_RESOLUTION) - 1;
+    constexpr static uint32_t _TICKS_SCALE = ((uint64_t)_MAX_DUTY_CYCLE * Board::SERVO_PWM_FREQUENCY << 24) / 1000000; // ticks per [us] (Q24)
+
+    static_assert((Board::SERVO_PWM_RESOLUTION >= 1) && (Board::SERVO_PWM_RESOLUTION <= 16), "Invalid PWM resolution for the servos");
+    static_assert(((uint64_t)_MAX_DUTY_CYCLE * Board::SERVO_PWM_FREQUENCY) < 100000, "The duty cycle of the servos would overflow");
+
+    // phase step between the channels (the longest pulses of four consecutive channels fit in the period without overlap)
+    constexpr static uint16_t _PHASE_STEP = ((uint32_t)_MAX_DUTY_CYCLE + 1) / VESPA_SERVO_QTY;
+    static_assert(((uint32_t)_PHASE_STEP * (VESPA_SERVO_QTY - 1) + (((uint64_t)VESPA_SERVO_PULSE_WIDTH_MAX * _TICKS_SCALE) >> 24)) <= _MAX_DUTY_CYCLE, "The pulses of the servos don't fit in the staggered phases");
+
     static uint8_t _servo_count;
-    static VespaServo *_servos[];
+    static VespaServoT *_servos[];
 
     bool _attached;
     uint8_t _pin;
+    uint8_t _channel; // LEDC channel selected when attaching
     uint16_t _max, _min; // [us]
-    double _pwm_frequency; // [Hz]
-    uint8_t _pwm_resolution;
-    uint16_t _max_duty_cyle;
+    uint16_t _pulse_width; // last value written [us]
+    VespaMailbox<uint16_t> _mailbox;
+
+    bool _attach(uint16_t, uint16_t);
+};
+
+// --------------------------------------------------
+// Types
+
+typedef VespaMotorsT<VespaBoard> VespaMotors;
+typedef VespaServoT<VespaBoard> VespaServo;
+
+// --------------------------------------------------
+// Class - Vespa Commands
+
+// Binary command interface (COBS frames with CRC, see <VespaCommand>)
+//  Note: the frames are decoded in the receive buffer, without allocations.
+//        If no valid frame is received within the timeout, a hardware timer
+//        stops the motors (deadman). The format is described in <VespaCommands.cpp>.
+class VespaCommands {
+  public:
+    VespaCommands(Stream &, uint32_t = VESPA_COMMANDS_TIMEOUT);
+    ~VespaCommands(void);
+    void attach(VespaBattery &);
+    void attach(VespaLED &);
+    void attach(VespaMotors &);
+    bool attach(VespaServo &);
+    bool expired(void);
+    uint32_t getErrors(void);
+    uint32_t getReceived(void);
+    void onExpired(const VespaDelegate &, VespaEventQueue * = nullptr);
+    void setTimeout(uint32_t);
+    void update(void);
+
+  private:
+    Stream &_stream;
+    VespaBattery *_battery;
+    VespaLED *_led;
+    VespaMotors *_motors;
+    VespaServo *_servos[VESPA_SERVO_QTY];
+
+    uint8_t _buffer[VESPA_COMMANDS_BUFFER_SIZE];
+    uint8_t _length;
+    bool _overflow; // discard until the next delimiter
+    uint32_t _errors, _received;
+
+    // deadman
+    void *_timer;
+    uint32_t _timeout; // [us]
+    std::atomic<uint32_t> _last_time; // time of the last valid frame [us]
+    std::atomic<bool> _expired;
+    VespaDelegate _expired_delegate;
+    VespaEventQueue *_expired_queue;
+
+    static void _checkTimeout(void *);
+    void _execute(uint8_t *, size_t);
+    void _reply(const uint8_t *, size_t);
+    void _startTimer(void);
+};
+
+// --------------------------------------------------
+// Class - Vespa Config
+
+// Calibration and settings of the board, stored in the flash
+//  Note: the configuration is a single record with a version and a CRC, read
+//        directly into memory by <begin()> (no parsing). If the record is
+//        missing, of another version or corrupted, the defaults are used.
+//        <save()> writes the whole record at once and the storage keeps the
+//        previous one until the write is complete, so a reset during the
+//        write never leaves a partial configuration.
+class VespaConfig {
+  public:
+    VespaConfig(void);
+    ~VespaConfig(void);
+    bool begin(void);
+    bool loaded(void);
+    void reset(void);
+    bool save(void);
+
+    // apply to the drivers
+    void apply(VespaBattery &);
+    void apply(VespaButton &);
+    void apply(VespaMotors &);
+    bool apply(VespaServo &, uint8_t, uint8_t);
+
+    // values
+    const VespaConfigData & get(void);
+    void setBatteryConversion(uint32_t);
+    void setDebounce(uint16_t);
+    void setMotorsCalibration(const VespaMotorsCalibration &);
+    bool setServoLimits(uint8_t, uint16_t, uint16_t);
+
+  private:
+    VespaConfigData _data;
+    bool _initialized;
+    bool _loaded; // the record was read from the storage
+
+    static bool _begin(void *);
+    static uint16_t _crc(const VespaConfigData &);
+};
+
+// --------------------------------------------------
+// Class - Vespa Power
+
+// Tickless power management between the ticks of the application
+//  Note: <sleepUntil()> waits until the next deadline of the application or
+//        of the hardware timers of the library (e.g. the deadman), whichever
+//        is first. The CPU enters light sleep only when every PWM output with
+//        a duty cycle is clocked by RC_FAST, because the other channels stop
+//        with the APB clock. Otherwise, it waits with the peripherals clocked.
+//  Note: the motors and the servos use the low speed channels clocked by
+//        RC_FAST (see <VESPA_PWM_SLEEP_CLOCK>), so they keep running in light
+//        sleep. A channel attached with <ledcAttach()> keeps the CPU awake.
+class VespaPower {
+  public:
+    VespaPower(void);
+    void attach(VespaEventQueue &);
+    uint32_t getMaxLatency(void);
+    uint32_t getSleepTime(void);
+    uint32_t getWakeups(void);
+    VespaWakeup getWakeup(void);
+    void setWakeupPin(uint8_t);
+    void setWakeupSerial(bool);
+    VespaPowerMode sleepUntil(uint32_t);
+
+  private:
+    VespaEventQueue *_queue;
+    uint8_t _wakeup_pin;
+    bool _wakeup_serial;
+    VespaWakeup _wakeup; // source of the last wake-up
+    uint32_t _wakeups;
+    uint32_t _max_latency; // [us]
+    uint64_t _sleep_time; // [us]
+};
+
+// --------------------------------------------------
+// Class - Vespa RC Input
+
+// Pulse widths of a RC receiver (1000-2000 us), measured by the hardware
+//  Note: each channel uses a RMT channel, so there is no busy waiting (as with
+//        <pulseIn()>). The pulses are handled in the interrupt, where the
+//        servos and motors passed through are updated directly. If no valid
+//        pulse is received within the timeout, the motors passed through are
+//        stopped from the interrupt of a timer (failsafe), until the next pulse.
+class VespaRCInput {
+  public:
+    VespaRCInput(uint32_t = VESPA_RC_INPUT_TIMEOUT);
+    ~VespaRCInput(void);
+    bool attach(uint8_t, uint8_t);
+    bool connected(uint8_t);
+    void detach(uint8_t);
+    void onLost(const VespaDelegate &, VespaEventQueue * = nullptr);
+    bool passThrough(uint8_t, VespaServo &);
+    bool passThrough(uint8_t, uint8_t, VespaMotors &);
+    uint16_t read(uint8_t);
+    int8_t readSpeed(uint8_t);
+    void setTimeout(uint32_t);
+
+    static int8_t toSpeed(uint16_t);
+
+  private:
+    // state of a channel (shared with the interrupts)
+    struct Channel {
+      VespaRCInput *owner;
+      uint8_t index;
+      uint8_t pin;
+      void *capture;
+      std::atomic<uint16_t> width; // last valid pulse [us]
+      std::atomic<uint32_t> time; // time of the last valid pulse [us]
+      VespaServo *servo; // passed through
+    };
+
+    Channel _channels[VESPA_RC_INPUT_CHANNELS];
+    VespaMotors *_motors; // passed through
+    uint8_t _motors_left, _motors_right; // channels of the motors
+
+    // failsafe
+    void *_timer;
+    uint32_t _timeout; // [us]
+    std::atomic<uint8_t> _lost; // bit mask of the channels without signal
+    VespaDelegate _lost_delegate;
+    VespaEventQueue *_lost_queue;
+
+    static void _capture(void *, uint32_t);
+    static void _checkTimeout(void *);
+    void _startTimer(void);
+};
+
+// --------------------------------------------------
+// Class - Vespa Recorder
+
+// Binary log of the timestamped calls to the motors, servos and LEDs attached.
+//  Note: the calls are recorded only when <VESPA_RECORD_ENABLED> is defined and
+//        the recorder is started. The calls made inside other recorded calls
+//        (e.g. <setSpeedLeft()> inside <turn()>) are not recorded. The log is
+//        stored in the buffer given (no allocation) and can be replayed with
+//        <VespaReplay>. The format is described in <VespaRecorder.cpp>.
+class VespaRecorder {
+  public:
+    VespaRecorder(uint8_t *, size_t);
+    ~VespaRecorder(void);
+    bool attach(VespaLED &);
+    bool attach(VespaMotors &);
+    bool attach(VespaServo &);
+    void clear(void);
+    size_t dump(Print &);
+    uint32_t getDropped(void);
+    size_t getSize(void);
+    void start(void);
+    void stop(void);
+
+    // called by the recorded methods (see <VESPA_RECORD()>)
+    static uint8_t enter(const void *, uint8_t, uint32_t, bool);
+    static void leave(const void *, uint8_t);
+
+    const static uint8_t FORMAT_VERSION = 1;
+
+  private:
+    static std::atomic<VespaRecorder *> _active;
+
+    uint8_t *_buffer;
+    size_t _capacity;
+    std::atomic<size_t> _length;
+    uint32_t _start_time; // [us]
+    std::atomic<uint32_t> _dropped;
+
+    const void *_objects[VESPA_RECORDER_OBJECTS];
+    uint8_t _types[VESPA_RECORDER_OBJECTS]; // class of the object (see <VespaTraceEvent>)
+    std::atomic<uint8_t> _depths[VESPA_RECORDER_CONTEXTS][VESPA_RECORDER_OBJECTS]; // nested calls of each context
+    uint8_t _object_count;
+
+    bool _attach(const void *, uint8_t);
+    void _capture(uint8_t, uint8_t, uint32_t);
+};
+
+// Records a call to an actuator (see <VESPA_RECORD()>)
+class VespaRecordScope {
+  public:
+    __attribute__((always_inline)) inline VespaRecordScope(const void *object, uint8_t event, uint32_t argument, bool record) : _object(object) {
+      this->_context = VespaRecorder::enter(object, event, argument, record);
+    }
+    __attribute__((always_inline)) inline ~VespaRecordScope(void){
+      VespaRecorder::leave(this->_object, this->_context);
+    }
+
+  private:
+    const void *_object;
+    uint8_t _context; // where the call was entered (see <VespaRecorder::enter()>)
+};
+
+// --------------------------------------------------
+// Class - Vespa Replay
+
+// Replays a log of <VespaRecorder> with the same timing
+//  Note: attach the objects in the same order as they were attached to the recorder.
+class VespaReplay {
+  public:
+    VespaReplay(const uint8_t *, size_t);
+    ~VespaReplay(void);
+    bool attach(VespaLED &);
+    bool attach(VespaMotors &);
+    bool attach(VespaServo &);
+    bool finished(void);
+    bool start(void);
+    void update(void);
+
+  private:
+    const uint8_t *_log;
+    size_t _size;
+    size_t _position; // next entry
+    uint32_t _start_time; // [us]
+    bool _started;
+
+    void *_objects[VESPA_RECORDER_OBJECTS];
+    uint8_t _types[VESPA_RECORDER_OBJECTS];
+    uint8_t _object_count;
+
+    bool _attach(void *, uint8_t);
+    void _execute(uint8_t, uint8_t, uint32_t);
+};
+
+// --------------------------------------------------
+// Class - Vespa Self Test
+
+// Diagnostic of the motors at boot, with the battery and the encoders
+//  Note: each motor runs briefly in each direction while the battery voltage
+//        is measured. The dip shows the current drawn, which separates the
+//        disconnected, stalled and degraded motors (see <VespaMotorHealth>).
+//        The test takes about 450 ms and is blocking, so keep the wheels off
+//        the ground. The algorithm is described in <VespaSelfTest.cpp>.
+class VespaSelfTest {
+  public:
+    VespaSelfTest(VespaMotors &, VespaBattery &);
+    bool passed(void);
+    static void print(const VespaSelfTestReport &, Print &);
+    bool run(VespaSelfTestReport &, uint8_t = VESPA_SELF_TEST_SPEED);
+    void setEncoders(int32_t (*)(uint8_t, void *), void * = nullptr);
+    void setThresholds(uint16_t, uint16_t);
+
+  private:
+    VespaMotors &_motors;
+    VespaBattery &_battery;
+    int32_t (*_read)(uint8_t, void *); // position of a motor (e.g. count of an encoder)
+    void *_context;
+    uint16_t _dip_min, _dip_stall; // [mV]
+    bool _passed; // result of the last test
+
+    uint8_t _classify(const VespaSelfTestReport &, uint8_t);
+    uint32_t _readVoltage(void);
+    void _setSpeed(uint8_t, int8_t);
+};
+
+// --------------------------------------------------
+// Class - Vespa Telemetry
+
+// Periodic binary records of the state of the board, sent without blocking.
+//  Note: each record is sampled into one buffer while the other one is being
+//        sent, only with the space available in the output (<availableForWrite()>).
+//        A record not sent before the next sample is dropped (see <getDropped()>).
+//        The format is described in <VespaTelemetry.cpp>.
+class VespaTelemetry {
+  public:
+    VespaTelemetry(Print &, uint32_t = VESPA_TELEMETRY_PERIOD);
+    ~VespaTelemetry(void);
+    void attach(VespaBattery &);
+    void attach(VespaButton &);
+    void attach(VespaMotors &);
+    bool attach(VespaServo &);
+    uint32_t getDropped(void);
+    void setPeriod(uint32_t);
+    void update(void);
+
+    const static uint8_t RECORD_TYPE = 0x01;
+    const static uint8_t RECORD_SIZE = 16 + (2 * VESPA_SERVO_QTY); // [bytes] (before the encoding)
+
+  private:
+    static_assert(VESPA_SERVO_QTY <= 4, "The flags of the record have only 4 bits for the servos");
+
+    constexpr static uint8_t _FRAME_SIZE = VespaCodec::maxEncodedSize(RECORD_SIZE) + 1; // with the delimiter
+
+    Print &_output;
+    VespaBattery *_battery;
+    VespaButton *_button;
+    VespaMotors *_motors;
+    VespaServo *_servos[VESPA_SERVO_QTY];
+
+    uint32_t _period, _next_time; // [ms]
+    uint32_t _dropped;
+    uint16_t _sequence;
+
+    // double buffer
+    uint8_t _frames[2][_FRAME_SIZE];
+    uint8_t _lengths[2];
+    uint8_t _sending; // index of the frame being sent
+    uint8_t _sent; // bytes of the frame already sent
+    bool _pending; // the other frame is ready to be sent
+
+    void _sample(uint8_t);
+    void _send(void);
 };
 
+// --------------------------------------------------
+// --------------------------------------------------
+// Template definitions - Vespa Mailbox
+
+// Constructor
+template <typename T>
+VespaMailbox<T>::VespaMailbox(void) :
+  _index_write(0),
+  _index_read(1),
+  _shared(2)
+{
+  // nothing to do here
+}
+
+// --------------------------------------------------
+
+// Fetch the latest value posted (consumer side)
+//  @param (value) : the variable to store the value [T &]
+//  @returns true if a new value was available [bool]
+template <typename T>
+bool VespaMailbox<T>::fetch(T & value){
+  // check if there is something new
+  if(!this->pending()){
+    return false;
+  }
+
+  // swap the read buffer with the middle one
+  uint32_t previous = this->_shared.exchange(this->_index_read, std::memory_order_acq_rel);
+  this->_index_read = previous & _MASK_INDEX;
+  value = this->_buffers[this->_index_read];
+
+  return true;
+}
+
+// --------------------------------------------------
+
+// Check if a new value is available
+//  @returns true if a value was posted but not fetched yet [bool]
+template <typename T>
+bool VespaMailbox<T>::pending(void) const {
+  return (this->_shared.load(std::memory_order_acquire) & _FLAG_NEW) != 0;
+}
+
+// --------------------------------------------------
+
+// Post a new value (producer side)
+//  @param (value) : the value to post [const T &]
+template <typename T>
+void VespaMailbox<T>::post(const T & value){
+  // write to the private buffer and publish it as the middle one
+  this->_buffers[this->_index_write] = value;
+  uint32_t previous = this->_shared.exchange(this->_index_write | _FLAG_NEW, std::memory_order_acq_rel);
+  this->_index_write = previous & _MASK_INDEX;
+}
+
+// --------------------------------------------------
+// Template definitions - Vespa Motors & Vespa Servo
+
+#include "VespaMotorsT.h"
+#include "VespaServoT.h"
+
+// the default configuration is compiled only once (see <VespaMotors.cpp> and <VespaServo.cpp>)
+extern template class VespaMotorsT<VespaBoard>;
+extern template class VespaServoT<VespaBoard>;
+
 // --------------------------------------------------
 
 #endif // VESPA_H
@@ -0,0 +1,97 @@
+/*******************************************************************************
+* RoboCore Vespa Library
+* 
+* Initialization of all the drivers of the Vespa board.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// Static variables
+
+// zero initialized before the constructors of the global objects run
+Vespa::Entry Vespa::_entries[VESPA_BEGIN_OBJECTS];
+uint8_t Vespa::_count = 0;
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Add a driver to the initialization
+//  @param (object) : the driver [void *]
+//         (begin) : the function to initialize the driver [bool (*)(void *)]
+//         (order) : the order of the initialization (see <VespaBeginOrder>) [uint8_t]
+//  @returns false if there are already <VESPA_BEGIN_OBJECTS> drivers [bool]
+//  Note: called by the constructors of the drivers, before <setup()> for the global
+//        objects. No hardware is accessed.
+bool Vespa::add(void *object, bool (*begin)(void *), uint8_t order){
+  if ((object == nullptr) || (begin == nullptr) || (_count >= VESPA_BEGIN_OBJECTS)){
+    return false;
+  }
+
+  _entries[_count].object = object;
+  _entries[_count].begin = begin;
+  _entries[_count].order = order;
+  _count++;
+  return true;
+}
+
+// --------------------------------------------------
+
+// Initialize all the drivers
+//  @returns true if all the drivers were initialized [bool]
+//  Note: call it at the beginning of <setup()>. The configuration is loaded first,
+//        then the outputs (motors and LED) are initialized, then the inputs, each
+//        peripheral only once. The drivers already initialized are skipped.
+bool Vespa::begin(void){
+  bool success = true;
+  for (uint8_t order = BEGIN_CONFIG ; order <= BEGIN_INPUTS ; order++){
+    for (uint8_t i=0 ; i < _count ; i++){
+      if (_entries[i].order == order){
+        success &= _entries[i].begin(_entries[i].object);
+      }
+    }
+  }
+  return success;
+}
+
+// --------------------------------------------------
+
+// Remove a driver from the initialization
+//  @param (object) : the driver [void *]
+//  Note: called by the destructors of the drivers.
+void Vespa::remove(void *object){
+  for (uint8_t i=0 ; i < _count ; i++){
+    if (_entries[i].object == object){
+      // keep the order of the others
+      for (uint8_t j=i+1 ; j < _count ; j++){
+        _entries[j - 1] = _entries[j];
+      }
+      _count--;
+      return;
+    }
+  }
+}
+
+// --------------------------------------------------
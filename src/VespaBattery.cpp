@@ -37,13 +37,38 @@
 // --------------------------------------------------
 
 // Constructor (default)
+//  Note: the pin is configured by <begin()>.
 VespaBattery::VespaBattery(void) :
+  handler_critical(nullptr),
   _pin(VESPA_BATTERY_PIN),
   _battery_type(BATTERY_UNDEFINED),
-  handler_critical(nullptr)
+  _initialized(false),
+  _conversion(VESPA_BATTERY_VOLTAGE_CONVERSION),
+  _critical_queue(nullptr)
 {
+  Vespa::add(this, VespaBattery::_begin, BEGIN_INPUTS);
+}
+
+// --------------------------------------------------
+
+// Destructor
+VespaBattery::~VespaBattery(void){
+  Vespa::remove(this);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Configure the pin and the ADC
+//  @returns true if successful [bool]
+//  Note: called on the first reading if not called before (see <Vespa::begin()>).
+bool VespaBattery::begin(void){
+  if (this->_initialized){
+    return true;
+  }
+
   // configure the pin
-  pinMode(this->_pin, INPUT);
+  VespaHAL::pinMode(this->_pin, INPUT);
 
   // configure the ADC
   /*
@@ -55,22 +80,19 @@ VespaBattery::VespaBattery(void) :
   * 
   * Note: 11 db attenuation is deprecated in ESP IDF v5.2.2.
   */
-  analogSetPinAttenuation(this->_pin, VESPA_BATTERY_ADC_ATTENUATION);
-}
-
-// --------------------------------------------------
+  VespaHAL::analogSetPinAttenuation(this->_pin, VESPA_BATTERY_ADC_ATTENUATION);
 
-// Destructor
-VespaBattery::~VespaBattery(void){
-  // nothing to do here
+  this->_initialized = true;
+  return true;
 }
 
-// --------------------------------------------------
 // --------------------------------------------------
 
 // Read the remaining capacity of the battery
 //  @returns the remaining capacity (in %) [uint8_t]
 uint8_t VespaBattery::readCapacity(void){
+  VESPA_TRACE(TRACE_BATTERY_READ_CAPACITY, 0);
+
   // check for LiPo
   //  (Vnominal = 3,7 V / Vmax = 4,2 V)
   if(this->_battery_type == BATTERY_LIPO){
@@ -115,6 +137,11 @@ uint8_t VespaBattery::readCapacity(void){
       if(this->handler_critical != nullptr){
         this->handler_critical(percentage); // call the handler
       }
+      if(this->_critical_queue != nullptr){
+        this->_critical_queue->post(this->_critical, percentage); // deferred
+      } else {
+        this->_critical.call(percentage);
+      }
     }
 
     // return the value calculated
@@ -130,9 +157,15 @@ uint8_t VespaBattery::readCapacity(void){
 // Read the voltage of the battery (in mV)
 //  @returns the voltage of the battery (in mV) [uint32_t]
 uint32_t VespaBattery::readVoltage(void){
+  VESPA_TRACE(TRACE_BATTERY_READ_VOLTAGE, 0);
+
+  if (!this->_initialized){
+    this->begin(); // lazy initialization
+  }
+
   // convert the voltage based on the circuit factor
-  uint32_t voltage = analogReadMilliVolts(this->_pin);
-  voltage *= VESPA_BATTERY_VOLTAGE_CONVERSION;
+  uint32_t voltage = VespaHAL::analogReadMilliVolts(this->_pin);
+  voltage *= this->_conversion;
   voltage /= 1000;
 
   return voltage;
@@ -144,6 +177,8 @@ uint32_t VespaBattery::readVoltage(void){
 //  @param (type) : the type of the battery [uint8_t]
 //  @returns true if a valid type was given [bool]
 bool VespaBattery::setBatteryType(uint8_t type){
+  VESPA_TRACE(TRACE_BATTERY_SET_TYPE, type);
+
   // check if the type exists and assign
   if((type >= BATTERY_UNDEFINED) && (type <= BATTERY_LIPO)){
     this->_battery_type = type;
@@ -153,4 +188,42 @@ bool VespaBattery::setBatteryType(uint8_t type){
 }
 
 // --------------------------------------------------
+
+// Set the conversion of the voltage divider of the battery
+//  @param (conversion) : Vin/Vout (x1000), measured on the board [uint32_t]
+//  Note: the default is <VESPA_BATTERY_VOLTAGE_CONVERSION>, from the nominal
+//        values of the resistors (see <VespaConfig> to store a calibration).
+void VespaBattery::setConversion(uint32_t conversion){
+  VESPA_TRACE(TRACE_BATTERY_SET_CONVERSION, conversion);
+
+  if(conversion > 0){
+    this->_conversion = conversion;
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Set the delegate called when the capacity is critical (15% or less)
+//  @param (delegate) : the delegate, called with the capacity [%] [const VespaDelegate &]
+//         (queue) : the queue to post the event to, or null to call the delegate in <readCapacity()> [VespaEventQueue *]
+//  Note: the event is raised on each call to <readCapacity()> while the capacity is critical,
+//        in addition to <handler_critical>.
+void VespaBattery::onCritical(const VespaDelegate &delegate, VespaEventQueue *queue){
+  VESPA_TRACE(TRACE_BATTERY_ON_CRITICAL, (queue != nullptr));
+
+  this->_critical = delegate;
+  this->_critical_queue = queue;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Initialize a battery (see <Vespa::add()>)
+//  @param (object) : the battery [VespaBattery *]
+//  @returns true if successful [bool]
+bool VespaBattery::_begin(void *object){
+  return ((VespaBattery *)object)->begin();
+}
+
 // --------------------------------------------------
@@ -41,42 +41,75 @@ VespaButton::VespaButton(void) :
 
 // Constructor
 //  @param (pin) : the pin assigned to the button [uint8_t]
+//         (mode) : INPUT or INPUT_PULLUP [uint8_t]
+//  Note: the pin is configured by <begin()>.
 VespaButton::VespaButton(uint8_t pin, uint8_t mode) :
+  on_change(nullptr),
   _pin(pin),
+  _mode(mode),
   _active_mode(LOW),
-  _debounce(20),
-  on_change(nullptr)
+  _debounce(VESPA_BUTTON_DEBOUNCE),
+  _initialized(false),
+  _last_state(false),
+  _change_queue(nullptr)
 {
-  if ((mode != INPUT) && (mode != INPUT_PULLUP)){
-    mode = INPUT; // force a valid mode
+  if ((this->_mode != INPUT) && (this->_mode != INPUT_PULLUP)){
+    this->_mode = INPUT; // force a valid mode
   }
 
-  // configure the pin
-  pinMode(this->_pin, mode);
-  this->_last_state = (digitalRead(this->_pin) == this->_active_mode) ? true : false;
+  Vespa::add(this, VespaButton::_begin, BEGIN_INPUTS);
 }
 
 // --------------------------------------------------
 
 // Destructor
 VespaButton::~VespaButton(void){
-  // nothing to do here
+  Vespa::remove(this);
 }
 
 // --------------------------------------------------
 // --------------------------------------------------
 
+// Configure the pin
+//  @returns true if successful [bool]
+//  Note: called on the first reading if not called before (see <Vespa::begin()>).
+bool VespaButton::begin(void){
+  if (this->_initialized){
+    return true;
+  }
+
+  // configure the pin
+  VespaHAL::pinMode(this->_pin, this->_mode);
+  this->_last_state = (VespaHAL::digitalRead(this->_pin) == this->_active_mode) ? true : false;
+
+  this->_initialized = true;
+  return true;
+}
+
+// --------------------------------------------------
+
 // Check if the button is pressed
 bool VespaButton::pressed(void){
-  uint8_t state = digitalRead(this->_pin);
-  delay(this->_debounce); // debounce
-  if (state == digitalRead(this->_pin)){
+  VESPA_TRACE(TRACE_BUTTON_PRESSED, 0);
+
+  if (!this->_initialized){
+    this->begin(); // lazy initialization
+  }
+
+  uint8_t state = VespaHAL::digitalRead(this->_pin);
+  VespaHAL::delay(this->_debounce); // debounce
+  if (state == VespaHAL::digitalRead(this->_pin)){
     bool res = (state == this->_active_mode) ? true : false;
 
     if (res != this->_last_state){
       if (this->on_change != nullptr){
         this->on_change(res);
       }
+      if (this->_change_queue != nullptr){
+        this->_change_queue->post(this->_change, res); // deferred
+      } else {
+        this->_change.call(res);
+      }
     }
 
     this->_last_state = res;
@@ -87,10 +120,25 @@ bool VespaButton::pressed(void){
 
 // --------------------------------------------------
 
+// Read the current state of the button
+//  @returns true if the button is pressed [bool]
+//  Note: unlike <pressed()>, there is no debounce (no delay) and <on_change> is not called.
+bool VespaButton::read(void){
+  if (!this->_initialized){
+    this->begin(); // lazy initialization
+  }
+
+  return (VespaHAL::digitalRead(this->_pin) == this->_active_mode);
+}
+
+// --------------------------------------------------
+
 // Set the active mode
 //  @param (mode) : HIGH or LOW [uint8_t]
 //  @returns false if an invalid mode was given
 bool VespaButton::setActiveMode(uint8_t mode){
+  VESPA_TRACE(TRACE_BUTTON_SET_ACTIVE_MODE, mode);
+
   if ((mode != LOW) && (mode != HIGH)){
     return false;
   }
@@ -105,8 +153,33 @@ bool VespaButton::setActiveMode(uint8_t mode){
 // Set the debounce for the reading
 //  @param (debounce) : the debounce [ms] [uint16_t]
 void VespaButton::setDebounce(uint16_t debounce){
+  VESPA_TRACE(TRACE_BUTTON_SET_DEBOUNCE, debounce);
+
   this->_debounce = debounce;
 }
 
 // --------------------------------------------------
 // --------------------------------------------------
+
+// Set the delegate called when the state of the button changes
+//  @param (delegate) : the delegate, called with 1 if pressed or 0 if released [const VespaDelegate &]
+//         (queue) : the queue to post the event to, or null to call the delegate in <pressed()> [VespaEventQueue *]
+//  Note: the delegate is called in addition to <on_change>.
+void VespaButton::onChange(const VespaDelegate &delegate, VespaEventQueue *queue){
+  VESPA_TRACE(TRACE_BUTTON_ON_CHANGE, (queue != nullptr));
+
+  this->_change = delegate;
+  this->_change_queue = queue;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Initialize a button (see <Vespa::add()>)
+//  @param (object) : the button [VespaButton *]
+//  @returns true if successful [bool]
+bool VespaButton::_begin(void *object){
+  return ((VespaButton *)object)->begin();
+}
+
+// --------------------------------------------------
@@ -0,0 +1,120 @@
+/*******************************************************************************
+* RoboCore Vespa Codec Library
+* 
+* Framing (COBS) and checksum (CRC) of the binary records of the Vespa library.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+// References
+//  - https://en.wikipedia.org/wiki/Consistent_Overhead_Byte_Stuffing
+//  - https://reveng.sourceforge.io/crc-catalogue/16.htm (CRC-16/IBM-3740, aka CCITT-FALSE)
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Calculate the CRC-16/CCITT-FALSE of a buffer
+//  @param (data) : the buffer [const uint8_t *]
+//         (size) : the number of bytes [size_t]
+//         (crc) : the initial value, or the result of the previous block [uint16_t]
+//  @returns the CRC [uint16_t]
+//  Note: polynomial 0x1021, without reflection and without final XOR.
+uint16_t IRAM_ATTR VespaCodec::crc16(const uint8_t *data, size_t size, uint16_t crc){
+  for (size_t i=0 ; i < size ; i++){
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit=0 ; bit < 8 ; bit++){
+      crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+// --------------------------------------------------
+
+// Decode a COBS record in place
+//  @param (buffer) : the encoded record, without the delimiter [uint8_t *]
+//         (size) : the size of the encoded record [size_t]
+//  @returns the size of the decoded record, or 0 if invalid [size_t]
+//  Note: the decoded record is never larger than the encoded one, so it is
+//        written over the same buffer.
+size_t IRAM_ATTR VespaCodec::decodeCOBS(uint8_t *buffer, size_t size){
+  size_t index_read = 0;
+  size_t index_write = 0;
+
+  while (index_read < size){
+    uint8_t code = buffer[index_read++];
+    if ((code == 0x00) || (index_read + code - 1 > size)){
+      return 0; // invalid
+    }
+
+    for (uint8_t i=1 ; i < code ; i++){
+      buffer[index_write++] = buffer[index_read++];
+    }
+
+    // implicit 0x00 (except at the end of the record and after a maximum block)
+    if ((code != 0xFF) && (index_read < size)){
+      buffer[index_write++] = 0x00;
+    }
+  }
+
+  return index_write;
+}
+
+// --------------------------------------------------
+
+// Encode a record with COBS
+//  @param (input) : the record [const uint8_t *]
+//         (size) : the size of the record [size_t]
+//         (output) : the destination, with at least <maxEncodedSize(size)> bytes [uint8_t *]
+//  @returns the size of the encoded record (without the delimiter) [size_t]
+//  Note: the encoded record has no 0x00, so the delimiter must be added after it.
+size_t IRAM_ATTR VespaCodec::encodeCOBS(const uint8_t *input, size_t size, uint8_t *output){
+  size_t index_code = 0; // position of the current code
+  size_t index = 1;
+  uint8_t code = 1; // distance to the next 0x00
+
+  for (size_t i=0 ; i < size ; i++){
+    if (input[i] == 0x00){
+      output[index_code] = code;
+      index_code = index++;
+      code = 1;
+    } else {
+      output[index++] = input[i];
+      code++;
+
+      // maximum block (254 bytes without 0x00)
+      if ((code == 0xFF) && (i + 1 < size)){
+        output[index_code] = code;
+        index_code = index++;
+        code = 1;
+      }
+    }
+  }
+  output[index_code] = code;
+
+  return index;
+}
+
+// --------------------------------------------------
@@ -0,0 +1,391 @@
+/*******************************************************************************
+* RoboCore Vespa Commands Library
+* 
+* Binary command interface of the Vespa board, with a deadman stop.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+/*
+* Format of the frames (little endian):
+*   type (1) | sequence (1) | arguments (0-3) | CRC-16/CCITT-FALSE of the previous bytes (2)
+* 
+* Each frame is encoded with COBS and followed by 0x00 (see <VespaCodec>).
+* The arguments of each type are listed in <VespaCommand>. Only <COMMAND_PING>
+* and <COMMAND_BATTERY> are answered, with the type + <COMMAND_REPLY> and the
+* same sequence. The frames with an invalid size, CRC or type are discarded
+* and counted in <getErrors()>.
+* 
+* Any valid frame resets the deadman. If no valid frame is received within the
+* timeout, the motors are stopped from the interrupt of the timer, until the
+* next valid frame.
+*/
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Constructor
+//  @param (stream) : the source of the commands (e.g. <Serial>) [Stream &]
+//         (timeout) : the timeout of the deadman, or 0 to disable it [ms] [uint32_t]
+//  Note: the timer is started when the motors are attached.
+//  Note: the timeout is limited to <VESPA_COMMANDS_TIMEOUT_MAX>.
+VespaCommands::VespaCommands(Stream &stream, uint32_t timeout) :
+  _stream(stream),
+  _battery(nullptr),
+  _led(nullptr),
+  _motors(nullptr),
+  _length(0),
+  _overflow(false),
+  _errors(0),
+  _received(0),
+  _timer(nullptr),
+  _timeout(((timeout > VESPA_COMMANDS_TIMEOUT_MAX) ? VESPA_COMMANDS_TIMEOUT_MAX : timeout) * 1000),
+  _last_time(0),
+  _expired(false),
+  _expired_queue(nullptr)
+{
+  for (uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+    this->_servos[i] = nullptr; // default to null pointer
+  }
+}
+
+// --------------------------------------------------
+
+// Destructor
+VespaCommands::~VespaCommands(void){
+  if (this->_timer != nullptr){
+    VespaHAL::timerStop(this->_timer);
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Add the battery to the commands
+//  @param (battery) : the battery [VespaBattery &]
+void VespaCommands::attach(VespaBattery &battery){
+  this->_battery = &battery;
+}
+
+// --------------------------------------------------
+
+// Add the LED to the commands
+//  @param (led) : the LED [VespaLED &]
+//  Note: <update()> of the LED must still be called to blink.
+void VespaCommands::attach(VespaLED &led){
+  this->_led = &led;
+}
+
+// --------------------------------------------------
+
+// Add the motors to the commands and start the deadman
+//  @param (motors) : the motors [VespaMotors &]
+//  Note: the motors are initialized, because the deadman stops them from an interrupt.
+void VespaCommands::attach(VespaMotors &motors){
+  motors.begin();
+  this->_motors = &motors;
+  this->_startTimer();
+}
+
+// --------------------------------------------------
+
+// Add a servo to the commands
+//  @param (servo) : the servo [VespaServo &]
+//  @returns false if there are already <VESPA_SERVO_QTY> servos [bool]
+//  Note: the index of the servo in the commands is the order it was added.
+bool VespaCommands::attach(VespaServo &servo){
+  for (uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+    if (this->_servos[i] == &servo){
+      return true; // already added
+    }
+    if (this->_servos[i] == nullptr){
+      this->_servos[i] = &servo;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// --------------------------------------------------
+
+// Check if the motors were stopped by the deadman
+//  @returns true if no valid frame was received within the timeout [bool]
+bool VespaCommands::expired(void){
+  return this->_expired.load(std::memory_order_relaxed);
+}
+
+// --------------------------------------------------
+
+// Get the number of invalid frames
+//  @returns the number of frames discarded [uint32_t]
+uint32_t VespaCommands::getErrors(void){
+  return this->_errors;
+}
+
+// --------------------------------------------------
+
+// Get the number of valid frames
+//  @returns the number of frames executed [uint32_t]
+uint32_t VespaCommands::getReceived(void){
+  return this->_received;
+}
+
+// --------------------------------------------------
+
+// Set the delegate called when the deadman stops the motors
+//  @param (delegate) : the delegate, called with the time since the last valid frame [ms] [const VespaDelegate &]
+//         (queue) : the queue to post the event to, or null to call the delegate from the interrupt [VespaEventQueue *]
+//  Note: without a queue, the delegate must be safe to call from an interrupt (in IRAM, no blocking calls).
+//        Set it before attaching the motors, because the timer reads it.
+void VespaCommands::onExpired(const VespaDelegate &delegate, VespaEventQueue *queue){
+  this->_expired_delegate = delegate;
+  this->_expired_queue = queue;
+}
+
+// --------------------------------------------------
+
+// Set the timeout of the deadman
+//  @param (timeout) : the timeout, or 0 to disable it [ms] [uint32_t]
+//  Note: the timeout is limited to <VESPA_COMMANDS_TIMEOUT_MAX>.
+void VespaCommands::setTimeout(uint32_t timeout){
+  if (timeout > VESPA_COMMANDS_TIMEOUT_MAX){
+    timeout = VESPA_COMMANDS_TIMEOUT_MAX; // constrain
+  }
+  this->_timeout = timeout * 1000;
+  this->_startTimer();
+}
+
+// --------------------------------------------------
+
+// Read and execute the commands received
+//  Note: call it in <loop()>. Only the bytes already received are read, so it
+//        never waits for a complete frame.
+void VespaCommands::update(void){
+  int available = this->_stream.available();
+  while (available-- > 0){
+    int data = this->_stream.read();
+    if (data < 0){
+      break;
+    }
+
+    if (data == 0x00){
+      // end of frame
+      if (!this->_overflow && (this->_length > 0)){
+        size_t size = VespaCodec::decodeCOBS(this->_buffer, this->_length);
+        this->_execute(this->_buffer, size);
+      }
+      this->_length = 0; // reset
+      this->_overflow = false; // reset
+    } else if (this->_length < VESPA_COMMANDS_BUFFER_SIZE){
+      this->_buffer[this->_length++] = data;
+    } else if (!this->_overflow){
+      this->_overflow = true;
+      this->_errors++;
+    }
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Check the time since the last valid frame (deadman)
+//  @param (arg) : the object [VespaCommands *]
+//  Note: called from the interrupt of the timer.
+//  Note: while expired, the stop is repeated on every call, because a task that
+//        was inside a method of the motors may have written its duty cycle
+//        after the stop (see <VespaMotors::setSpeedLeftFromISR()>).
+void IRAM_ATTR VespaCommands::_checkTimeout(void *arg){
+  VespaCommands *commands = (VespaCommands *)arg;
+  if (commands->_motors == nullptr){
+    return;
+  }
+  if (commands->_expired.load(std::memory_order_relaxed)){
+    commands->_motors->stopFromISR(); // again
+    return;
+  }
+
+  uint32_t elapsed = VespaHAL::micros() - commands->_last_time.load(std::memory_order_relaxed);
+  if (elapsed >= commands->_timeout){
+    commands->_motors->stopFromISR();
+    commands->_expired.store(true, std::memory_order_relaxed);
+
+    // event
+    if (commands->_expired_queue != nullptr){
+      commands->_expired_queue->post(commands->_expired_delegate, elapsed / 1000);
+    } else {
+      commands->_expired_delegate.call(elapsed / 1000);
+    }
+  }
+}
+
+// --------------------------------------------------
+
+// Execute a decoded frame
+//  @param (frame) : the frame [uint8_t *]
+//         (size) : the size of the frame [size_t]
+void VespaCommands::_execute(uint8_t *frame, size_t size){
+  // check the CRC
+  if ((size < 4) || (VespaCodec::crc16(frame, size - 2) != (frame[size - 2] | (frame[size - 1] << 8)))){
+    this->_errors++;
+    return;
+  }
+  size -= 2; // without the CRC
+
+  // check the size of the arguments
+  uint8_t type = frame[0];
+  const uint8_t *arguments = &frame[2];
+  size_t expected;
+  switch (type){
+    case COMMAND_PING:
+    case COMMAND_MOTORS_STOP:
+    case COMMAND_BATTERY:
+      expected = 0;
+      break;
+    case COMMAND_MOTORS:
+      expected = 2;
+      break;
+    case COMMAND_SERVO:
+    case COMMAND_LED:
+      expected = 3;
+      break;
+    default:
+      this->_errors++;
+      return;
+  }
+  if (size - 2 != expected){
+    this->_errors++;
+    return;
+  }
+
+  // reset the deadman (before applying the command)
+  this->_last_time.store(VespaHAL::micros(), std::memory_order_relaxed);
+  this->_expired.store(false, std::memory_order_relaxed);
+  this->_received++;
+
+  // execute
+  switch (type){
+    case COMMAND_PING: {
+      uint8_t reply[] = { (uint8_t)(COMMAND_PING | COMMAND_REPLY), frame[1] };
+      this->_reply(reply, sizeof(reply));
+      break;
+    }
+
+    case COMMAND_MOTORS:
+      if (this->_motors != nullptr){
+        this->_motors->turn((int8_t)arguments[0], (int8_t)arguments[1]);
+      }
+      break;
+
+    case COMMAND_MOTORS_STOP:
+      if (this->_motors != nullptr){
+        this->_motors->stop();
+      }
+      break;
+
+    case COMMAND_SERVO:
+      if ((arguments[0] < VESPA_SERVO_QTY) && (this->_servos[arguments[0]] != nullptr)){
+        this->_servos[arguments[0]]->write(arguments[1] | (arguments[2] << 8));
+      }
+      break;
+
+    case COMMAND_LED:
+      if (this->_led != nullptr){
+        if (arguments[0] == COMMAND_LED_ON){
+          this->_led->on();
+        } else if (arguments[0] == COMMAND_LED_BLINK){
+          this->_led->blink(arguments[1] | (arguments[2] << 8));
+        } else {
+          this->_led->off();
+        }
+      }
+      break;
+
+    case COMMAND_BATTERY: {
+      uint32_t voltage = 0;
+      uint8_t capacity = 0;
+      if (this->_battery != nullptr){
+        voltage = this->_battery->readVoltage();
+        capacity = this->_battery->readCapacity();
+      }
+      uint8_t reply[] = { (uint8_t)(COMMAND_BATTERY | COMMAND_REPLY), frame[1],
+                          (uint8_t)(voltage & 0xFF), (uint8_t)(voltage >> 8), capacity };
+      this->_reply(reply, sizeof(reply));
+      break;
+    }
+  }
+}
+
+// --------------------------------------------------
+
+// Send a reply
+//  @param (data) : the reply, without the CRC [const uint8_t *]
+//         (size) : the size of the reply [size_t]
+//  Note: the reply is discarded if the output doesn't have enough space (never blocks).
+void VespaCommands::_reply(const uint8_t *data, size_t size){
+  uint8_t record[VESPA_COMMANDS_BUFFER_SIZE];
+  uint8_t frame[VESPA_COMMANDS_BUFFER_SIZE];
+
+  if (VespaCodec::maxEncodedSize(size + 2) + 1 > sizeof(frame)){
+    return; // too large (with the CRC and the delimiter)
+  }
+  memcpy(record, data, size);
+  uint16_t crc = VespaCodec::crc16(record, size);
+  record[size++] = crc & 0xFF;
+  record[size++] = crc >> 8;
+
+  size_t length = VespaCodec::encodeCOBS(record, size, frame);
+  frame[length++] = 0x00;
+
+  if (this->_stream.availableForWrite() >= (int)length){
+    this->_stream.write(frame, length);
+  }
+}
+
+// --------------------------------------------------
+
+// Start the timer of the deadman
+//  Note: the timer checks the time since the last valid frame 4 times per timeout.
+void VespaCommands::_startTimer(void){
+  if (this->_timer != nullptr){
+    VespaHAL::timerStop(this->_timer);
+    this->_timer = nullptr; // reset
+  }
+
+  if ((this->_timeout == 0) || (this->_motors == nullptr)){
+    return;
+  }
+
+  uint32_t period = this->_timeout / 4;
+  if (period < 1000){
+    period = 1000; // [us]
+  }
+
+  this->_last_time.store(VespaHAL::micros(), std::memory_order_relaxed);
+  this->_expired.store(false, std::memory_order_relaxed);
+  this->_timer = VespaHAL::timerStart(period, VespaCommands::_checkTimeout, this);
+}
+
+// --------------------------------------------------
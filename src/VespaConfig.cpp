@@ -0,0 +1,315 @@
+/*******************************************************************************
+* RoboCore Vespa Config Library
+* 
+* Calibration and settings of the board, stored in the flash.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+
+/*
+* The configuration is a single binary record (<VespaConfigData>), stored with
+* the name <VESPA_CONFIG_KEY> by <VespaHAL::storageWrite()> (NVS on the ESP32).
+* 
+* <begin()> reads the record directly into memory and checks, in order:
+*   - the size read (a record of another layout is rejected by the storage);
+*   - the version (<VESPA_CONFIG_VERSION>) and the size of the record;
+*   - the CRC-16 of the other members (see <VespaCodec::crc16()>).
+* If any check fails, the defaults of the library are used and <loaded()>
+* returns false. The record is only written by <save()>.
+* 
+* The values are applied to the drivers with <apply()>, usually in <setup()>
+* after <Vespa::begin()>. The servos are attached with their limits.
+*/
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+#include <stddef.h>
+#include <string.h>
+
+static_assert(sizeof(VespaConfigData) == (offsetof(VespaConfigData, crc) + sizeof(uint16_t)), "The configuration must not have padding after the CRC");
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Constructor
+//  Note: the record is read by <begin()>.
+VespaConfig::VespaConfig(void) :
+  _initialized(false),
+  _loaded(false)
+{
+  this->reset();
+
+  Vespa::add(this, VespaConfig::_begin, BEGIN_CONFIG);
+}
+
+// --------------------------------------------------
+
+// Destructor
+VespaConfig::~VespaConfig(void){
+  Vespa::remove(this);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Read the configuration from the storage
+//  @returns true, the defaults are used if the record is not valid [bool]
+//  Note: called on the first use if not called before (see <Vespa::begin()>).
+bool VespaConfig::begin(void){
+  if (this->_initialized){
+    return true;
+  }
+  this->_initialized = true;
+
+  // single read, directly into a copy of the record
+  VespaConfigData data;
+  if (!VespaHAL::storageRead(VESPA_CONFIG_KEY, &data, sizeof(data))){
+    return true; // not saved yet
+  }
+
+  // check the record
+  if ((data.version != VESPA_CONFIG_VERSION) || (data.size != sizeof(data)) || (data.crc != _crc(data))){
+    return true; // keep the defaults
+  }
+
+  this->_data = data;
+  this->_loaded = true;
+  return true;
+}
+
+// --------------------------------------------------
+
+// Check if the configuration was read from the storage
+//  @returns false if the defaults are used [bool]
+bool VespaConfig::loaded(void){
+  if (!this->_initialized){
+    this->begin(); // lazy initialization
+  }
+
+  return this->_loaded;
+}
+
+// --------------------------------------------------
+
+// Set the defaults of the library
+//  Note: the storage is not changed until <save()>.
+void VespaConfig::reset(void){
+  memset(&this->_data, 0, sizeof(this->_data)); // the padding too, for the CRC
+
+  this->_data.version = VESPA_CONFIG_VERSION;
+  this->_data.size = sizeof(this->_data);
+  this->_data.battery_conversion = VESPA_BATTERY_VOLTAGE_CONVERSION;
+  this->_data.button_debounce = VESPA_BUTTON_DEBOUNCE;
+  for (uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+    this->_data.servo_min[i] = VESPA_SERVO_PULSE_WIDTH_MIN;
+    this->_data.servo_max[i] = VESPA_SERVO_PULSE_WIDTH_MAX;
+  }
+  for (uint8_t i=0 ; i < VESPA_MOTORS_CALIBRATION_POINTS ; i++){
+    this->_data.motors.left[i] = (i * 10000UL) / (VESPA_MOTORS_CALIBRATION_POINTS - 1); // linear
+    this->_data.motors.right[i] = this->_data.motors.left[i];
+  }
+  this->_data.crc = _crc(this->_data);
+}
+
+// --------------------------------------------------
+
+// Write the configuration to the storage
+//  @returns true if successful [bool]
+//  Note: the record is written at once. If the write fails or is interrupted,
+//        the previous record is kept.
+bool VespaConfig::save(void){
+  if (!this->_initialized){
+    this->begin(); // don't overwrite the changes on the first use
+  }
+
+  this->_data.crc = _crc(this->_data);
+  return VespaHAL::storageWrite(VESPA_CONFIG_KEY, &this->_data, sizeof(this->_data));
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Apply the configuration to the battery
+//  @param (battery) : the battery [VespaBattery &]
+void VespaConfig::apply(VespaBattery &battery){
+  if (!this->_initialized){
+    this->begin(); // lazy initialization
+  }
+
+  battery.setConversion(this->_data.battery_conversion);
+}
+
+// --------------------------------------------------
+
+// Apply the configuration to the button
+//  @param (button) : the button [VespaButton &]
+void VespaConfig::apply(VespaButton &button){
+  if (!this->_initialized){
+    this->begin(); // lazy initialization
+  }
+
+  button.setDebounce(this->_data.button_debounce);
+}
+
+// --------------------------------------------------
+
+// Apply the configuration to the motors
+//  @param (motors) : the motors [VespaMotors &]
+//  Note: the default calibration resets the motors, so their duty cycles are
+//        the same as without a configuration.
+void VespaConfig::apply(VespaMotors &motors){
+  if (!this->_initialized){
+    this->begin(); // lazy initialization
+  }
+
+  // check if the calibration is linear (default)
+  bool linear = true;
+  for (uint8_t i=0 ; i < VESPA_MOTORS_CALIBRATION_POINTS ; i++){
+    uint16_t duty = (i * 10000UL) / (VESPA_MOTORS_CALIBRATION_POINTS - 1);
+    if ((this->_data.motors.left[i] != duty) || (this->_data.motors.right[i] != duty)){
+      linear = false;
+      break;
+    }
+  }
+
+  if (linear){
+    motors.resetCalibration();
+  } else {
+    motors.setCalibration(this->_data.motors);
+  }
+}
+
+// --------------------------------------------------
+
+// Attach a servo with the limits of the configuration
+//  @param (servo) : the servo [VespaServo &]
+//         (pin) : the pin to attach [uint8_t]
+//         (index) : the index of the limits (0 to VESPA_SERVO_QTY-1) [uint8_t]
+//  @returns true if the pin was attached [bool]
+bool VespaConfig::apply(VespaServo &servo, uint8_t pin, uint8_t index){
+  if (!this->_initialized){
+    this->begin(); // lazy initialization
+  }
+
+  if (index >= VESPA_SERVO_QTY){
+    return false;
+  }
+
+  return servo.attach(pin, this->_data.servo_min[index], this->_data.servo_max[index]);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Get the configuration
+//  @returns the values [const VespaConfigData &]
+const VespaConfigData & VespaConfig::get(void){
+  if (!this->_initialized){
+    this->begin(); // lazy initialization
+  }
+
+  return this->_data;
+}
+
+// --------------------------------------------------
+
+// Set the conversion of the voltage divider of the battery
+//  @param (conversion) : Vin/Vout (x1000), measured on the board [uint32_t]
+void VespaConfig::setBatteryConversion(uint32_t conversion){
+  if (!this->_initialized){
+    this->begin(); // don't overwrite the change on the first use
+  }
+
+  if (conversion > 0){
+    this->_data.battery_conversion = conversion;
+  }
+}
+
+// --------------------------------------------------
+
+// Set the debounce of the button
+//  @param (debounce) : the debounce [ms] [uint16_t]
+void VespaConfig::setDebounce(uint16_t debounce){
+  if (!this->_initialized){
+    this->begin(); // don't overwrite the change on the first use
+  }
+
+  this->_data.button_debounce = debounce;
+}
+
+// --------------------------------------------------
+
+// Set the calibration of the motors
+//  @param (calibration) : the calibration (e.g. from <VespaMotors::calibrate()>) [const VespaMotorsCalibration &]
+void VespaConfig::setMotorsCalibration(const VespaMotorsCalibration &calibration){
+  if (!this->_initialized){
+    this->begin(); // don't overwrite the change on the first use
+  }
+
+  this->_data.motors = calibration;
+}
+
+// --------------------------------------------------
+
+// Set the limits of the pulse width of a servo
+//  @param (index) : the index of the limits (0 to VESPA_SERVO_QTY-1) [uint8_t]
+//         (min) : the minimum pulse width [us] [uint16_t]
+//         (max) : the maximum pulse width [us] [uint16_t]
+//  @returns true if valid limits were given [bool]
+//  Note: the limits are constrained by the servo when attached.
+bool VespaConfig::setServoLimits(uint8_t index, uint16_t min, uint16_t max){
+  if (!this->_initialized){
+    this->begin(); // don't overwrite the change on the first use
+  }
+
+  if ((index >= VESPA_SERVO_QTY) || (min >= max)){
+    return false;
+  }
+
+  this->_data.servo_min[index] = min;
+  this->_data.servo_max[index] = max;
+  return true;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Initialize the configuration (called by <Vespa::begin()>)
+//  @param (object) : the configuration [VespaConfig *]
+//  @returns true if successful [bool]
+bool VespaConfig::_begin(void *object){
+  return static_cast<VespaConfig *>(object)->begin();
+}
+
+// --------------------------------------------------
+
+// Calculate the CRC of a record
+//  @param (data) : the record [const VespaConfigData &]
+//  @returns the CRC of all the members but the CRC [uint16_t]
+uint16_t VespaConfig::_crc(const VespaConfigData &data){
+  return VespaCodec::crc16(reinterpret_cast<const uint8_t *>(&data), offsetof(VespaConfigData, crc));
+}
+
+// --------------------------------------------------
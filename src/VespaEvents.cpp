@@ -0,0 +1,128 @@
+/*******************************************************************************
+* RoboCore Vespa Events Library
+* 
+* Deferred events of the Vespa library.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+// References
+//  - https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+static_assert((VESPA_EVENTS_QUEUE_SIZE >= 2) && ((VESPA_EVENTS_QUEUE_SIZE & (VESPA_EVENTS_QUEUE_SIZE - 1)) == 0), "The size of the event queue must be a power of 2");
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Constructor
+VespaEventQueue::VespaEventQueue(void) :
+  _head(0),
+  _tail(0),
+  _dropped(0)
+{
+  for(uint32_t i=0 ; i < VESPA_EVENTS_QUEUE_SIZE ; i++){
+    this->_entries[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Call the delegates of the pending events
+//  @param (max) : the maximum number of events to dispatch, to bound the time of the call [uint8_t]
+//  @returns the number of events dispatched [uint8_t]
+//  Note: call it from a single context (e.g. <loop()>). The events posted by the
+//        delegates are dispatched in the same call if <max> allows.
+uint8_t VespaEventQueue::dispatch(uint8_t max){
+  uint8_t count = 0;
+  while(count < max){
+    Entry & entry = this->_entries[this->_tail & _MASK];
+    if(entry.sequence.load(std::memory_order_acquire) != (this->_tail + 1)){
+      break; // empty (or the next event is still being posted)
+    }
+
+    // copy before releasing the entry to the producers
+    VespaDelegate delegate = entry.delegate;
+    uint32_t value = entry.value;
+    entry.sequence.store(this->_tail + VESPA_EVENTS_QUEUE_SIZE, std::memory_order_release);
+    this->_tail++;
+
+    delegate.call(value);
+    count++;
+  }
+  return count;
+}
+
+// --------------------------------------------------
+
+// Get the number of events dropped because the queue was full
+//  @returns the number of events [uint32_t]
+uint32_t VespaEventQueue::getDropped(void){
+  return this->_dropped.load(std::memory_order_relaxed);
+}
+
+// --------------------------------------------------
+
+// Check if there are events to dispatch
+//  @returns true if the next event is ready [bool]
+bool VespaEventQueue::pending(void){
+  const Entry & entry = this->_entries[this->_tail & _MASK];
+  return (entry.sequence.load(std::memory_order_acquire) == (this->_tail + 1));
+}
+
+// --------------------------------------------------
+
+// Post an event
+//  @param (delegate) : the delegate to call [const VespaDelegate &]
+//         (value) : the value of the event [uint32_t]
+//  @returns false if the queue is full [bool]
+//  Note: safe to call from interrupts and from any task or core (never waits for the consumer).
+bool IRAM_ATTR VespaEventQueue::post(const VespaDelegate &delegate, uint32_t value){
+  // reserve an entry
+  uint32_t position = this->_head.load(std::memory_order_relaxed);
+  Entry *entry;
+  while(true){
+    entry = &this->_entries[position & _MASK];
+    int32_t difference = (int32_t)(entry->sequence.load(std::memory_order_acquire) - position);
+    if(difference == 0){
+      if(this->_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)){
+        break; // reserved
+      }
+    } else if(difference < 0){
+      this->_dropped.fetch_add(1, std::memory_order_relaxed);
+      return false; // full
+    } else {
+      position = this->_head.load(std::memory_order_relaxed); // taken by another producer
+    }
+  }
+
+  // write and publish
+  entry->delegate = delegate;
+  entry->value = value;
+  entry->sequence.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+// --------------------------------------------------
@@ -0,0 +1,661 @@
+/*******************************************************************************
+* RoboCore Vespa HAL Library (ESP32)
+* 
+* Hardware abstraction layer of the Vespa library, for the ESP32.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+// References
+//  - https://docs.espressif.com/projects/arduino-esp32/en/latest/api/ledc.html
+//  - https://docs.espressif.com/projects/esp-idf/en/stable/esp32/api-reference/peripherals/ledc.html
+//  - https://docs.espressif.com/projects/esp-idf/en/stable/esp32/api-reference/peripherals/gpio.html
+//  - https://docs.espressif.com/projects/esp-idf/en/stable/esp32/api-reference/peripherals/rmt.html
+//  - https://docs.espressif.com/projects/esp-idf/en/stable/esp32/api-reference/system/sleep_modes.html
+//  - https://docs.espressif.com/projects/esp-idf/en/stable/esp32/api-reference/storage/nvs_flash.html
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+#if defined(ARDUINO_ESP32_DEV)
+
+extern "C" {
+  #include <esp32-hal-ledc.h>
+  #include <esp32-hal-periman.h>
+  #include <esp32-hal-timer.h>
+
+  #include <driver/gpio.h>
+  #include <driver/rmt_rx.h>
+  #include <driver/uart.h>
+  #include <esp_cpu.h>
+  #include <esp_rom_gpio.h>
+  #include <esp_sleep.h>
+  #include <esp_timer.h>
+  #include <hal/gpio_ll.h>
+  #include <hal/ledc_ll.h>
+  #include <nvs.h>
+  #include <soc/gpio_sig_map.h>
+  #include <soc/rtc.h>
+}
+
+// --------------------------------------------------
+// Macros
+
+#define VESPA_HAL_CAPTURE_QTY (8) // RMT channels of the ESP32
+#define VESPA_HAL_CAPTURE_SYMBOLS (16) // one pulse per reception, with margin for the noise
+#define VESPA_HAL_CAPTURE_FILTER (1000) // glitches ignored [ns]
+#define VESPA_HAL_CAPTURE_IDLE (3000000) // end of a reception, longer than any pulse [ns]
+#define VESPA_HAL_LEDC_CALIBRATION_CYCLES (100) // of RC_FAST/256, measured with the crystal (~3 ms)
+#define VESPA_HAL_LEDC_DIVIDER_FRACTION (8) // fractional bits of the divider of the timers
+#define VESPA_HAL_STORAGE_NAMESPACE "vespa" // NVS namespace of the records
+#define VESPA_HAL_TIMER_QTY (4) // hardware timers of the ESP32
+#define VESPA_HAL_UART_WAKEUP_THRESHOLD (3) // edges on RX to wake up (the first byte is lost)
+
+// --------------------------------------------------
+// Structures
+
+// Pulse capture with a RMT channel
+struct VespaHALCapture {
+  bool used;
+  rmt_channel_handle_t channel;
+  rmt_symbol_word_t symbols[VESPA_HAL_CAPTURE_SYMBOLS];
+  rmt_receive_config_t config;
+  void (*callback)(void *, uint32_t);
+  void *arg;
+};
+
+// --------------------------------------------------
+
+// Periodic timer
+struct VespaHALTimer {
+  hw_timer_t *timer;
+  uint32_t period; // [us]
+};
+
+// --------------------------------------------------
+// Variables
+
+static VespaHALCapture _captures[VESPA_HAL_CAPTURE_QTY];
+static std::atomic<uint16_t> _ledc_active(0); // bit mask of the channels with a duty cycle
+static std::atomic<uint16_t> _ledc_sleep(0); // bit mask of the channels clocked by RC_FAST
+static uint32_t _rc_fast_frequency = 0; // calibrated [Hz]
+static VespaHALTimer _timers[VESPA_HAL_TIMER_QTY];
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Reception of a RMT channel finished (interrupt)
+//  @param (channel) : the RMT channel [rmt_channel_handle_t]
+//         (data) : the symbols received [const rmt_rx_done_event_data_t *]
+//         (arg) : the capture [VespaHALCapture *]
+//  @returns false, no task was woken [bool]
+static bool IRAM_ATTR _captureDone(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t *data, void *arg){
+  VespaHALCapture *capture = (VespaHALCapture *)arg;
+
+  // the resolution is 1 MHz, so the durations are in [us]
+  for(size_t i=0 ; i < data->num_symbols ; i++){
+    const rmt_symbol_word_t & symbol = data->received_symbols[i];
+    if((symbol.level0 == 1) && (symbol.duration0 > 0)){
+      capture->callback(capture->arg, symbol.duration0);
+    }
+  }
+
+  // wait for the next pulse
+  rmt_receive(channel, capture->symbols, sizeof(capture->symbols), &capture->config);
+  return false;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Set the attenuation of an ADC pin
+//  @param (pin) : the pin [uint8_t]
+//         (attenuation) : the attenuation [adc_attenuation_t]
+void VespaHAL::analogSetPinAttenuation(uint8_t pin, adc_attenuation_t attenuation){
+  ::analogSetPinAttenuation(pin, attenuation);
+}
+
+// --------------------------------------------------
+
+// Read the calibrated voltage of an ADC pin
+//  @param (pin) : the pin [uint8_t]
+//  @returns the voltage (in mV) [uint32_t]
+uint32_t VespaHAL::analogReadMilliVolts(uint8_t pin){
+  return ::analogReadMilliVolts(pin);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Read the level of a pin
+//  @param (pin) : the pin [uint8_t]
+//  @returns HIGH or LOW [int]
+int VespaHAL::digitalRead(uint8_t pin){
+  return ::digitalRead(pin);
+}
+
+// --------------------------------------------------
+
+// Set the level of a pin
+//  @param (pin) : the pin [uint8_t]
+//         (level) : HIGH or LOW [uint8_t]
+void VespaHAL::digitalWrite(uint8_t pin, uint8_t level){
+  ::digitalWrite(pin, level);
+}
+
+// --------------------------------------------------
+
+// Set the mode of a pin
+//  @param (pin) : the pin [uint8_t]
+//         (mode) : the mode (e.g. INPUT, OUTPUT) [uint8_t]
+void VespaHAL::pinMode(uint8_t pin, uint8_t mode){
+  ::pinMode(pin, mode);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Attach a pin to a LEDC channel selected automatically
+//  @param (pin) : the pin [uint8_t]
+//         (frequency) : the frequency of the PWM [Hz] [uint32_t]
+//         (resolution) : the resolution of the PWM [bits] [uint8_t]
+//  @returns true if successful [bool]
+bool VespaHAL::ledcAttach(uint8_t pin, uint32_t frequency, uint8_t resolution){
+  return ::ledcAttach(pin, frequency, resolution);
+}
+
+// --------------------------------------------------
+
+// Attach a pin to a LEDC channel
+//  @param (pin) : the pin [uint8_t]
+//         (frequency) : the frequency of the PWM [Hz] [uint32_t]
+//         (resolution) : the resolution of the PWM [bits] [uint8_t]
+//         (channel) : the LEDC channel (0-15) [uint8_t]
+//  @returns true if successful [bool]
+bool VespaHAL::ledcAttachChannel(uint8_t pin, uint32_t frequency, uint8_t resolution, uint8_t channel){
+  return ::ledcAttachChannel(pin, frequency, resolution, channel);
+}
+
+// --------------------------------------------------
+
+// Attach a pin to a LEDC channel that keeps running in light sleep
+//  @param (pin) : the pin [uint8_t]
+//         (frequency) : the frequency of the PWM [Hz] [uint32_t]
+//         (resolution) : the resolution of the PWM [bits] [uint8_t]
+//         (channel) : the LEDC channel, of the low speed group (8-15) [uint8_t]
+//  @returns true if successful [bool]
+//  Note: the channel is attached by the Arduino core, then its timer is clocked from
+//        RC_FAST (RTC8M), with the divider calculated from its frequency calibrated
+//        against the crystal (once, on the first call, e.g. in <begin()> of the drivers).
+//        RC_FAST is the slow clock of the whole low speed group, so the channels 12
+//        and 13 (timer 2) must not be attached by the core after this call.
+//  Note: with a channel of the high speed group or without <VESPA_PWM_SLEEP_CLOCK>,
+//        the channel is clocked by the APB and blocks the light sleep (see <ledcCanSleep()>).
+bool VespaHAL::ledcAttachSleep(uint8_t pin, uint32_t frequency, uint8_t resolution, uint8_t channel){
+  if(!::ledcAttachChannel(pin, frequency, resolution, channel)){
+    return false;
+  }
+
+  ledc_mode_t group = (ledc_mode_t)(channel / 8);
+  if(!VESPA_PWM_SLEEP_CLOCK || (group != LEDC_LOW_SPEED_MODE)){
+    return true; // APB
+  }
+
+  // calibrate RC_FAST
+  if(_rc_fast_frequency == 0){
+    rtc_clk_8m_enable(true, true); // with the divider by 256, for the calibration
+    uint32_t period = rtc_clk_cal(RTC_CAL_8MD256, VESPA_HAL_LEDC_CALIBRATION_CYCLES); // of RC_FAST/256 [us] (Q19)
+    if(period == 0){
+      return true; // APB
+    }
+    _rc_fast_frequency = (uint32_t)((256ULL * (1000000ULL << RTC_CLK_CAL_FRACT)) / period);
+  }
+
+  // divider of the timer
+  uint64_t divider = ((uint64_t)_rc_fast_frequency << VESPA_HAL_LEDC_DIVIDER_FRACTION) / ((uint64_t)frequency << resolution);
+  if((divider < (1 << VESPA_HAL_LEDC_DIVIDER_FRACTION)) || (divider >= (1UL << 18))){
+    return true; // APB (out of the range of the divider)
+  }
+
+  ledc_timer_t timer = (ledc_timer_t)((channel / 2) % 4); // as the Arduino core
+  ledc_ll_set_slow_clk_sel(&LEDC, LEDC_SLOW_CLK_RC_FAST);
+  ledc_ll_set_clock_source(&LEDC, group, timer, LEDC_SCLK);
+  ledc_ll_set_clock_divider(&LEDC, group, timer, (uint32_t)divider);
+  ledc_ll_ls_timer_update(&LEDC, group, timer);
+  _ledc_sleep.fetch_or(1 << channel, std::memory_order_relaxed);
+
+  return true;
+}
+
+// --------------------------------------------------
+
+// Detach a pin from the LEDC
+//  @param (pin) : the pin [uint8_t]
+//  @returns true if successful [bool]
+bool VespaHAL::ledcDetach(uint8_t pin){
+  uint8_t channel = VespaHAL::ledcGetChannel(pin);
+  if(channel < 16){
+    _ledc_active.fetch_and(~(1 << channel), std::memory_order_relaxed);
+    _ledc_sleep.fetch_and(~(1 << channel), std::memory_order_relaxed);
+  }
+  return ::ledcDetach(pin);
+}
+
+// --------------------------------------------------
+
+// Get the LEDC channel attached to a pin
+//  @param (pin) : the pin [uint8_t]
+//  @returns the channel, or 0xFF if the pin is not attached [uint8_t]
+uint8_t VespaHAL::ledcGetChannel(uint8_t pin){
+  ledc_channel_handle_t *bus = (ledc_channel_handle_t *)perimanGetPinBus(pin, ESP32_BUS_TYPE_LEDC);
+  if(bus == nullptr){
+    return 0xFF;
+  }
+  return bus->channel;
+}
+
+// --------------------------------------------------
+
+// Check if a LEDC channel is generating a PWM signal
+//  @returns true if a channel has a duty cycle [bool]
+//  Note: the channels are tracked by <ledcWriteChannel()> and <ledcDetach()>.
+bool VespaHAL::ledcActive(void){
+  return (_ledc_active.load(std::memory_order_relaxed) != 0);
+}
+
+// --------------------------------------------------
+
+// Check if the PWM outputs keep running in light sleep
+//  @returns true if all the channels with a duty cycle are clocked by RC_FAST [bool]
+//  Note: see <ledcAttachSleep()>.
+bool VespaHAL::ledcCanSleep(void){
+  return ((_ledc_active.load(std::memory_order_relaxed) & ~_ledc_sleep.load(std::memory_order_relaxed)) == 0);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Route a GPIO to the output signal of a LEDC channel
+//  @param (pin) : the pin to route [uint8_t]
+//         (channel) : the LEDC channel (0-15) [uint8_t]
+//  Note: the channel must have been configured before (e.g. with <ledcAttachChannel()>).
+void IRAM_ATTR VespaHAL::ledcConnect(uint8_t pin, uint8_t channel){
+  uint32_t signal = (channel < 8) ? LEDC_HS_SIG_OUT0_IDX : LEDC_LS_SIG_OUT0_IDX;
+  signal += channel % 8;
+  esp_rom_gpio_connect_out_signal(pin, signal, false, false); // ROM function
+}
+
+// --------------------------------------------------
+
+// Disconnect a GPIO from any peripheral and drive it LOW
+//  @param (pin) : the pin to disconnect [uint8_t]
+void IRAM_ATTR VespaHAL::ledcDisconnect(uint8_t pin){
+  gpio_ll_set_level(&GPIO, (gpio_num_t)pin, 0); // set the level before releasing the pin
+  esp_rom_gpio_connect_out_signal(pin, SIG_GPIO_OUT_IDX, false, false); // ROM function
+}
+
+// --------------------------------------------------
+
+// Set the phase of a LEDC channel (the tick of the period where the output goes high)
+//  @param (channel) : the LEDC channel (0-15) [uint8_t]
+//         (hpoint) : the phase, in ticks of the channel resolution [uint32_t]
+//  Note: the output goes low at (hpoint + duty), so the sum must not exceed the
+//        maximum duty cycle, otherwise the output stays high.
+//  Note: applied with the next duty cycle written (<ledcWriteChannel()>).
+void IRAM_ATTR VespaHAL::ledcSetPhase(uint8_t channel, uint32_t hpoint){
+  ledc_mode_t group = (ledc_mode_t)(channel / 8);
+  ledc_channel_t index = (ledc_channel_t)(channel % 8);
+
+  ledc_ll_set_hpoint(&LEDC, group, index, hpoint);
+}
+
+// --------------------------------------------------
+
+// Write the duty cycle of a LEDC channel
+//  @param (channel) : the LEDC channel (0-15) [uint8_t]
+//         (duty) : the duty cycle, in ticks of the channel resolution [uint32_t]
+//  Note: no range check is done. To have the output always on, use (2^resolution).
+void IRAM_ATTR VespaHAL::ledcWriteChannel(uint8_t channel, uint32_t duty){
+  ledc_mode_t group = (ledc_mode_t)(channel / 8);
+  ledc_channel_t index = (ledc_channel_t)(channel % 8);
+
+  // the fade parameters were already set when the channel was configured
+  ledc_ll_set_duty_int_part(&LEDC, group, index, duty);
+  ledc_ll_set_duty_start(&LEDC, group, index, true);
+  ledc_ll_ls_channel_update(&LEDC, group, index); // only for the low speed channels
+
+  if(duty > 0){
+    _ledc_active.fetch_or(1 << channel, std::memory_order_relaxed);
+  } else {
+    _ledc_active.fetch_and(~(1 << channel), std::memory_order_relaxed);
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Start the capture of the pulses of a pin
+//  @param (pin) : the pin [uint8_t]
+//         (callback) : the function to call with the width of each high pulse [us], in IRAM [void (*)(void *, uint32_t)]
+//         (arg) : the argument of the callback [void *]
+//  @returns the handle of the capture, or null if not available [void *]
+//  Note: a RMT channel measures the pulses, so there is no busy waiting and the
+//        resolution is 1 us. The callback is called from an interrupt, when the
+//        line is idle for <VESPA_HAL_CAPTURE_IDLE> after the pulse.
+void * VespaHAL::captureStart(uint8_t pin, void (*callback)(void *, uint32_t), void *arg){
+  if(callback == nullptr){
+    return nullptr;
+  }
+
+  // find a free capture
+  VespaHALCapture *capture = nullptr;
+  for(uint8_t i=0 ; i < VESPA_HAL_CAPTURE_QTY ; i++){
+    if(!_captures[i].used){
+      capture = &_captures[i];
+      break;
+    }
+  }
+  if(capture == nullptr){
+    return nullptr;
+  }
+
+  // configure the RMT channel
+  rmt_rx_channel_config_t channel_config = {};
+  channel_config.gpio_num = (gpio_num_t)pin;
+  channel_config.clk_src = RMT_CLK_SRC_DEFAULT;
+  channel_config.resolution_hz = 1000000; // 1 MHz (1 tick per [us])
+  channel_config.mem_block_symbols = 64; // one block
+  if(rmt_new_rx_channel(&channel_config, &capture->channel) != ESP_OK){
+    return nullptr;
+  }
+
+  rmt_rx_event_callbacks_t callbacks = {};
+  callbacks.on_recv_done = _captureDone;
+  capture->callback = callback;
+  capture->arg = arg;
+  capture->config.signal_range_min_ns = VESPA_HAL_CAPTURE_FILTER;
+  capture->config.signal_range_max_ns = VESPA_HAL_CAPTURE_IDLE;
+  if((rmt_rx_register_event_callbacks(capture->channel, &callbacks, capture) != ESP_OK) ||
+      (rmt_enable(capture->channel) != ESP_OK)){
+    rmt_del_channel(capture->channel);
+    return nullptr;
+  }
+  if(rmt_receive(capture->channel, capture->symbols, sizeof(capture->symbols), &capture->config) != ESP_OK){
+    rmt_disable(capture->channel);
+    rmt_del_channel(capture->channel);
+    return nullptr;
+  }
+
+  capture->used = true;
+  return capture;
+}
+
+// --------------------------------------------------
+
+// Stop the capture of the pulses of a pin
+//  @param (capture) : the handle returned by <captureStart()> [void *]
+void VespaHAL::captureStop(void *capture){
+  VespaHALCapture *handle = (VespaHALCapture *)capture;
+  if((handle != nullptr) && handle->used){
+    rmt_disable(handle->channel);
+    rmt_del_channel(handle->channel);
+    handle->used = false;
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Get the core that is running the code
+//  @returns the ID of the core (0-1) [uint8_t]
+uint8_t IRAM_ATTR VespaHAL::coreID(void){
+  return xPortGetCoreID();
+}
+
+// --------------------------------------------------
+
+// Check if the code is running in an interrupt
+//  @returns true if called from an interrupt (e.g. a timer or a capture) [bool]
+bool IRAM_ATTR VespaHAL::inInterrupt(void){
+  return xPortInIsrContext();
+}
+
+// --------------------------------------------------
+
+// Enter light sleep
+//  @param (duration) : the maximum time to sleep [us] [uint32_t]
+//         (pin) : the pin that wakes up on a change of level, or <VESPA_POWER_NONE> [uint8_t]
+//         (uart) : true to wake up when <Serial> receives data [bool]
+//  @returns the source of the wake-up [VespaWakeup]
+//  Note: the hardware timers and the LEDC channels clocked by the APB stop during
+//        the sleep. The counters of the timers are advanced by the time slept, so
+//        they keep their period. The channels clocked by RC_FAST keep running, so
+//        RC_FAST stays powered while they have a duty cycle (see <ledcAttachSleep()>).
+//        The data that wakes up the UART is lost.
+VespaWakeup VespaHAL::lightSleep(uint32_t duration, uint8_t pin, bool uart){
+  uart_wait_tx_idle_polling(UART_NUM_0); // the pending bytes would be corrupted
+
+  // keep the PWM outputs running (RTC8M domain)
+  bool outputs = (_ledc_active.load(std::memory_order_relaxed) & _ledc_sleep.load(std::memory_order_relaxed)) != 0;
+  esp_sleep_pd_config(ESP_PD_DOMAIN_RC_FAST, outputs ? ESP_PD_OPTION_ON : ESP_PD_OPTION_AUTO);
+
+  // configure the sources
+  esp_sleep_enable_timer_wakeup(duration);
+  if(pin != VESPA_POWER_NONE){
+    gpio_wakeup_enable((gpio_num_t)pin, (::digitalRead(pin) == HIGH) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+  }
+  if(uart){
+    uart_set_wakeup_threshold(UART_NUM_0, VESPA_HAL_UART_WAKEUP_THRESHOLD);
+    esp_sleep_enable_uart_wakeup(UART_NUM_0);
+  }
+
+  uint64_t counts[VESPA_HAL_TIMER_QTY];
+  for(uint8_t i=0 ; i < VESPA_HAL_TIMER_QTY ; i++){
+    counts[i] = (_timers[i].timer != nullptr) ? ::timerRead(_timers[i].timer) : 0;
+  }
+
+  // sleep (<esp_timer_get_time()> is corrected with the RTC)
+  int64_t start = esp_timer_get_time();
+  esp_light_sleep_start();
+  uint64_t slept = esp_timer_get_time() - start;
+
+  // restore
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+  if(pin != VESPA_POWER_NONE){
+    gpio_wakeup_disable((gpio_num_t)pin);
+  }
+  for(uint8_t i=0 ; i < VESPA_HAL_TIMER_QTY ; i++){
+    if(_timers[i].timer != nullptr){
+      uint64_t count = counts[i] + slept;
+      if(count >= _timers[i].period){
+        count = _timers[i].period - 1; // call as soon as possible
+      }
+      if(::timerRead(_timers[i].timer) < count){
+        ::timerWrite(_timers[i].timer, count);
+      }
+    }
+  }
+
+  switch(esp_sleep_get_wakeup_cause()){
+    case ESP_SLEEP_WAKEUP_TIMER:
+      return WAKEUP_TIMER;
+    case ESP_SLEEP_WAKEUP_UART:
+      return WAKEUP_UART;
+    case ESP_SLEEP_WAKEUP_GPIO:
+      return WAKEUP_GPIO;
+    default:
+      return WAKEUP_NONE;
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Read a record from the storage
+//  @param (key) : the name of the record (up to 15 characters) [const char *]
+//         (data) : the buffer [void *]
+//         (size) : the size of the record [bytes] [size_t]
+//  @returns true if the record exists and has this size [bool]
+//  Note: the NVS flash is initialized by the Arduino core.
+bool VespaHAL::storageRead(const char *key, void *data, size_t size){
+  nvs_handle_t handle;
+  if(nvs_open(VESPA_HAL_STORAGE_NAMESPACE, NVS_READONLY, &handle) != ESP_OK){
+    return false; // nothing written yet
+  }
+
+  size_t length = size;
+  esp_err_t result = nvs_get_blob(handle, key, data, &length); // fails if the record is larger
+  nvs_close(handle);
+  return (result == ESP_OK) && (length == size);
+}
+
+// --------------------------------------------------
+
+// Write a record to the storage
+//  @param (key) : the name of the record (up to 15 characters) [const char *]
+//         (data) : the record [const void *]
+//         (size) : the size of the record [bytes] [size_t]
+//  @returns true if successful [bool]
+//  Note: the NVS erases the previous record only after the new one is written,
+//        so a reset during the write keeps the previous record.
+bool VespaHAL::storageWrite(const char *key, const void *data, size_t size){
+  nvs_handle_t handle;
+  if(nvs_open(VESPA_HAL_STORAGE_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK){
+    return false;
+  }
+
+  esp_err_t result = nvs_set_blob(handle, key, data, size);
+  if(result == ESP_OK){
+    result = nvs_commit(handle);
+  }
+  nvs_close(handle);
+  return (result == ESP_OK);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Start a periodic timer
+//  @param (period) : the period [us] [uint32_t]
+//         (callback) : the function to call, in IRAM [void (*)(void *)]
+//         (arg) : the argument of the callback [void *]
+//  @returns the handle of the timer, or null if not available [void *]
+//  Note: the callback is called from an interrupt.
+void * VespaHAL::timerStart(uint32_t period, void (*callback)(void *), void *arg){
+  hw_timer_t *timer = ::timerBegin(1000000); // 1 MHz (1 tick per [us])
+  if (timer == nullptr){
+    return nullptr;
+  }
+
+  ::timerAttachInterruptArg(timer, callback, arg);
+  ::timerAlarm(timer, period, true, 0); // auto reload, unlimited
+
+  // store the period for <timerNext()>
+  for(uint8_t i=0 ; i < VESPA_HAL_TIMER_QTY ; i++){
+    if(_timers[i].timer == nullptr){
+      _timers[i].timer = timer;
+      _timers[i].period = period;
+      break;
+    }
+  }
+  return timer;
+}
+
+// --------------------------------------------------
+
+// Get the time until the next call of a timer
+//  @returns the time, or 0xFFFFFFFF if no timer is running [us] [uint32_t]
+uint32_t VespaHAL::timerNext(void){
+  uint32_t next = 0xFFFFFFFF;
+  for(uint8_t i=0 ; i < VESPA_HAL_TIMER_QTY ; i++){
+    if(_timers[i].timer != nullptr){
+      uint32_t count = ::timerRead(_timers[i].timer); // reset to 0 by the alarm
+      uint32_t remaining = (count < _timers[i].period) ? (_timers[i].period - count) : 0;
+      if(remaining < next){
+        next = remaining;
+      }
+    }
+  }
+  return next;
+}
+
+// --------------------------------------------------
+
+// Stop a timer
+//  @param (timer) : the handle returned by <timerStart()> [void *]
+void VespaHAL::timerStop(void *timer){
+  if (timer != nullptr){
+    for(uint8_t i=0 ; i < VESPA_HAL_TIMER_QTY ; i++){
+      if(_timers[i].timer == timer){
+        _timers[i].timer = nullptr; // reset
+      }
+    }
+    ::timerEnd((hw_timer_t *)timer);
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Read the cycle counter of the CPU
+//  @returns the number of cycles [uint32_t]
+//  Note: the counter overflows, but the difference between two readings is valid.
+uint32_t IRAM_ATTR VespaHAL::cycles(void){
+  return esp_cpu_get_cycle_count();
+}
+
+// --------------------------------------------------
+
+// Get the frequency of the cycle counter
+//  @returns the number of cycles per [us] [uint32_t]
+uint32_t VespaHAL::cyclesPerMicrosecond(void){
+  return getCpuFrequencyMhz();
+}
+
+// --------------------------------------------------
+
+// Wait for some time
+//  @param (duration) : the time to wait [ms] [uint32_t]
+void VespaHAL::delay(uint32_t duration){
+  ::delay(duration);
+}
+
+// --------------------------------------------------
+
+// Get the time since the boot
+//  @returns the time [us] [uint32_t]
+uint32_t IRAM_ATTR VespaHAL::micros(void){
+  return ::micros();
+}
+
+// --------------------------------------------------
+
+// Get the time since the boot
+//  @returns the time [ms] [uint32_t]
+uint32_t IRAM_ATTR VespaHAL::millis(void){
+  return ::millis();
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+#endif // ARDUINO_ESP32_DEV
@@ -41,37 +41,63 @@ VespaLED::VespaLED(void) :
 
 // Constructor
 //  @param (pin) : the pin assigned to the LED [uint8_t]
+//  Note: the pin is configured by <begin()>.
 VespaLED::VespaLED(uint8_t pin) :
   _pin(pin),
   _state(LOW),
-  _stop_time(0)
+  _initialized(false),
+  _stop_time(0),
+  _delay(0)
 {
-  // configure the pin
-  pinMode(this->_pin, OUTPUT);
-  digitalWrite(this->_pin, this->_state);
+  Vespa::add(this, VespaLED::_begin, BEGIN_OUTPUTS);
 }
 
 // --------------------------------------------------
 
 // Destructor
 VespaLED::~VespaLED(void){
+  Vespa::remove(this);
+
   // set the pin as input
-  pinMode(this->_pin, INPUT);
+  if (this->_initialized){
+    VespaHAL::pinMode(this->_pin, INPUT);
+  }
 }
 
 // --------------------------------------------------
 // --------------------------------------------------
 
+// Configure the pin
+//  @returns true if successful [bool]
+//  Note: called on the first write if not called before (see <Vespa::begin()>).
+bool VespaLED::begin(void){
+  if (this->_initialized){
+    return true;
+  }
+
+  // configure the pin
+  VespaHAL::pinMode(this->_pin, OUTPUT);
+  VespaHAL::digitalWrite(this->_pin, this->_state);
+
+  this->_initialized = true;
+  return true;
+}
+
+// --------------------------------------------------
+
 // Set the LED to blink
 //  @param (duration) : the delay for the blink [ms] [uint32_t]
 //  Note: the method <update()> must be called to check and toggle the state of the pin.
 void VespaLED::blink(uint32_t duration){
+  VESPA_TRACE(TRACE_LED_BLINK, duration);
+  VESPA_RECORD(TRACE_LED_BLINK, duration);
+
   this->_delay = duration;
 
   if (this->_delay == 0){
     this->_stop_time = 0; // reset
   } else {
-    this->_stop_time = millis() + this->_delay;
+    this->_stop_time = VespaHAL::millis() + this->_delay;
   }
 }
 
@@ -79,24 +105,41 @@ void VespaLED::blink(uint32_t duration){
 
 // Turn the LED on
 void VespaLED::on(void){
+  VESPA_TRACE(TRACE_LED_ON, 0);
+  VESPA_RECORD(TRACE_LED_ON, 0);
+
+  if (!this->_initialized){
+    this->begin(); // lazy initialization
+  }
+
   this->_stop_time = 0; // reset
   this->_state = HIGH;
-  digitalWrite(this->_pin, this->_state);
+  VespaHAL::digitalWrite(this->_pin, this->_state);
 }
 
 // --------------------------------------------------
 
 // Turn the LED off
 void VespaLED::off(void){
+  VESPA_TRACE(TRACE_LED_OFF, 0);
+  VESPA_RECORD(TRACE_LED_OFF, 0);
+
+  if (!this->_initialized){
+    this->begin(); // lazy initialization
+  }
+
   this->_stop_time = 0; // reset
   this->_state = LOW;
-  digitalWrite(this->_pin, this->_state);
+  VespaHAL::digitalWrite(this->_pin, this->_state);
 }
 
 // --------------------------------------------------
 
 // Toggle the state of the LED
 void VespaLED::toggle(void){
+  VESPA_TRACE(TRACE_LED_TOGGLE, 0);
+  VESPA_RECORD(TRACE_LED_TOGGLE, 0);
+
   if (this->_state == LOW){
     this->on();
   } else {
@@ -108,16 +151,28 @@ void VespaLED::toggle(void){
 
 // Update the state of the pin (when blinking)
 void VespaLED::update(void){
+  VESPA_TRACE(TRACE_LED_UPDATE, 0);
+  VESPA_RECORD_MUTE(); // the toggles are replayed by <update()>
+
   // check the stop time
   if (this->_stop_time == 0){
     return;
   }
 
-  if (millis() >= this->_stop_time){
+  if (VespaHAL::millis() >= this->_stop_time){
     this->toggle(); // update the LED
-    this->_stop_time = millis() + this->_delay; // update the stop time
+    this->_stop_time = VespaHAL::millis() + this->_delay; // update the stop time
   }
 }
 
 // --------------------------------------------------
 // --------------------------------------------------
+
+// Initialize a LED (see <Vespa::add()>)
+//  @param (object) : the LED [VespaLED *]
+//  @returns true if successful [bool]
+bool VespaLED::_begin(void *object){
+  return ((VespaLED *)object)->begin();
+}
+
+// --------------------------------------------------
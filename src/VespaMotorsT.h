@@ -0,0 +1,745 @@
+#ifndef VESPA_MOTORS_T_H
+#define VESPA_MOTORS_T_H
+
+/*******************************************************************************
+* RoboCore Vespa Motors Library
+* 
+* Library to use the motors of the Vespa board.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+// References
+//  - https://docs.espressif.com/projects/arduino-esp32/en/latest/api/ledc.html
+//  - https://docs.espressif.com/projects/esp-idf/en/stable/esp32/api-reference/peripherals/gpio.html (GPIO matrix)
+
+// Note: this file is included by <RoboCore_Vespa.h> and must not be included directly.
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Constructor
+//  Note: the pins and the PWM are configured by <begin()>.
+template <class Board>
+VespaMotorsT<Board>::VespaMotorsT(void) :
+  _initialized(false),
+  _active_pin_A(Board::MOTORS_PIN_A1),
+  _active_pin_B(Board::MOTORS_PIN_B1),
+  _pwmA(0),
+  _pwmB(0)
+{
+  // default to linear
+  this->resetCalibration();
+
+  // default to stopped
+  this->_posted.left = 0;
+  this->_posted.right = 0;
+
+  Vespa::add(this, VespaMotorsT::_begin, BEGIN_OUTPUTS);
+}
+
+// --------------------------------------------------
+
+// Destructor
+template <class Board>
+VespaMotorsT<Board>::~VespaMotorsT(void){
+  Vespa::remove(this);
+  if(!this->_initialized){
+    return; // nothing to release
+  }
+
+  // route the channels back to the pins attached to the LEDC
+  this->stop();
+  this->_attachPin(Board::MOTORS_PIN_A1);
+  this->_attachPin(Board::MOTORS_PIN_B1);
+
+  // detach the pins from the PWM
+  VespaHAL::ledcDetach(Board::MOTORS_PIN_A1);
+  VespaHAL::ledcDetach(Board::MOTORS_PIN_B1);
+
+  // set all pins as inputs
+  VespaHAL::pinMode(Board::MOTORS_PIN_A1, INPUT);
+  VespaHAL::pinMode(Board::MOTORS_PIN_A2, INPUT);
+  VespaHAL::pinMode(Board::MOTORS_PIN_B1, INPUT);
+  VespaHAL::pinMode(Board::MOTORS_PIN_B2, INPUT);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Configure the pins and the PWM
+//  @returns true if successful [bool]
+//  Note: called on the first command if not called before (see <Vespa::begin()>).
+//        It must be called before using the <FromISR()> methods.
+template <class Board>
+bool VespaMotorsT<Board>::begin(void){
+  if(this->_initialized){
+    return true;
+  }
+
+  // turn the backward pins off (routed to the PWM only when moving backwards)
+  VespaHAL::pinMode(Board::MOTORS_PIN_A2, OUTPUT);
+  VespaHAL::pinMode(Board::MOTORS_PIN_B2, OUTPUT);
+  VespaHAL::digitalWrite(Board::MOTORS_PIN_A2, LOW);
+  VespaHAL::digitalWrite(Board::MOTORS_PIN_B2, LOW);
+
+  // configure the PWM (the forward pins are configured by the LEDC driver)
+  if(!this->_configurePWM()){
+    return false;
+  }
+  this->_initialized = true;
+
+  // default to stopped
+  this->stop();
+  return true;
+}
+
+// --------------------------------------------------
+
+// Set the motors to move backwards
+//  @param (speed) : the speed of the motor (0-100) [uint8_t]
+template <class Board>
+void VespaMotorsT<Board>::backward(uint8_t speed){
+  VESPA_TRACE(TRACE_MOTORS_BACKWARD, speed);
+  VESPA_RECORD(TRACE_MOTORS_BACKWARD, speed);
+
+  if(!this->_initialized){
+    this->begin(); // lazy initialization
+  }
+
+  // constrain the value
+  if(speed > 100){
+    speed = 100;
+  }
+
+  // update the directions
+  this->_attachPin(Board::MOTORS_PIN_A2);
+  this->_attachPin(Board::MOTORS_PIN_B2);
+
+  this->_pwmA = this->_duties[VespaMotorsT::LEFT][speed]; // transform to the current configuration
+  this->_pwmB = this->_duties[VespaMotorsT::RIGHT][speed];
+  this->_writeDuty(Board::MOTORS_CHANNEL_A, this->_pwmA); // update
+  this->_writeDuty(Board::MOTORS_CHANNEL_B, this->_pwmB); // update
+}
+
+// --------------------------------------------------
+
+// Set the motors to move forwards
+//  @param (speed) : the speed of the motor (0-100%) [uint8_t]
+template <class Board>
+void VespaMotorsT<Board>::forward(uint8_t speed){
+  VESPA_TRACE(TRACE_MOTORS_FORWARD, speed);
+  VESPA_RECORD(TRACE_MOTORS_FORWARD, speed);
+
+  if(!this->_initialized){
+    this->begin(); // lazy initialization
+  }
+
+  // constrain the value
+  if(speed > 100){
+    speed = 100;
+  }
+
+  // update the directions
+  this->_attachPin(Board::MOTORS_PIN_A1);
+  this->_attachPin(Board::MOTORS_PIN_B1);
+
+  this->_pwmA = this->_duties[VespaMotorsT::LEFT][speed]; // transform to the current configuration
+  this->_pwmB = this->_duties[VespaMotorsT::RIGHT][speed];
+  this->_writeDuty(Board::MOTORS_CHANNEL_A, this->_pwmA); // update
+  this->_writeDuty(Board::MOTORS_CHANNEL_B, this->_pwmB); // update
+}
+
+// --------------------------------------------------
+
+// Set the left motor speed
+//  @param (speed) : the speed of the motor (-100-100%) [int8_t]
+template <class Board>
+void VespaMotorsT<Board>::setSpeedLeft(int8_t speed){
+  VESPA_TRACE(TRACE_MOTORS_SET_SPEED_LEFT, (uint8_t)speed);
+  VESPA_RECORD(TRACE_MOTORS_SET_SPEED_LEFT, (uint8_t)speed);
+
+  if(!this->_initialized){
+    this->begin(); // lazy initialization
+  }
+
+  this->_setSpeedLeft(speed);
+}
+
+// --------------------------------------------------
+
+// Set the right motor speed
+//  @param (speed) : the speed of the motor (-100-100%) [int8_t]
+template <class Board>
+void VespaMotorsT<Board>::setSpeedRight(int8_t speed){
+  VESPA_TRACE(TRACE_MOTORS_SET_SPEED_RIGHT, (uint8_t)speed);
+  VESPA_RECORD(TRACE_MOTORS_SET_SPEED_RIGHT, (uint8_t)speed);
+
+  if(!this->_initialized){
+    this->begin(); // lazy initialization
+  }
+
+  this->_setSpeedRight(speed);
+}
+
+// --------------------------------------------------
+
+// Stop both motors
+template <class Board>
+void VespaMotorsT<Board>::stop(void){
+  VESPA_TRACE(TRACE_MOTORS_STOP, 0);
+  VESPA_RECORD(TRACE_MOTORS_STOP, 0);
+
+  if(!this->_initialized){
+    this->begin(); // lazy initialization
+  }
+
+  this->stopFromISR();
+}
+
+// --------------------------------------------------
+
+// Set the motors to turn
+//  @param (speedA) : the speed of the left motor (-100-100%) [int8_t]
+//         (speedB) : the speed of the right motor (-100-100%) [int8_t]
+//  Note: a negative value sets the motor to move backwards
+template <class Board>
+void VespaMotorsT<Board>::turn(int8_t speedA, int8_t speedB){
+  VESPA_TRACE(TRACE_MOTORS_TURN, (uint8_t)speedA | ((uint8_t)speedB << 8));
+  VESPA_RECORD(TRACE_MOTORS_TURN, (uint8_t)speedA | ((uint8_t)speedB << 8));
+
+  // update both speeds (the values and the directions are automatically constrained)
+  this->setSpeedLeft(speedA);
+  this->setSpeedRight(speedB);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Get the duty cycle of the left motor
+//  @returns the duty cycle, negative when moving backwards [int32_t]
+template <class Board>
+int32_t IRAM_ATTR VespaMotorsT<Board>::getDutyLeft(void){
+  int32_t duty = this->_pwmA;
+  return (this->_active_pin_A == Board::MOTORS_PIN_A1) ? duty : -duty;
+}
+
+// --------------------------------------------------
+
+// Get the duty cycle of the right motor
+//  @returns the duty cycle, negative when moving backwards [int32_t]
+template <class Board>
+int32_t IRAM_ATTR VespaMotorsT<Board>::getDutyRight(void){
+  int32_t duty = this->_pwmB;
+  return (this->_active_pin_B == Board::MOTORS_PIN_B1) ? duty : -duty;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Calibrate the motors with a measure of their speed (e.g. encoders)
+//  @param (calibration) : the calibration calculated [VespaMotorsCalibration &]
+//         (read) : the function to read the position of a motor (e.g. the count of
+//                  an encoder), called with <LEFT> or <RIGHT> and the context [int32_t (*)(uint8_t, void *)]
+//         (context) : the argument of the function [void *]
+//         (settle) : the time to settle and to measure each duty cycle [ms] [uint16_t]
+//  @returns false if a motor didn't move [bool]
+//  Note: blocking, both motors move forward for 2 * <settle> * <VESPA_MOTORS_CALIBRATION_STEPS>,
+//        so keep the wheels off the ground. The calibration is applied if successful.
+//  Note: the maximum speed of both motors is the one of the slowest motor, so that
+//        the same speed results in the same movement.
+template <class Board>
+bool VespaMotorsT<Board>::calibrate(VespaMotorsCalibration &calibration, int32_t (*read)(uint8_t, void *), void *context, uint16_t settle){
+  if((read == nullptr) || !this->begin()){
+    return false;
+  }
+
+  // measure the speed of each duty cycle
+  int32_t speeds[2][VESPA_MOTORS_CALIBRATION_STEPS + 1];
+  speeds[VespaMotorsT::LEFT][0] = 0;
+  speeds[VespaMotorsT::RIGHT][0] = 0;
+  this->_attachPin(Board::MOTORS_PIN_A1);
+  this->_attachPin(Board::MOTORS_PIN_B1);
+  for(uint8_t step=1 ; step <= VESPA_MOTORS_CALIBRATION_STEPS ; step++){
+    uint16_t duty = ((uint32_t)step * _MAX_DUTY_CYCLE) / VESPA_MOTORS_CALIBRATION_STEPS;
+    this->_pwmA = duty; // reported by <getDutyLeft()> (e.g. telemetry)
+    this->_pwmB = duty;
+    this->_writeDuty(Board::MOTORS_CHANNEL_A, this->_pwmA);
+    this->_writeDuty(Board::MOTORS_CHANNEL_B, this->_pwmB);
+    VespaHAL::delay(settle);
+
+    int32_t left = read(VespaMotorsT::LEFT, context);
+    int32_t right = read(VespaMotorsT::RIGHT, context);
+    VespaHAL::delay(settle);
+    left = read(VespaMotorsT::LEFT, context) - left;
+    right = read(VespaMotorsT::RIGHT, context) - right;
+    speeds[VespaMotorsT::LEFT][step] = (left >= 0) ? left : -left; // the encoders might count backwards
+    speeds[VespaMotorsT::RIGHT][step] = (right >= 0) ? right : -right;
+  }
+  this->stopFromISR();
+
+  // match the motors
+  int32_t max_speed = speeds[VespaMotorsT::LEFT][VESPA_MOTORS_CALIBRATION_STEPS];
+  if(speeds[VespaMotorsT::RIGHT][VESPA_MOTORS_CALIBRATION_STEPS] < max_speed){
+    max_speed = speeds[VespaMotorsT::RIGHT][VESPA_MOTORS_CALIBRATION_STEPS];
+  }
+  if(max_speed <= 0){
+    return false;
+  }
+
+  // find the duty cycle of each point
+  for(uint8_t motor=0 ; motor < 2 ; motor++){
+    uint16_t *points = (motor == VespaMotorsT::LEFT) ? calibration.left : calibration.right;
+    const int32_t *speed = speeds[motor];
+    uint8_t step = 1;
+    for(uint8_t i=0 ; i < VESPA_MOTORS_CALIBRATION_POINTS ; i++){
+      // the first point is the first movement (1% of the speed)
+      int32_t target = (i == 0) ? ((max_speed + 99) / 100) : ((max_speed * i) / (VESPA_MOTORS_CALIBRATION_POINTS - 1));
+      while((step < VESPA_MOTORS_CALIBRATION_STEPS) && (speed[step] < target)){
+        step++;
+      }
+
+      // interpolate between the steps (in 0.01%), except for the first movement (static friction)
+      int32_t delta = speed[step] - speed[step - 1];
+      int32_t offset = ((i > 0) && (delta > 0)) ? (((target - speed[step - 1]) * 100) / delta) : 100;
+      if(offset < 0){
+        offset = 0;
+      }
+      if(offset > 100){
+        offset = 100;
+      }
+      uint32_t value = ((step - 1) * 10000UL + offset * 100UL) / VESPA_MOTORS_CALIBRATION_STEPS;
+      if((i > 0) && (value < points[i - 1])){
+        value = points[i - 1]; // monotonic
+      }
+      points[i] = value;
+    }
+  }
+
+  this->setCalibration(calibration);
+  return true;
+}
+
+// --------------------------------------------------
+
+// Get the current calibration
+//  @param (calibration) : the calibration [VespaMotorsCalibration &]
+template <class Board>
+void VespaMotorsT<Board>::getCalibration(VespaMotorsCalibration &calibration){
+  calibration = this->_calibration;
+}
+
+// --------------------------------------------------
+
+// Reset the calibration (linear, without deadband)
+template <class Board>
+void VespaMotorsT<Board>::resetCalibration(void){
+  VESPA_TRACE(TRACE_MOTORS_SET_CALIBRATION, 0);
+
+  for(uint8_t i=0 ; i < VESPA_MOTORS_CALIBRATION_POINTS ; i++){
+    this->_calibration.left[i] = (i * 10000UL) / (VESPA_MOTORS_CALIBRATION_POINTS - 1);
+    this->_calibration.right[i] = this->_calibration.left[i];
+  }
+
+  // same duty cycles as before the calibration existed
+  for(uint8_t speed=0 ; speed <= 100 ; speed++){
+    this->_duties[VespaMotorsT::LEFT][speed] = this->_toDuty(speed);
+    this->_duties[VespaMotorsT::RIGHT][speed] = this->_duties[VespaMotorsT::LEFT][speed];
+  }
+}
+
+// --------------------------------------------------
+
+// Set the calibration
+//  @param (calibration) : the calibration (e.g. from <calibrate()>) [const VespaMotorsCalibration &]
+//  Note: the table of the duty cycles is built here, so that setting a speed is a single lookup.
+//        Don't call it while the motors are updated by an interrupt.
+template <class Board>
+void VespaMotorsT<Board>::setCalibration(const VespaMotorsCalibration &calibration){
+  VESPA_TRACE(TRACE_MOTORS_SET_CALIBRATION, 1);
+
+  this->_calibration = calibration;
+
+  for(uint8_t motor=0 ; motor < 2 ; motor++){
+    const uint16_t *points = (motor == VespaMotorsT::LEFT) ? calibration.left : calibration.right;
+    this->_duties[motor][0] = 0; // stopped
+    for(uint8_t speed=1 ; speed <= 100 ; speed++){
+      // position between the points (in 1/100)
+      uint16_t position = speed * (VESPA_MOTORS_CALIBRATION_POINTS - 1);
+      uint8_t index = position / 100;
+      uint8_t fraction = position % 100;
+      uint32_t value = (uint32_t)points[index] * (100 - fraction); // [0.0001%]
+      if(index < (VESPA_MOTORS_CALIBRATION_POINTS - 1)){
+        value += (uint32_t)points[index + 1] * fraction;
+      }
+      if(value > 1000000){
+        value = 1000000; // constrain
+      }
+      this->_duties[motor][speed] = ((uint64_t)value * _MAX_DUTY_CYCLE + 500000) / 1000000;
+    }
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+// Apply the latest setpoint posted to the mailbox
+//  @returns true if a new setpoint was applied [bool]
+//  Note: call it periodically from the context that owns the motors (e.g. <loop()>),
+//        which must be the only one to call the other methods directly.
+template <class Board>
+bool VespaMotorsT<Board>::applyPending(void){
+  VESPA_TRACE(TRACE_MOTORS_APPLY_PENDING, 0);
+
+  VespaMotorsSetpoint setpoint;
+  if(!this->_mailbox.fetch(setpoint)){
+    return false;
+  }
+
+  // apply both speeds at once
+  if((setpoint.left == 0) && (setpoint.right == 0)){
+    this->stop();
+  } else {
+    this->turn(setpoint.left, setpoint.right);
+  }
+
+  return true;
+}
+
+// --------------------------------------------------
+
+// Post the speed of both motors to the mailbox
+//  @param (left) : the speed of the left motor (-100-100%) [int8_t]
+//         (right) : the speed of the right motor (-100-100%) [int8_t]
+//  Note: safe to call from another task or core, as long as there is a single producer.
+//        The setpoint is applied on the next call to <applyPending()>.
+template <class Board>
+void VespaMotorsT<Board>::post(int8_t left, int8_t right){
+  VESPA_TRACE(TRACE_MOTORS_POST, (uint8_t)left | ((uint8_t)right << 8));
+
+  this->_posted.left = left;
+  this->_posted.right = right;
+  this->_mailbox.post(this->_posted);
+}
+
+// --------------------------------------------------
+
+// Post the speed of the left motor to the mailbox
+//  @param (speed) : the speed of the motor (-100-100%) [int8_t]
+//  Note: the right motor keeps the last speed posted.
+template <class Board>
+void VespaMotorsT<Board>::postLeft(int8_t speed){
+  VESPA_TRACE(TRACE_MOTORS_POST_LEFT, (uint8_t)speed);
+
+  this->post(speed, this->_posted.right);
+}
+
+// --------------------------------------------------
+
+// Post the speed of the right motor to the mailbox
+//  @param (speed) : the speed of the motor (-100-100%) [int8_t]
+//  Note: the left motor keeps the last speed posted.
+template <class Board>
+void VespaMotorsT<Board>::postRight(int8_t speed){
+  VESPA_TRACE(TRACE_MOTORS_POST_RIGHT, (uint8_t)speed);
+
+  this->post(this->_posted.left, speed);
+}
+
+// --------------------------------------------------
+
+// Post a stop command to the mailbox
+template <class Board>
+void VespaMotorsT<Board>::postStop(void){
+  VESPA_TRACE(TRACE_MOTORS_POST_STOP, 0);
+
+  this->post(0, 0);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Set the left motor speed from an interrupt
+//  @param (speed) : the speed of the motor (-100-100%) [int8_t]
+//  Note: the same object must not be updated simultaneously by an interrupt and
+//        a task, because the direction and the duty cycle are written separately.
+template <class Board>
+void IRAM_ATTR VespaMotorsT<Board>::setSpeedLeftFromISR(int8_t speed){
+  VESPA_TRACE(TRACE_MOTORS_SET_SPEED_LEFT_ISR, (uint8_t)speed);
+  VESPA_RECORD(TRACE_MOTORS_SET_SPEED_LEFT_ISR, (uint8_t)speed);
+
+  if(!this->_initialized){
+    return; // see <begin()>
+  }
+
+  this->_setSpeedLeft(speed);
+}
+
+// --------------------------------------------------
+
+// Set the right motor speed from an interrupt
+//  @param (speed) : the speed of the motor (-100-100%) [int8_t]
+//  Note: see <setSpeedLeftFromISR()>.
+template <class Board>
+void IRAM_ATTR VespaMotorsT<Board>::setSpeedRightFromISR(int8_t speed){
+  VESPA_TRACE(TRACE_MOTORS_SET_SPEED_RIGHT_ISR, (uint8_t)speed);
+  VESPA_RECORD(TRACE_MOTORS_SET_SPEED_RIGHT_ISR, (uint8_t)speed);
+
+  if(!this->_initialized){
+    return; // see <begin()>
+  }
+
+  this->_setSpeedRight(speed);
+}
+
+// --------------------------------------------------
+
+// Stop both motors from an interrupt
+template <class Board>
+void IRAM_ATTR VespaMotorsT<Board>::stopFromISR(void){
+  VESPA_TRACE(TRACE_MOTORS_STOP_ISR, 0);
+  VESPA_RECORD(TRACE_MOTORS_STOP_ISR, 0);
+
+  if(!this->_initialized){
+    return; // see <begin()>
+  }
+
+  this->_pwmA = 0; // reset
+  this->_pwmB = 0; // reset
+
+  VespaHAL::ledcWriteChannel(Board::MOTORS_CHANNEL_A, this->_pwmA); // update
+  VespaHAL::ledcWriteChannel(Board::MOTORS_CHANNEL_B, this->_pwmB); // update
+}
+
+// --------------------------------------------------
+
+// Set the motors to turn from an interrupt
+//  @param (speedA) : the speed of the left motor (-100-100%) [int8_t]
+//         (speedB) : the speed of the right motor (-100-100%) [int8_t]
+//  Note: see <setSpeedLeftFromISR()>.
+template <class Board>
+void IRAM_ATTR VespaMotorsT<Board>::turnFromISR(int8_t speedA, int8_t speedB){
+  VESPA_TRACE(TRACE_MOTORS_TURN_ISR, (uint8_t)speedA | ((uint8_t)speedB << 8));
+  VESPA_RECORD(TRACE_MOTORS_TURN_ISR, (uint8_t)speedA | ((uint8_t)speedB << 8));
+
+  if(!this->_initialized){
+    return; // see <begin()>
+  }
+
+  this->_setSpeedLeft(speedA);
+  this->_setSpeedRight(speedB);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Attach a pin to the active PWM channel
+//  @param (pin) : the new pin to attach [uint8_t]
+//  @returns true if successful [bool]
+//  Note: the current active pin is then set to LOW.
+//  Note: only the GPIO matrix is updated, so it is safe to call from an interrupt.
+template <class Board>
+bool IRAM_ATTR VespaMotorsT<Board>::_attachPin(uint8_t pin){
+  // check if is already the active pin
+  if((pin == this->_active_pin_A) || (pin == this->_active_pin_B)){
+    return false;
+  }
+
+  // Note: the previous pin is released before connecting the new one, so that
+  //       both inputs of the H-bridge never receive the PWM at the same time.
+
+  // motor A
+  if((pin == Board::MOTORS_PIN_A1) || (pin == Board::MOTORS_PIN_A2)){
+    VespaHAL::ledcDisconnect(this->_active_pin_A);
+    VespaHAL::ledcConnect(pin, Board::MOTORS_CHANNEL_A);
+    this->_active_pin_A = pin;
+    return true;
+  }
+  // motor B
+  if((pin == Board::MOTORS_PIN_B1) || (pin == Board::MOTORS_PIN_B2)){
+    VespaHAL::ledcDisconnect(this->_active_pin_B);
+    VespaHAL::ledcConnect(pin, Board::MOTORS_CHANNEL_B);
+    this->_active_pin_B = pin;
+    return true;
+  }
+
+  return false;
+}
+
+// --------------------------------------------------
+
+// Initialize the motors (see <Vespa::add()>)
+//  @param (object) : the motors [VespaMotorsT *]
+//  @returns true if successful [bool]
+template <class Board>
+bool VespaMotorsT<Board>::_begin(void *object){
+  return ((VespaMotorsT *)object)->begin();
+}
+
+// --------------------------------------------------
+
+// Configure the PWM channels
+//  @returns true if successful [bool]
+//  Note: the pins are detached if unsuccessful.
+template <class Board>
+bool VespaMotorsT<Board>::_configurePWM(void){
+  // set the default active pins
+  this->_active_pin_A = Board::MOTORS_PIN_A1;
+  this->_active_pin_B = Board::MOTORS_PIN_B1;
+
+  // Note: in Arduino ESP v3.0, the LEDC API has the <ledcAttach()> function
+  //       which selects the channel automatically. This functions doesn't
+  //       work properly with the motors because the pins are frequently
+  //       attached and detached from the channels. The solution is to
+  //       use fixed channels, but it might interfere with other devices
+  //       that use the API.
+  //       The channels are attached only once, to the forward pins. The
+  //       direction is then changed in the GPIO matrix (see <_attachPin()>).
+  //       The channels keep running in light sleep (see <VESPA_PWM_SLEEP_CLOCK>).
+
+  // attach the pins
+  uint8_t attached = 0x00;
+  attached |= (VespaHAL::ledcAttachSleep(Board::MOTORS_PIN_A1, Board::MOTORS_PWM_FREQUENCY, Board::MOTORS_PWM_RESOLUTION, Board::MOTORS_CHANNEL_A)) ? 0x01 : 0x00;
+  attached |= (VespaHAL::ledcAttachSleep(Board::MOTORS_PIN_B1, Board::MOTORS_PWM_FREQUENCY, Board::MOTORS_PWM_RESOLUTION, Board::MOTORS_CHANNEL_B)) ? 0x02 : 0x00;
+
+  if (attached == 0x03){
+    return true;
+  } else {
+    if (attached & 0x01){
+      VespaHAL::ledcDetach(Board::MOTORS_PIN_A1);
+    }
+    if (attached & 0x02){
+      VespaHAL::ledcDetach(Board::MOTORS_PIN_B1);
+    }
+
+    return false;
+  }
+}
+
+// --------------------------------------------------
+
+// Set the direction of the left motor
+//  @param (direction) : the direction of the motor (0-1) [uint8_t]
+template <class Board>
+void IRAM_ATTR VespaMotorsT<Board>::_setDirectionLeft(uint8_t direction){
+  if(direction == VespaMotorsT::FORWARD){
+    this->_attachPin(Board::MOTORS_PIN_A1);
+  } else {
+    this->_attachPin(Board::MOTORS_PIN_A2);
+  }
+}
+
+// --------------------------------------------------
+
+// Set the direction of the right motor
+//  @param (direction) : the direction of the motor (0-1) [uint8_t]
+template <class Board>
+void IRAM_ATTR VespaMotorsT<Board>::_setDirectionRight(uint8_t direction){
+  if(direction == VespaMotorsT::FORWARD){
+    this->_attachPin(Board::MOTORS_PIN_B1);
+  } else {
+    this->_attachPin(Board::MOTORS_PIN_B2);
+  }
+}
+
+// --------------------------------------------------
+
+// Set the left motor speed (common to the normal and ISR paths)
+//  @param (speed) : the speed of the motor (-100-100%) [int8_t]
+template <class Board>
+void IRAM_ATTR VespaMotorsT<Board>::_setSpeedLeft(int8_t speed){
+  // update the directions
+  // (use a wider type, because -128 can't be inverted in an <int8_t>)
+  int16_t value = speed;
+  if(value >= 0){
+    this->_setDirectionLeft(VespaMotorsT::FORWARD);
+  } else {
+    value *= -1; // update
+    this->_setDirectionLeft(VespaMotorsT::BACKWARD);
+  }
+
+  // constrain the value
+  if(value > 100){
+    value = 100;
+  }
+
+  this->_pwmA = this->_duties[VespaMotorsT::LEFT][value]; // transform to the current configuration
+  this->_writeDuty(Board::MOTORS_CHANNEL_A, this->_pwmA); // update
+}
+
+// --------------------------------------------------
+
+// Set the right motor speed (common to the normal and ISR paths)
+//  @param (speed) : the speed of the motor (-100-100%) [int8_t]
+template <class Board>
+void IRAM_ATTR VespaMotorsT<Board>::_setSpeedRight(int8_t speed){
+  // update the directions
+  // (use a wider type, because -128 can't be inverted in an <int8_t>)
+  int16_t value = speed;
+  if(value >= 0){
+    this->_setDirectionRight(VespaMotorsT::FORWARD);
+  } else {
+    value *= -1; // update
+    this->_setDirectionRight(VespaMotorsT::BACKWARD);
+  }
+
+  // constrain the value
+  if(value > 100){
+    value = 100;
+  }
+
+  this->_pwmB = this->_duties[VespaMotorsT::RIGHT][value]; // transform to the current configuration
+  this->_writeDuty(Board::MOTORS_CHANNEL_B, this->_pwmB); // update
+}
+
+// --------------------------------------------------
+
+// Convert a speed to a duty cycle
+//  @param (speed) : the speed of the motor (0-100%) [uint8_t]
+//  @returns the duty cycle for the current resolution [uint16_t]
+//  Note: same result as <map(speed, 0, 100, 0, max_duty_cycle)>, without the division.
+//        The scale is calculated at compile time.
+template <class Board>
+uint16_t IRAM_ATTR VespaMotorsT<Board>::_toDuty(uint8_t speed){
+  return (uint16_t)((speed * _DUTY_SCALE) >> 16);
+}
+
+// --------------------------------------------------
+
+// Write a duty cycle to a channel
+//  @param (channel) : the LEDC channel [uint8_t]
+//         (duty) : the duty cycle (0-max_duty_cycle) [uint16_t]
+//  Note: like <ledcWrite()>, the maximum duty cycle keeps the output always on.
+//  Note: the pulse of the right motor is aligned to the end of the period (see <VESPA_PWM_STAGGER>),
+//        so both pulses only overlap when the sum of the duty cycles exceeds 100%.
+template <class Board>
+void IRAM_ATTR VespaMotorsT<Board>::_writeDuty(uint8_t channel, uint16_t duty){
+  uint32_t value = duty;
+  if(value >= _MAX_DUTY_CYCLE){
+    value = _MAX_DUTY_CYCLE + 1; // full on
+  }
+  if(VESPA_PWM_STAGGER && (channel == Board::MOTORS_CHANNEL_B)){
+    VespaHAL::ledcSetPhase(channel, (value > _MAX_DUTY_CYCLE) ? 0 : (_MAX_DUTY_CYCLE - value)); // applied with the duty cycle
+  }
+  VespaHAL::ledcWriteChannel(channel, value);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+#endif // VESPA_MOTORS_T_H
@@ -0,0 +1,170 @@
+/*******************************************************************************
+* RoboCore Vespa Power Library
+* 
+* Tickless light sleep between the ticks of the application.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+/*
+* <sleepUntil()> is called at the end of <loop()> with the time of the next
+* tick of the application. The wait ends at the first deadline among:
+*   - the tick of the application;
+*   - the next call of the hardware timers of the library (<VespaHAL::timerNext()>);
+* minus <VESPA_POWER_WAKEUP_TIME>, so the code runs before the deadline.
+* 
+* The CPU enters light sleep when the wait is at least <VESPA_POWER_SLEEP_MIN>
+* and every running PWM output is clocked by RC_FAST (the motors and the servos,
+* see <VespaHAL::ledcAttachSleep()>), because the APB clock stops in light
+* sleep. RC_FAST is kept powered while they run. It wakes up on the deadline, on data received
+* by <Serial> or on a change of the wake-up pin (the button by default).
+* Otherwise, the CPU waits in <delay()>, which lets the idle task gate its
+* clock, for at most <VESPA_POWER_WAKEUP_TIME>, so the latency is the same.
+* 
+* The latency of the wake-ups by the timer (time after the planned wake-up) is
+* measured in <getMaxLatency()>.
+*/
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Constructor
+//  Note: wakes up on the button and on <Serial> by default.
+VespaPower::VespaPower(void) :
+  _queue(nullptr),
+  _wakeup_pin(VESPA_BUTTON_PIN),
+  _wakeup_serial(true),
+  _wakeup(WAKEUP_NONE),
+  _wakeups(0),
+  _max_latency(0),
+  _sleep_time(0)
+{
+  // nothing to do
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Add an event queue, to not sleep while it has events
+//  @param (queue) : the queue [VespaEventQueue &]
+void VespaPower::attach(VespaEventQueue &queue){
+  this->_queue = &queue;
+}
+
+// --------------------------------------------------
+
+// Get the maximum latency of the wake-ups by the timer
+//  @returns the time after the planned wake-up [us] [uint32_t]
+uint32_t VespaPower::getMaxLatency(void){
+  return this->_max_latency;
+}
+
+// --------------------------------------------------
+
+// Get the total time in light sleep
+//  @returns the time [ms] [uint32_t]
+uint32_t VespaPower::getSleepTime(void){
+  return this->_sleep_time / 1000;
+}
+
+// --------------------------------------------------
+
+// Get the source of the last wake-up from light sleep
+//  @returns the source [VespaWakeup]
+VespaWakeup VespaPower::getWakeup(void){
+  return this->_wakeup;
+}
+
+// --------------------------------------------------
+
+// Get the number of wake-ups from light sleep
+//  @returns the number of wake-ups [uint32_t]
+uint32_t VespaPower::getWakeups(void){
+  return this->_wakeups;
+}
+
+// --------------------------------------------------
+
+// Set the pin that wakes up on a change of level
+//  @param (pin) : the pin, or <VESPA_POWER_NONE> to disable [uint8_t]
+void VespaPower::setWakeupPin(uint8_t pin){
+  this->_wakeup_pin = pin;
+}
+
+// --------------------------------------------------
+
+// Set if the data received by <Serial> wakes up
+//  @param (enabled) : true to wake up [bool]
+//  Note: on the ESP32, the data that wakes up the UART is lost.
+void VespaPower::setWakeupSerial(bool enabled){
+  this->_wakeup_serial = enabled;
+}
+
+// --------------------------------------------------
+
+// Wait until a deadline, in light sleep if possible
+//  @param (deadline) : the time of the next tick of the application (see <micros()>) [us] [uint32_t]
+//  @returns the mode used [VespaPowerMode]
+//  Note: returns before the deadline on a wake-up source or on the next call of
+//        a timer, so call it again in the next <loop()>.
+//  Note: light sleep is only used when every LEDC channel with a duty cycle is
+//        clocked by RC_FAST, even if its pin is not routed (see <VespaHAL::ledcCanSleep()>).
+VespaPowerMode VespaPower::sleepUntil(uint32_t deadline){
+  uint32_t now = VespaHAL::micros();
+  int32_t remaining = deadline - now;
+  if ((remaining <= VESPA_POWER_WAKEUP_TIME) || ((this->_queue != nullptr) && this->_queue->pending())){
+    return POWER_ACTIVE;
+  }
+
+  // first deadline
+  uint32_t wait = remaining - VESPA_POWER_WAKEUP_TIME;
+  uint32_t timer = VespaHAL::timerNext();
+  if (timer <= VESPA_POWER_WAKEUP_TIME){
+    return POWER_ACTIVE;
+  } else if ((timer - VESPA_POWER_WAKEUP_TIME) < wait){
+    wait = timer - VESPA_POWER_WAKEUP_TIME;
+  }
+
+  // wait with the PWM outputs running
+  if ((wait < VESPA_POWER_SLEEP_MIN) || !VespaHAL::ledcCanSleep()){
+    uint32_t duration = (wait < VESPA_POWER_WAKEUP_TIME) ? wait : VESPA_POWER_WAKEUP_TIME;
+    VespaHAL::delay((duration < 1000) ? 1 : (duration / 1000)); // [ms]
+    return POWER_IDLE;
+  }
+
+  // light sleep
+  this->_wakeup = VespaHAL::lightSleep(wait, this->_wakeup_pin, this->_wakeup_serial);
+  uint32_t elapsed = VespaHAL::micros() - now;
+  this->_wakeups++;
+  this->_sleep_time += elapsed;
+  if ((this->_wakeup == WAKEUP_TIMER) && (elapsed > wait) && ((elapsed - wait) > this->_max_latency)){
+    this->_max_latency = elapsed - wait;
+  }
+
+  return POWER_LIGHT_SLEEP;
+}
+
+// --------------------------------------------------
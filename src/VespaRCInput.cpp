@@ -0,0 +1,345 @@
+/*******************************************************************************
+* RoboCore Vespa RC Input Library
+* 
+* Pulse widths of a RC receiver, measured by the hardware of the ESP32.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+/*
+* Each channel measures the high pulses of a pin with a RMT channel (see
+* <VespaHAL::captureStart()>). The pulses out of <VESPA_RC_INPUT_WIDTH_MIN> and
+* <VESPA_RC_INPUT_WIDTH_MAX> are discarded as noise. The valid pulses are
+* written directly from the interrupt to the servo and to the motors passed
+* through, so the latency is the idle time of the RMT after the falling edge
+* (about 3 ms), instead of the period of <loop()>.
+* 
+* A timer checks the time of the last valid pulse of each channel. When it is
+* older than the timeout, the channel is lost: the motors passed through are
+* stopped and <onLost()> is raised once with the index of the channel. The
+* servos hold their position. The next valid pulse restores the channel, and
+* the motors are driven again when both of their channels are restored.
+*/
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Constructor
+//  @param (timeout) : the time without pulses to consider a channel lost, or 0 to disable it [ms] [uint32_t]
+//  Note: the timer is started when the first channel is attached.
+VespaRCInput::VespaRCInput(uint32_t timeout) :
+  _motors(nullptr),
+  _motors_left(0),
+  _motors_right(0),
+  _timer(nullptr),
+  _timeout(timeout * 1000),
+  _lost(0xFF),
+  _lost_queue(nullptr)
+{
+  for (uint8_t i=0 ; i < VESPA_RC_INPUT_CHANNELS ; i++){
+    Channel &channel = this->_channels[i];
+    channel.owner = this;
+    channel.index = i;
+    channel.pin = 0;
+    channel.capture = nullptr;
+    channel.width.store(0, std::memory_order_relaxed);
+    channel.time.store(0, std::memory_order_relaxed);
+    channel.servo = nullptr;
+  }
+}
+
+// --------------------------------------------------
+
+// Destructor
+VespaRCInput::~VespaRCInput(void){
+  if (this->_timer != nullptr){
+    VespaHAL::timerStop(this->_timer);
+  }
+  for (uint8_t i=0 ; i < VESPA_RC_INPUT_CHANNELS ; i++){
+    this->detach(i);
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Attach a pin to a channel
+//  @param (index) : the index of the channel (0-7) [uint8_t]
+//         (pin) : the pin connected to the output of the receiver [uint8_t]
+//  @returns true if the pin was attached [bool]
+//  Note: the pin must be one of the servo pins of the board (see <VespaBoard>).
+//        The channel is not connected until the first valid pulse.
+bool VespaRCInput::attach(uint8_t index, uint8_t pin){
+  if ((index >= VESPA_RC_INPUT_CHANNELS) || !VespaServo::isValidPin(pin)){
+    return false;
+  }
+  this->detach(index); // reset
+
+  Channel &channel = this->_channels[index];
+  channel.pin = pin;
+  channel.width.store(0, std::memory_order_relaxed);
+  channel.time.store(VespaHAL::micros(), std::memory_order_relaxed);
+  channel.capture = VespaHAL::captureStart(pin, VespaRCInput::_capture, &channel);
+  if (channel.capture == nullptr){
+    return false;
+  }
+
+  if (this->_timer == nullptr){
+    this->_startTimer();
+  }
+  return true;
+}
+
+// --------------------------------------------------
+
+// Check if a channel receives valid pulses
+//  @param (index) : the index of the channel (0-7) [uint8_t]
+//  @returns true if a valid pulse was received within the timeout [bool]
+bool VespaRCInput::connected(uint8_t index){
+  if (index >= VESPA_RC_INPUT_CHANNELS){
+    return false;
+  }
+  return (this->_channels[index].capture != nullptr) && !(this->_lost.load(std::memory_order_relaxed) & (1 << index));
+}
+
+// --------------------------------------------------
+
+// Detach the pin of a channel
+//  @param (index) : the index of the channel (0-7) [uint8_t]
+//  Note: the servo and the motors passed through the channel are released (the
+//        motors are stopped).
+void VespaRCInput::detach(uint8_t index){
+  if (index >= VESPA_RC_INPUT_CHANNELS){
+    return;
+  }
+
+  Channel &channel = this->_channels[index];
+  if (channel.capture != nullptr){
+    VespaHAL::captureStop(channel.capture);
+    channel.capture = nullptr; // reset
+  }
+  this->_lost.fetch_or(1 << index, std::memory_order_relaxed);
+  channel.servo = nullptr; // reset
+
+  if ((this->_motors != nullptr) && ((index == this->_motors_left) || (index == this->_motors_right))){
+    VespaMotors *motors = this->_motors;
+    this->_motors = nullptr; // reset
+    motors->stop();
+  }
+}
+
+// --------------------------------------------------
+
+// Set the event raised when a channel is lost
+//  @param (delegate) : the function to call with the index of the channel [const VespaDelegate &]
+//         (queue) : the queue to post the event, or null to call the delegate from the interrupt of the timer [VespaEventQueue *]
+void VespaRCInput::onLost(const VespaDelegate &delegate, VespaEventQueue *queue){
+  this->_lost_delegate = delegate;
+  this->_lost_queue = queue;
+}
+
+// --------------------------------------------------
+
+// Pass the pulses of a channel through to a servo
+//  @param (index) : the index of the channel (0-7) [uint8_t]
+//         (servo) : the servo [VespaServo &]
+//  @returns false if the index is invalid [bool]
+//  Note: the pulse width is written from the interrupt (see <VespaServo::writeFromISR()>).
+bool VespaRCInput::passThrough(uint8_t index, VespaServo &servo){
+  if (index >= VESPA_RC_INPUT_CHANNELS){
+    return false;
+  }
+  this->_channels[index].servo = &servo;
+  return true;
+}
+
+// --------------------------------------------------
+
+// Pass the pulses of two channels through to the motors
+//  @param (left) : the index of the channel of the left motor (0-7) [uint8_t]
+//         (right) : the index of the channel of the right motor (0-7) [uint8_t]
+//         (motors) : the motors [VespaMotors &]
+//  @returns false if an index is invalid [bool]
+//  Note: the speeds are written from the interrupt (see <toSpeed()>). The motors
+//        are stopped when one of the channels is lost. The motors are initialized.
+bool VespaRCInput::passThrough(uint8_t left, uint8_t right, VespaMotors &motors){
+  if ((left >= VESPA_RC_INPUT_CHANNELS) || (right >= VESPA_RC_INPUT_CHANNELS) || !motors.begin()){
+    return false;
+  }
+  this->_motors = nullptr; // disable while changing the channels
+  this->_motors_left = left;
+  this->_motors_right = right;
+  this->_motors = &motors;
+  return true;
+}
+
+// --------------------------------------------------
+
+// Read the pulse width of a channel
+//  @param (index) : the index of the channel (0-7) [uint8_t]
+//  @returns the width of the last valid pulse, or 0 if not connected [us] [uint16_t]
+uint16_t VespaRCInput::read(uint8_t index){
+  if (!this->connected(index)){
+    return 0;
+  }
+  return this->_channels[index].width.load(std::memory_order_relaxed);
+}
+
+// --------------------------------------------------
+
+// Read the pulse width of a channel as a speed
+//  @param (index) : the index of the channel (0-7) [uint8_t]
+//  @returns the speed (-100 to 100), or 0 if not connected [%] [int8_t]
+int8_t VespaRCInput::readSpeed(uint8_t index){
+  if (!this->connected(index)){
+    return 0;
+  }
+  return VespaRCInput::toSpeed(this->_channels[index].width.load(std::memory_order_relaxed));
+}
+
+// --------------------------------------------------
+
+// Set the timeout of the signal loss
+//  @param (timeout) : the timeout, or 0 to disable it [ms] [uint32_t]
+void VespaRCInput::setTimeout(uint32_t timeout){
+  this->_timeout = timeout * 1000;
+  this->_startTimer();
+}
+
+// --------------------------------------------------
+
+// Convert a pulse width to a speed
+//  @param (width) : the pulse width [us] [uint16_t]
+//  @returns the speed (-100 to 100) [%] [int8_t]
+//  Note: the pulses within <VESPA_RC_INPUT_DEADBAND> of the neutral are 0 and
+//        the rest of the range is scaled linearly (integer math, in IRAM).
+int8_t IRAM_ATTR VespaRCInput::toSpeed(uint16_t width){
+  int32_t offset = (int32_t)width - VESPA_RC_INPUT_NEUTRAL;
+  if (offset > VESPA_RC_INPUT_DEADBAND){
+    offset -= VESPA_RC_INPUT_DEADBAND;
+  } else if (offset < -VESPA_RC_INPUT_DEADBAND){
+    offset += VESPA_RC_INPUT_DEADBAND;
+  } else {
+    return 0;
+  }
+
+  int32_t speed = (offset * 100) / (VESPA_RC_INPUT_RANGE - VESPA_RC_INPUT_DEADBAND);
+  if (speed > 100){
+    speed = 100;
+  } else if (speed < -100){
+    speed = -100;
+  }
+  return speed;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Handle a pulse of a channel (interrupt)
+//  @param (arg) : the channel [Channel *]
+//         (width) : the width of the pulse [us] [uint32_t]
+void IRAM_ATTR VespaRCInput::_capture(void *arg, uint32_t width){
+  if ((width < VESPA_RC_INPUT_WIDTH_MIN) || (width > VESPA_RC_INPUT_WIDTH_MAX)){
+    return; // noise
+  }
+
+  Channel *channel = (Channel *)arg;
+  VespaRCInput *input = channel->owner;
+  channel->width.store(width, std::memory_order_relaxed);
+  channel->time.store(VespaHAL::micros(), std::memory_order_relaxed);
+  input->_lost.fetch_and(~(1 << channel->index), std::memory_order_relaxed);
+
+  // pass through
+  if (channel->servo != nullptr){
+    channel->servo->writeFromISR(width);
+  }
+  VespaMotors *motors = input->_motors;
+  uint8_t motors_mask = (1 << input->_motors_left) | (1 << input->_motors_right);
+  if ((motors != nullptr) && !(input->_lost.load(std::memory_order_relaxed) & motors_mask)){
+    if (channel->index == input->_motors_left){
+      motors->setSpeedLeftFromISR(VespaRCInput::toSpeed(width));
+    }
+    if (channel->index == input->_motors_right){
+      motors->setSpeedRightFromISR(VespaRCInput::toSpeed(width));
+    }
+  }
+}
+
+// --------------------------------------------------
+
+// Check the signal loss of the channels (interrupt of the timer)
+//  @param (arg) : the RC input [VespaRCInput *]
+void IRAM_ATTR VespaRCInput::_checkTimeout(void *arg){
+  VespaRCInput *input = (VespaRCInput *)arg;
+  uint32_t now = VespaHAL::micros();
+
+  for (uint8_t i=0 ; i < VESPA_RC_INPUT_CHANNELS ; i++){
+    Channel &channel = input->_channels[i];
+    if ((channel.capture == nullptr) || (input->_lost.load(std::memory_order_relaxed) & (1 << i))){
+      continue; // not attached or already lost
+    }
+    if ((now - channel.time.load(std::memory_order_relaxed)) < input->_timeout){
+      continue;
+    }
+    input->_lost.fetch_or(1 << i, std::memory_order_relaxed);
+
+    // failsafe
+    VespaMotors *motors = input->_motors;
+    if ((motors != nullptr) && ((i == input->_motors_left) || (i == input->_motors_right))){
+      motors->stopFromISR();
+    }
+
+    // event
+    if (input->_lost_queue != nullptr){
+      input->_lost_queue->post(input->_lost_delegate, i);
+    } else {
+      input->_lost_delegate.call(i);
+    }
+  }
+}
+
+// --------------------------------------------------
+
+// Start the timer of the signal loss
+void VespaRCInput::_startTimer(void){
+  if (this->_timer != nullptr){
+    VespaHAL::timerStop(this->_timer);
+    this->_timer = nullptr; // reset
+  }
+
+  if (this->_timeout == 0){
+    return;
+  }
+
+  uint32_t period = this->_timeout / 4;
+  if (period < 1000){
+    period = 1000; // [us]
+  }
+
+  this->_timer = VespaHAL::timerStart(period, VespaRCInput::_checkTimeout, this);
+}
+
+// --------------------------------------------------
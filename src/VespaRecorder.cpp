@@ -0,0 +1,535 @@
+/*******************************************************************************
+* RoboCore Vespa Recorder Library
+* 
+* Record and replay of the calls to the actuators of the Vespa board.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+/*
+* Format of the log (little endian):
+*   header : "VREC" (4) | version (1) | number of objects (1) | class of each object (1 each) | size of the entries (4)
+*   entry  : time since the start (varint) [us] | event (1) | index of the object (1) | argument (varint)
+* 
+* The varints are unsigned LEB128 (7 bits per byte, the least significant first).
+* The events are the same as in the trace (see <VespaTraceEvent>) and the class
+* of an object is the first event of its class (e.g. <TRACE_MOTORS_BACKWARD>).
+* The entries are in the order of the calls, so an entry recorded by an interrupt
+* might have a time a few [us] before the previous entry.
+* 
+* Only the outermost call to an object is recorded (e.g. <forward()> and not the
+* <setSpeedLeft()> it calls). The nesting is counted per context (the task and
+* the interrupts of each core), so a call from an interrupt (e.g. <stopFromISR()>
+* of the deadman) is recorded even while the task is inside a method of the same
+* object, as on the robot.
+*/
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// Macros
+
+#define VESPA_RECORDER_ENTRY_MAX (12) // [bytes] (5 + 1 + 1 + 5)
+
+// --------------------------------------------------
+// Static variables
+
+std::atomic<VespaRecorder *> VespaRecorder::_active(nullptr);
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Encode a varint
+//  @param (buffer) : the destination, with at least 5 bytes [uint8_t *]
+//         (value) : the value [uint32_t]
+//  @returns the number of bytes written [uint8_t]
+static uint8_t IRAM_ATTR _putVarint(uint8_t *buffer, uint32_t value){
+  uint8_t size = 0;
+  while (value >= 0x80){
+    buffer[size++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  buffer[size++] = value;
+  return size;
+}
+
+// --------------------------------------------------
+
+// Decode a varint
+//  @param (buffer) : the source [const uint8_t *]
+//         (position) : the position in the buffer, updated [size_t &]
+//         (size) : the size of the buffer [size_t]
+//         (value) : the value decoded [uint32_t &]
+//  @returns false if the varint is incomplete or too long [bool]
+static bool _getVarint(const uint8_t *buffer, size_t &position, size_t size, uint32_t &value){
+  value = 0;
+  for (uint8_t shift=0 ; shift < 35 ; shift += 7){
+    if (position >= size){
+      return false;
+    }
+    uint8_t data = buffer[position++];
+    value |= (uint32_t)(data & 0x7F) << shift;
+    if ((data & 0x80) == 0){
+      return true;
+    }
+  }
+  return false;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Constructor
+//  @param (buffer) : the buffer of the log [uint8_t *]
+//         (size) : the size of the buffer [size_t]
+VespaRecorder::VespaRecorder(uint8_t *buffer, size_t size) :
+  _buffer(buffer),
+  _capacity(size),
+  _length(0),
+  _start_time(0),
+  _dropped(0),
+  _object_count(0)
+{
+  // nothing to do here
+}
+
+// --------------------------------------------------
+
+// Destructor
+VespaRecorder::~VespaRecorder(void){
+  this->stop();
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Attach a LED to the recorder
+//  @param (led) : the LED [VespaLED &]
+//  @returns false if there are already <VESPA_RECORDER_OBJECTS> objects [bool]
+bool VespaRecorder::attach(VespaLED &led){
+  return this->_attach(&led, TRACE_LED_BLINK);
+}
+
+// --------------------------------------------------
+
+// Attach the motors to the recorder
+//  @param (motors) : the motors [VespaMotors &]
+//  @returns false if there are already <VESPA_RECORDER_OBJECTS> objects [bool]
+bool VespaRecorder::attach(VespaMotors &motors){
+  return this->_attach(&motors, TRACE_MOTORS_BACKWARD);
+}
+
+// --------------------------------------------------
+
+// Attach a servo to the recorder
+//  @param (servo) : the servo [VespaServo &]
+//  @returns false if there are already <VESPA_RECORDER_OBJECTS> objects [bool]
+bool VespaRecorder::attach(VespaServo &servo){
+  return this->_attach(&servo, TRACE_SERVO_ATTACH);
+}
+
+// --------------------------------------------------
+
+// Delete the entries recorded
+void VespaRecorder::clear(void){
+  this->_length.store(0, std::memory_order_relaxed);
+  this->_dropped.store(0, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------
+
+// Write the log (see the format above)
+//  @param (output) : the destination (e.g. <Serial>) [Print &]
+//  @returns the number of bytes written [size_t]
+//  Note: stop the recorder before, so that no entry is added while writing.
+size_t VespaRecorder::dump(Print &output){
+  uint32_t length = this->_length.load(std::memory_order_acquire);
+
+  uint8_t header[6 + VESPA_RECORDER_OBJECTS + 4] = { 'V', 'R', 'E', 'C', VespaRecorder::FORMAT_VERSION, this->_object_count };
+  uint8_t size = 6;
+  for (uint8_t i=0 ; i < this->_object_count ; i++){
+    header[size++] = this->_types[i];
+  }
+  for (uint8_t i=0 ; i < 4 ; i++){
+    header[size++] = (length >> (8 * i)) & 0xFF;
+  }
+
+  size_t res = output.write(header, size);
+  res += output.write(this->_buffer, length);
+  return res;
+}
+
+// --------------------------------------------------
+
+// Get the number of calls not recorded because the buffer was full
+//  @returns the number of calls [uint32_t]
+uint32_t VespaRecorder::getDropped(void){
+  return this->_dropped.load(std::memory_order_relaxed);
+}
+
+// --------------------------------------------------
+
+// Get the size of the entries recorded
+//  @returns the size [bytes] [size_t]
+size_t VespaRecorder::getSize(void){
+  return this->_length.load(std::memory_order_relaxed);
+}
+
+// --------------------------------------------------
+
+// Start recording
+//  Note: only one recorder can be active. The time of the entries is relative to this call.
+void VespaRecorder::start(void){
+  for (uint8_t context=0 ; context < VESPA_RECORDER_CONTEXTS ; context++){
+    for (uint8_t i=0 ; i < this->_object_count ; i++){
+      this->_depths[context][i].store(0, std::memory_order_relaxed); // reset
+    }
+  }
+  this->_start_time = VespaHAL::micros();
+  _active.store(this, std::memory_order_release);
+}
+
+// --------------------------------------------------
+
+// Stop recording
+void VespaRecorder::stop(void){
+  VespaRecorder *expected = this;
+  _active.compare_exchange_strong(expected, nullptr);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Enter a recorded method
+//  @param (object) : the object called [const void *]
+//         (event) : the method called (see <VespaTraceEvent>) [uint8_t]
+//         (argument) : the argument of the method [uint32_t]
+//         (record) : false to only block the nested calls [bool]
+//  @returns the context of the call, to give to <leave()> [uint8_t]
+//  Note: the context is kept by the caller, so <leave()> updates the same counter
+//        even if the task moved to the other core.
+uint8_t IRAM_ATTR VespaRecorder::enter(const void *object, uint8_t event, uint32_t argument, bool record){
+  uint8_t context = ((VespaHAL::coreID() % VESPA_TRACE_CORES) << 1) | (VespaHAL::inInterrupt() ? 1 : 0);
+
+  VespaRecorder *recorder = _active.load(std::memory_order_acquire);
+  if (recorder == nullptr){
+    return context;
+  }
+
+  for (uint8_t i=0 ; i < recorder->_object_count ; i++){
+    if (recorder->_objects[i] == object){
+      if (recorder->_depths[context][i].fetch_add(1, std::memory_order_relaxed) == 0){
+        if (record){
+          recorder->_capture(i, event, argument);
+        }
+      }
+      return context;
+    }
+  }
+  return context;
+}
+
+// --------------------------------------------------
+
+// Leave a recorded method
+//  @param (object) : the object called [const void *]
+//         (context) : the context returned by <enter()> [uint8_t]
+void IRAM_ATTR VespaRecorder::leave(const void *object, uint8_t context){
+  VespaRecorder *recorder = _active.load(std::memory_order_acquire);
+  if ((recorder == nullptr) || (context >= VESPA_RECORDER_CONTEXTS)){
+    return;
+  }
+
+  for (uint8_t i=0 ; i < recorder->_object_count ; i++){
+    if (recorder->_objects[i] == object){
+      // not below 0 (e.g. the recording started inside the method)
+      uint8_t depth = recorder->_depths[context][i].load(std::memory_order_relaxed);
+      while ((depth > 0) && !recorder->_depths[context][i].compare_exchange_weak(depth, depth - 1, std::memory_order_relaxed)){
+        // retry
+      }
+      return;
+    }
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Attach an object
+//  @param (object) : the object [const void *]
+//         (type) : the class of the object [uint8_t]
+//  @returns false if there are already <VESPA_RECORDER_OBJECTS> objects [bool]
+bool VespaRecorder::_attach(const void *object, uint8_t type){
+  for (uint8_t i=0 ; i < this->_object_count ; i++){
+    if (this->_objects[i] == object){
+      return true; // already attached
+    }
+  }
+  if (this->_object_count >= VESPA_RECORDER_OBJECTS){
+    return false;
+  }
+
+  this->_objects[this->_object_count] = object;
+  this->_types[this->_object_count] = type;
+  for (uint8_t context=0 ; context < VESPA_RECORDER_CONTEXTS ; context++){
+    this->_depths[context][this->_object_count].store(0, std::memory_order_relaxed);
+  }
+  this->_object_count++;
+  return true;
+}
+
+// --------------------------------------------------
+
+// Add an entry to the log
+//  @param (index) : the index of the object [uint8_t]
+//         (event) : the method called [uint8_t]
+//         (argument) : the argument of the method [uint32_t]
+//  Note: lock-free, the space of the entry is reserved before writing it.
+void IRAM_ATTR VespaRecorder::_capture(uint8_t index, uint8_t event, uint32_t argument){
+  uint8_t entry[VESPA_RECORDER_ENTRY_MAX];
+  uint8_t size = _putVarint(entry, VespaHAL::micros() - this->_start_time);
+  entry[size++] = event;
+  entry[size++] = index;
+  size += _putVarint(&entry[size], argument);
+
+  // reserve the space
+  size_t position = this->_length.load(std::memory_order_relaxed);
+  do {
+    if (position + size > this->_capacity){
+      this->_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  } while (!this->_length.compare_exchange_weak(position, position + size, std::memory_order_acq_rel));
+
+  for (uint8_t i=0 ; i < size ; i++){
+    this->_buffer[position + i] = entry[i];
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Constructor
+//  @param (log) : the log written by <VespaRecorder::dump()> [const uint8_t *]
+//         (size) : the size of the log [size_t]
+VespaReplay::VespaReplay(const uint8_t *log, size_t size) :
+  _log(log),
+  _size(size),
+  _position(size),
+  _start_time(0),
+  _started(false),
+  _object_count(0)
+{
+  // nothing to do here
+}
+
+// --------------------------------------------------
+
+// Destructor
+VespaReplay::~VespaReplay(void){
+  // nothing to do here
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Attach a LED to the replay
+//  @param (led) : the LED [VespaLED &]
+//  @returns false if there are already <VESPA_RECORDER_OBJECTS> objects [bool]
+bool VespaReplay::attach(VespaLED &led){
+  return this->_attach(&led, TRACE_LED_BLINK);
+}
+
+// --------------------------------------------------
+
+// Attach the motors to the replay
+//  @param (motors) : the motors [VespaMotors &]
+//  @returns false if there are already <VESPA_RECORDER_OBJECTS> objects [bool]
+bool VespaReplay::attach(VespaMotors &motors){
+  return this->_attach(&motors, TRACE_MOTORS_BACKWARD);
+}
+
+// --------------------------------------------------
+
+// Attach a servo to the replay
+//  @param (servo) : the servo [VespaServo &]
+//  @returns false if there are already <VESPA_RECORDER_OBJECTS> objects [bool]
+bool VespaReplay::attach(VespaServo &servo){
+  return this->_attach(&servo, TRACE_SERVO_ATTACH);
+}
+
+// --------------------------------------------------
+
+// Check if all the entries were replayed
+//  @returns true if finished (or not started) [bool]
+bool VespaReplay::finished(void){
+  return (this->_position >= this->_size);
+}
+
+// --------------------------------------------------
+
+// Check the log and start the replay
+//  @returns false if the log is invalid or the objects don't match [bool]
+bool VespaReplay::start(void){
+  this->_started = false;
+
+  // check the header
+  if ((this->_log == nullptr) || (this->_size < 10) || (memcmp(this->_log, "VREC", 4) != 0) ||
+      (this->_log[4] != VespaRecorder::FORMAT_VERSION)){
+    return false;
+  }
+  uint8_t count = this->_log[5];
+  size_t position = 6 + count + 4;
+  if ((count > this->_object_count) || (position > this->_size)){
+    return false;
+  }
+  for (uint8_t i=0 ; i < count ; i++){
+    if (this->_log[6 + i] != this->_types[i]){
+      return false; // different class
+    }
+  }
+  uint32_t length = 0;
+  for (uint8_t i=0 ; i < 4 ; i++){
+    length |= (uint32_t)this->_log[6 + count + i] << (8 * i);
+  }
+  if (position + length < this->_size){
+    this->_size = position + length; // ignore the extra bytes
+  }
+
+  this->_position = position;
+  this->_start_time = VespaHAL::micros();
+  this->_started = true;
+  return true;
+}
+
+// --------------------------------------------------
+
+// Execute the entries that are due
+//  Note: call it in <loop()>. The timing error is the period of the loop.
+void VespaReplay::update(void){
+  if (!this->_started){
+    return;
+  }
+
+  uint32_t elapsed = VespaHAL::micros() - this->_start_time;
+  while (this->_position < this->_size){
+    size_t position = this->_position;
+    uint32_t time, argument;
+    if (!_getVarint(this->_log, position, this->_size, time)){
+      this->_position = this->_size; // invalid
+      return;
+    }
+    if (time > elapsed){
+      return; // not yet
+    }
+    if (position + 2 > this->_size){
+      this->_position = this->_size; // invalid
+      return;
+    }
+    uint8_t event = this->_log[position++];
+    uint8_t index = this->_log[position++];
+    if (!_getVarint(this->_log, position, this->_size, argument)){
+      this->_position = this->_size; // invalid
+      return;
+    }
+
+    this->_position = position;
+    this->_execute(event, index, argument);
+  }
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Attach an object
+//  @param (object) : the object [void *]
+//         (type) : the class of the object [uint8_t]
+//  @returns false if there are already <VESPA_RECORDER_OBJECTS> objects [bool]
+bool VespaReplay::_attach(void *object, uint8_t type){
+  if (this->_object_count >= VESPA_RECORDER_OBJECTS){
+    return false;
+  }
+
+  this->_objects[this->_object_count] = object;
+  this->_types[this->_object_count] = type;
+  this->_object_count++;
+  return true;
+}
+
+// --------------------------------------------------
+
+// Execute an entry
+//  @param (event) : the method to call [uint8_t]
+//         (index) : the index of the object [uint8_t]
+//         (argument) : the argument of the method [uint32_t]
+void VespaReplay::_execute(uint8_t event, uint8_t index, uint32_t argument){
+  if ((index >= this->_object_count) || ((event & 0xF0) != (this->_types[index] & 0xF0))){
+    return; // unknown object or different class
+  }
+
+  // LED
+  if ((event & 0xF0) == (TRACE_LED_BLINK & 0xF0)){
+    VespaLED *led = (VespaLED *)this->_objects[index];
+    switch (event){
+      case TRACE_LED_BLINK: led->blink(argument); break;
+      case TRACE_LED_ON: led->on(); break;
+      case TRACE_LED_OFF: led->off(); break;
+      case TRACE_LED_TOGGLE: led->toggle(); break;
+      default: break;
+    }
+    return;
+  }
+
+  // motors
+  if ((event & 0xF0) == (TRACE_MOTORS_BACKWARD & 0xF0)){
+    VespaMotors *motors = (VespaMotors *)this->_objects[index];
+    int8_t left = (int8_t)(argument & 0xFF);
+    int8_t right = (int8_t)((argument >> 8) & 0xFF);
+    switch (event){
+      case TRACE_MOTORS_BACKWARD: motors->backward(argument); break;
+      case TRACE_MOTORS_FORWARD: motors->forward(argument); break;
+      case TRACE_MOTORS_SET_SPEED_LEFT: motors->setSpeedLeft(left); break;
+      case TRACE_MOTORS_SET_SPEED_RIGHT: motors->setSpeedRight(left); break;
+      case TRACE_MOTORS_STOP: motors->stop(); break;
+      case TRACE_MOTORS_TURN: motors->turn(left, right); break;
+      case TRACE_MOTORS_SET_SPEED_LEFT_ISR: motors->setSpeedLeftFromISR(left); break;
+      case TRACE_MOTORS_SET_SPEED_RIGHT_ISR: motors->setSpeedRightFromISR(left); break;
+      case TRACE_MOTORS_STOP_ISR: motors->stopFromISR(); break;
+      case TRACE_MOTORS_TURN_ISR: motors->turnFromISR(left, right); break;
+      default: break;
+    }
+    return;
+  }
+
+  // servo
+  if ((event & 0xF0) == (TRACE_SERVO_ATTACH & 0xF0)){
+    VespaServo *servo = (VespaServo *)this->_objects[index];
+    switch (event){
+      case TRACE_SERVO_WRITE: servo->write(argument); break;
+      case TRACE_SERVO_WRITE_ISR: servo->writeFromISR(argument); break;
+      default: break;
+    }
+  }
+}
+
+// --------------------------------------------------
@@ -0,0 +1,253 @@
+/*******************************************************************************
+* RoboCore Vespa Self Test Library
+* 
+* Diagnostic of the motors with the battery and the encoders.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+
+
+/*
+* Each motor runs at the speed of the test for <VESPA_SELF_TEST_PULSE> in each
+* direction, one motor at a time (left forward, right forward, left backward,
+* right backward), with <VESPA_SELF_TEST_PAUSE> between the pulses to let the
+* motors stop. Before each pulse, the battery voltage at rest is read. At the
+* end of the pulse, when the motor reached its speed, the voltage is read
+* again: the difference (dip) is caused by the current of the motor through
+* the internal resistance of the battery. Each voltage is the average of
+* <VESPA_SELF_TEST_SAMPLES> readings, to filter the ripple of the PWM.
+* 
+* The health of each motor is then:
+*   - DISCONNECTED: the dip is below <dip_min> in both directions;
+*   - DEGRADED: the dip is below <dip_min> in one direction (a half of the
+*     H-bridge or a driver), or the weakest direction has less than
+*     <VESPA_SELF_TEST_BALANCE> of the strongest (counts or dip);
+*   - STALLED: with encoders, the motor draws current but doesn't move. Without
+*     encoders, the dip is above <dip_stall> in both directions (a stalled
+*     motor draws its stall current, a free motor much less at its speed).
+* 
+* The thresholds depend on the motors and on the battery, so they can be set
+* with <setThresholds()> from the dips of a healthy robot.
+*/
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Constructor
+//  @param (motors) : the motors to test [VespaMotors &]
+//         (battery) : the battery that powers the motors [VespaBattery &]
+VespaSelfTest::VespaSelfTest(VespaMotors &motors, VespaBattery &battery) :
+  _motors(motors),
+  _battery(battery),
+  _read(nullptr),
+  _context(nullptr),
+  _dip_min(VESPA_SELF_TEST_DIP_MIN),
+  _dip_stall(VESPA_SELF_TEST_DIP_STALL),
+  _passed(false)
+{
+  // nothing to do
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Check the result of the last test
+//  @returns true if both motors are healthy [bool]
+bool VespaSelfTest::passed(void){
+  return this->_passed;
+}
+
+// --------------------------------------------------
+
+// Print a report in a single line
+//  @param (report) : the report [const VespaSelfTestReport &]
+//         (output) : the output (e.g. <Serial>) [Print &]
+//  Note: e.g. "battery=7400mV time=401ms left=OK(62/61mV,117/117) right=DISCONNECTED(0/0mV,0/0)",
+//        with the dips and the counts forward/backward.
+void VespaSelfTest::print(const VespaSelfTestReport &report, Print &output){
+  const char *names[] = { "OK", "DISCONNECTED", "STALLED", "DEGRADED" };
+
+  output.print("battery=");
+  output.print(report.voltage);
+  output.print("mV time=");
+  output.print(report.duration);
+  output.print("ms");
+  for (uint8_t motor=0 ; motor < 2 ; motor++){
+    output.print((motor == VespaMotors::LEFT) ? " left=" : " right=");
+    output.print(names[report.health[motor]]);
+    output.print("(");
+    output.print(report.dip[motor][0]);
+    output.print("/");
+    output.print(report.dip[motor][1]);
+    output.print("mV,");
+    output.print(report.counts[motor][0]);
+    output.print("/");
+    output.print(report.counts[motor][1]);
+    output.print(")");
+  }
+  output.println();
+}
+
+// --------------------------------------------------
+
+// Run the test
+//  @param (report) : the result [VespaSelfTestReport &]
+//         (speed) : the speed of the motors (1-100%) [uint8_t]
+//  @returns true if both motors are healthy [bool]
+//  Note: blocking for about 4 * (<VESPA_SELF_TEST_PULSE> + <VESPA_SELF_TEST_PAUSE>).
+//        The motors are stopped at the end.
+bool VespaSelfTest::run(VespaSelfTestReport &report, uint8_t speed){
+  uint32_t start = VespaHAL::millis();
+  this->_passed = false;
+
+  if ((speed == 0) || (speed > 100)){
+    return false;
+  }
+  if (!this->_motors.begin() || !this->_battery.begin()){
+    return false;
+  }
+  this->_motors.stop();
+
+  // one pulse per motor and direction (each motor rests during the pulse of the other)
+  report.voltage = this->_readVoltage();
+  for (uint8_t direction=0 ; direction < 2 ; direction++){
+    for (uint8_t motor=0 ; motor < 2 ; motor++){
+      uint32_t rest = this->_readVoltage();
+      int32_t position = (this->_read != nullptr) ? this->_read(motor, this->_context) : 0;
+
+      this->_setSpeed(motor, (direction == 0) ? speed : -speed);
+      VespaHAL::delay(VESPA_SELF_TEST_PULSE - VESPA_SELF_TEST_SAMPLES); // reach the speed
+      uint32_t loaded = this->_readVoltage();
+      int32_t counts = (this->_read != nullptr) ? (this->_read(motor, this->_context) - position) : 0;
+      this->_setSpeed(motor, 0);
+
+      report.dip[motor][direction] = (rest > loaded) ? (rest - loaded) : 0;
+      report.counts[motor][direction] = (counts >= 0) ? counts : -counts; // the encoders might count backwards
+      VespaHAL::delay(VESPA_SELF_TEST_PAUSE);
+    }
+  }
+
+  // classify
+  report.health[VespaMotors::LEFT] = this->_classify(report, VespaMotors::LEFT);
+  report.health[VespaMotors::RIGHT] = this->_classify(report, VespaMotors::RIGHT);
+  report.duration = VespaHAL::millis() - start;
+
+  this->_passed = (report.health[VespaMotors::LEFT] == HEALTH_OK) && (report.health[VespaMotors::RIGHT] == HEALTH_OK);
+  return this->_passed;
+}
+
+// --------------------------------------------------
+
+// Set the function to read the encoders
+//  @param (read) : the function to read the position of a motor (e.g. the count of
+//                  an encoder), called with <LEFT> or <RIGHT> and the context, or null [int32_t (*)(uint8_t, void *)]
+//         (context) : the argument of the function [void *]
+//  Note: the same function as in <VespaMotors::calibrate()>.
+void VespaSelfTest::setEncoders(int32_t (*read)(uint8_t, void *), void *context){
+  this->_read = read;
+  this->_context = context;
+}
+
+// --------------------------------------------------
+
+// Set the thresholds of the battery dip
+//  @param (dip_min) : the dip of a connected motor [mV] [uint16_t]
+//         (dip_stall) : the dip of a stalled motor, used without encoders [mV] [uint16_t]
+void VespaSelfTest::setThresholds(uint16_t dip_min, uint16_t dip_stall){
+  this->_dip_min = dip_min;
+  this->_dip_stall = dip_stall;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Find the health of a motor
+//  @param (report) : the measurements [const VespaSelfTestReport &]
+//         (motor) : <LEFT> or <RIGHT> [uint8_t]
+//  @returns the health (see <VespaMotorHealth>) [uint8_t]
+uint8_t VespaSelfTest::_classify(const VespaSelfTestReport &report, uint8_t motor){
+  const uint16_t *dip = report.dip[motor];
+  const int32_t *counts = report.counts[motor];
+
+  // current
+  bool forward = (dip[0] >= this->_dip_min);
+  bool backward = (dip[1] >= this->_dip_min);
+  if (!forward && !backward){
+    return HEALTH_DISCONNECTED;
+  }
+  if (!forward || !backward){
+    return HEALTH_DEGRADED;
+  }
+
+  // movement
+  int32_t weakest, strongest;
+  if (this->_read != nullptr){
+    if ((counts[0] == 0) && (counts[1] == 0)){
+      return HEALTH_STALLED;
+    }
+    weakest = (counts[0] < counts[1]) ? counts[0] : counts[1];
+    strongest = (counts[0] < counts[1]) ? counts[1] : counts[0];
+  } else {
+    if ((dip[0] >= this->_dip_stall) && (dip[1] >= this->_dip_stall)){
+      return HEALTH_STALLED;
+    }
+    weakest = (dip[0] < dip[1]) ? dip[0] : dip[1];
+    strongest = (dip[0] < dip[1]) ? dip[1] : dip[0];
+  }
+  if ((weakest * 100) < (strongest * VESPA_SELF_TEST_BALANCE)){
+    return HEALTH_DEGRADED;
+  }
+
+  return HEALTH_OK;
+}
+
+// --------------------------------------------------
+
+// Read the battery voltage
+//  @returns the average of <VESPA_SELF_TEST_SAMPLES> readings, 1 ms apart [mV] [uint32_t]
+uint32_t VespaSelfTest::_readVoltage(void){
+  uint32_t sum = 0;
+  for (uint8_t i=0 ; i < VESPA_SELF_TEST_SAMPLES ; i++){
+    sum += this->_battery.readVoltage();
+    VespaHAL::delay(1);
+  }
+  return sum / VESPA_SELF_TEST_SAMPLES;
+}
+
+// --------------------------------------------------
+
+// Set the speed of a motor
+//  @param (motor) : <LEFT> or <RIGHT> [uint8_t]
+//         (speed) : the speed (-100-100%) [int8_t]
+void VespaSelfTest::_setSpeed(uint8_t motor, int8_t speed){
+  if (motor == VespaMotors::LEFT){
+    this->_motors.setSpeedLeft(speed);
+  } else {
+    this->_motors.setSpeedRight(speed);
+  }
+}
+
+// --------------------------------------------------
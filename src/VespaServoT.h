@@ -0,0 +1,347 @@
+#ifndef VESPA_SERVO_T_H
+#define VESPA_SERVO_T_H
+
+/*******************************************************************************
+* RoboCore Vespa Servo Library
+* 
+* Library to use servo motors with the Vespa board.
+* 
+* Copyright 2024 RoboCore.
+* [v1.0] Based on the library by John K. Bennett (@jkb-git).
+* 
+*
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+// Reference: https://docs.espressif.com/projects/arduino-esp32/en/latest/api/ledc.html
+
+// Note: this file is included by <RoboCore_Vespa.h> and must not be included directly.
+
+// --------------------------------------------------
+// Static variables
+
+template <class Board>
+uint8_t VespaServoT<Board>::_servo_count = 0; // default
+template <class Board>
+VespaServoT<Board> *VespaServoT<Board>::_servos[VESPA_SERVO_QTY]; // create the array
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Constructor
+template <class Board>
+VespaServoT<Board>::VespaServoT(void) :
+  _attached(false),
+  _pin(0xFF),
+  _channel(0xFF),
+  _pulse_width(0)
+{ 
+  // set the default values if first time
+  if(_servo_count == 0){
+    for(uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+      _servos[i] = nullptr; // default to null pointer
+    }
+  }
+
+  // check if max servos
+  if(_servo_count >= VESPA_SERVO_QTY){
+    return;
+  }
+
+  // find an empty servo slot
+  for(uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+    if(_servos[i] == nullptr){
+      _servos[i] = this; // add the servo to the list
+      _servo_count++; // update the count
+      break; // exit
+    }
+  }
+}
+
+// --------------------------------------------------
+
+// Destructor
+template <class Board>
+VespaServoT<Board>::~VespaServoT(void){
+  // detach the servo
+  this->detach();
+  
+  // remove the servo from list
+  for(uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+    if(_servos[i] == this){
+      _servos[i] = nullptr; // reset
+      break; // exit
+    }
+  }
+  _servo_count--; // update
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Attach a pin to the servo
+//  @param (pin) : the pin to attach [uint8_t]
+//  @returns true if the pin was attached [bool]
+template <class Board>
+bool VespaServoT<Board>::attach(uint8_t pin){
+  return this->attach(pin, VESPA_SERVO_PULSE_WIDTH_MIN, VESPA_SERVO_PULSE_WIDTH_MAX);
+}
+
+// --------------------------------------------------
+
+// Attach a pin to the servo
+//  @param (pin) : the pin to attach [uint8_t]
+//         (min) : the minimum pulse width in [us] [uint16_t]
+//         (max) : the maximum pulse width in [us] [uint16_t]
+//  @returns true if the pin was attached [bool]
+template <class Board>
+bool VespaServoT<Board>::attach(uint8_t pin, uint16_t min, uint16_t max){
+  VESPA_TRACE(TRACE_SERVO_ATTACH, pin);
+
+  // check if the servo is already attached
+  if(this->attached()){
+    return true;
+  }
+
+  // check if valid pin
+  // (folded by the compiler when the pin is a constant)
+  if(!isValidPin(pin)){
+    return false;
+  }
+
+  this->_pin = pin;
+  return this->_attach(min, max);
+}
+
+// --------------------------------------------------
+
+// Check if the servo is attached to a pin
+//  @returns true if attached [bool]
+template <class Board>
+bool IRAM_ATTR VespaServoT<Board>::attached(void){
+  return this->_attached;
+}
+
+// --------------------------------------------------
+
+// Detach the current servo
+template <class Board>
+void VespaServoT<Board>::detach(void){
+  VESPA_TRACE(TRACE_SERVO_DETACH, this->_pin);
+
+  // check if the servo is attached to a pin
+  if(this->attached()){
+    VespaHAL::ledcDetach(this->_pin); // detach the pin from the LEDC driver
+    VespaHAL::pinMode(this->_pin, INPUT); // set the pin as input
+    this->_pin = 0xFF; // reset
+    this->_channel = 0xFF; // reset
+    this->_pulse_width = 0; // reset
+    this->_attached = false; // reset
+  }
+}
+
+// --------------------------------------------------
+
+// Get the pulse width of the servo
+//  @returns the last pulse width written, or 0 if not attached [us] [uint16_t]
+template <class Board>
+uint16_t IRAM_ATTR VespaServoT<Board>::getPulseWidth(void){
+  return this->_pulse_width;
+}
+
+// --------------------------------------------------
+
+// Write a value to the servo
+//  @param (value) : the value to write in [degrees or us] [uint16_t]
+template <class Board>
+void VespaServoT<Board>::write(uint16_t value){
+  VESPA_TRACE(TRACE_SERVO_WRITE, value);
+  VESPA_RECORD(TRACE_SERVO_WRITE, value);
+
+  this->writeFromISR(value);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Attach a pin to the servo, checked at compile time
+//  @param (PIN) : the pin to attach [uint8_t]
+//  @returns true if the pin was attached [bool]
+template <class Board>
+template <uint8_t PIN>
+bool VespaServoT<Board>::attach(void){
+  return this->attach<PIN>(VESPA_SERVO_PULSE_WIDTH_MIN, VESPA_SERVO_PULSE_WIDTH_MAX);
+}
+
+// --------------------------------------------------
+
+// Attach a pin to the servo, checked at compile time
+//  @param (PIN) : the pin to attach [uint8_t]
+//         (min) : the minimum pulse width in [us] [uint16_t]
+//         (max) : the maximum pulse width in [us] [uint16_t]
+//  @returns true if the pin was attached [bool]
+template <class Board>
+template <uint8_t PIN>
+bool VespaServoT<Board>::attach(uint16_t min, uint16_t max){
+  static_assert(isValidPin(PIN), "This pin can't be used with a servo on this board");
+
+  // check if the servo is already attached
+  if(this->attached()){
+    return true;
+  }
+
+  this->_pin = PIN;
+  return this->_attach(min, max);
+}
+
+// --------------------------------------------------
+
+// Check if a pin can be used with a servo
+//  @param (pin) : the pin to check [uint8_t]
+//  @returns true if the pin is in the list of the board [bool]
+template <class Board>
+constexpr bool VespaServoT<Board>::isValidPin(uint8_t pin){
+  for(uint8_t available : Board::SERVO_PINS){
+    if(available == pin){
+      return true;
+    }
+  }
+  return false;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Write a value to the servo from an interrupt
+//  @param (value) : the value to write in [degrees or us] [uint16_t]
+//  Note: only integer math with the values calculated at compile time.
+template <class Board>
+void IRAM_ATTR VespaServoT<Board>::writeFromISR(uint16_t value){
+  VESPA_TRACE(TRACE_SERVO_WRITE_ISR, value);
+  VESPA_RECORD(TRACE_SERVO_WRITE_ISR, value);
+
+  // check if the servo is attached
+  if(!this->attached()){
+    return; // exit
+  }
+
+  // check if given in degrees
+  // (same as <map(value, 0, 180, min, max)>, but <map()> is not in IRAM)
+  if(value < VESPA_SERVO_PULSE_WIDTH_MIN){
+    value = ((uint32_t)value * (this->_max - this->_min)) / 180 + this->_min; // map to [us]
+  }
+  
+  // check the limits
+  if(value > this->_max){
+    value = this->_max;
+  }
+  if(value < this->_min){
+    value = this->_min;
+  }
+
+  // update the value to ticks and write the duty cycle
+  this->_pulse_width = value;
+  uint32_t ticks = (value * _TICKS_SCALE) >> 24;
+  VespaHAL::ledcWriteChannel(this->_channel, ticks);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Apply the latest value posted to the mailbox
+//  @returns true if a new value was written [bool]
+//  Note: call it periodically from the context that owns the servo (e.g. <loop()>),
+//        which must be the only one to call the other methods directly.
+template <class Board>
+bool VespaServoT<Board>::applyPending(void){
+  VESPA_TRACE(TRACE_SERVO_APPLY_PENDING, 0);
+
+  uint16_t value;
+  if(!this->_mailbox.fetch(value)){
+    return false;
+  }
+
+  this->write(value);
+
+  return true;
+}
+
+// --------------------------------------------------
+
+// Post a value to the mailbox
+//  @param (value) : the value to write in [degrees or us] [uint16_t]
+//  Note: safe to call from another task or core, as long as there is a single producer.
+//        The value is written on the next call to <applyPending()>.
+template <class Board>
+void VespaServoT<Board>::post(uint16_t value){
+  VESPA_TRACE(TRACE_SERVO_POST, value);
+
+  this->_mailbox.post(value);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Attach the pin already validated
+//  @param (min) : the minimum pulse width in [us] [uint16_t]
+//         (max) : the maximum pulse width in [us] [uint16_t]
+//  @returns true if the pin was attached [bool]
+template <class Board>
+bool VespaServoT<Board>::_attach(uint16_t min, uint16_t max){
+  // configure the pin
+  VespaHAL::pinMode(this->_pin, OUTPUT);
+
+  // verify and set the minimum and maximum pulse values
+  this->_min = (min < VESPA_SERVO_PULSE_WIDTH_MIN) ? VESPA_SERVO_PULSE_WIDTH_MIN : min;
+  this->_max = (max > VESPA_SERVO_PULSE_WIDTH_MAX) ? VESPA_SERVO_PULSE_WIDTH_MAX : max;
+  
+  static_assert((Board::SERVO_CHANNEL_FIRST + VESPA_SERVO_QTY <= Board::MOTORS_CHANNEL_A) && (Board::SERVO_CHANNEL_FIRST + VESPA_SERVO_QTY <= Board::MOTORS_CHANNEL_B),
+                "the servo channels overlap the motor channels");
+
+  // configure the LEDC driver, with the channel of the slot (kept running in light sleep, see <VESPA_PWM_SLEEP_CLOCK>)
+  for(uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+    if(_servos[i] == this){
+      this->_channel = Board::SERVO_CHANNEL_FIRST + i;
+      this->_attached = VespaHAL::ledcAttachSleep(this->_pin, Board::SERVO_PWM_FREQUENCY, Board::SERVO_PWM_RESOLUTION, this->_channel); // attach the pin
+      break; // exit
+    }
+  }
+
+  // reset the pin if unsuccessful
+  if(!this->_attached){
+    this->_pin = 0xFF;
+    this->_channel = 0xFF;
+    return false;
+  }
+
+  // stagger the pulses of the servos by their channel
+  //  Note: the LEDC driver binds each pair of channels (2n and 2n+1) to a timer, so the
+  //        servos that share a timer are always one step apart. The timers of different
+  //        pairs start when they are configured, so their pulses are only spread if the
+  //        servos are attached together (the offset between the timers is arbitrary).
+  if(VESPA_PWM_STAGGER){
+    VespaHAL::ledcSetPhase(this->_channel, (this->_channel % VESPA_SERVO_QTY) * _PHASE_STEP); // applied with the duty cycle
+  }
+
+  this->write(90); // set the default position (90 degrees)
+
+  return true;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+#endif // VESPA_SERVO_T_H
@@ -0,0 +1,277 @@
+/*******************************************************************************
+* RoboCore Vespa Telemetry Library
+* 
+* Periodic binary records of the state of the Vespa board.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+
+/*
+* Format of the record (little endian, <RECORD_SIZE> bytes, 24 with 4 servos):
+*   type (1) = <RECORD_TYPE>
+*   sequence (2)
+*   time (4) [ms]
+*   flags (1) : bit 0 = motors, bit 1 = battery, bit 2 = button, bit 3 = button pressed,
+*               bits 4-7 = servo 1-4 attached
+*   duty of the left motor (2, signed) [ticks] (negative when moving backwards)
+*   duty of the right motor (2, signed) [ticks]
+*   battery voltage (2) [mV]
+*   pulse width of the servos 1-4 (4 x 2) [us]
+*   CRC-16/CCITT-FALSE of the previous bytes (2)
+* 
+* Each record is encoded with COBS and followed by 0x00 (see <VespaCodec>).
+* The values of the sources not attached are 0.
+*/
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Write a value in little endian
+//  @param (buffer) : the destination [uint8_t *]
+//         (value) : the value to write [uint32_t]
+//         (size) : the number of bytes [uint8_t]
+//  @returns the position after the value [uint8_t *]
+static uint8_t * _putLE(uint8_t *buffer, uint32_t value, uint8_t size){
+  for (uint8_t i=0 ; i < size ; i++){
+    *buffer++ = (value >> (8 * i)) & 0xFF;
+  }
+  return buffer;
+}
+
+// --------------------------------------------------
+
+// Constrain a duty cycle to 16 bits
+//  @param (duty) : the duty cycle [int32_t]
+//  @returns the constrained value [int16_t]
+static int16_t _toInt16(int32_t duty){
+  if (duty > INT16_MAX){
+    return INT16_MAX;
+  }
+  if (duty < -INT16_MAX){
+    return -INT16_MAX;
+  }
+  return duty;
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Constructor
+//  @param (output) : the destination of the records (e.g. <Serial>) [Print &]
+//         (period) : the period between two records [ms] [uint32_t]
+//  Note: the output must implement <availableForWrite()>.
+VespaTelemetry::VespaTelemetry(Print &output, uint32_t period) :
+  _output(output),
+  _battery(nullptr),
+  _button(nullptr),
+  _motors(nullptr),
+  _period(period),
+  _next_time(0),
+  _dropped(0),
+  _sequence(0),
+  _lengths{0, 0},
+  _sending(0),
+  _sent(0),
+  _pending(false)
+{
+  for (uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+    this->_servos[i] = nullptr; // default to null pointer
+  }
+}
+
+// --------------------------------------------------
+
+// Destructor
+VespaTelemetry::~VespaTelemetry(void){
+  // nothing to do here
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Add the battery to the records
+//  @param (battery) : the battery [VespaBattery &]
+void VespaTelemetry::attach(VespaBattery &battery){
+  this->_battery = &battery;
+}
+
+// --------------------------------------------------
+
+// Add a button to the records
+//  @param (button) : the button [VespaButton &]
+void VespaTelemetry::attach(VespaButton &button){
+  this->_button = &button;
+}
+
+// --------------------------------------------------
+
+// Add the motors to the records
+//  @param (motors) : the motors [VespaMotors &]
+void VespaTelemetry::attach(VespaMotors &motors){
+  this->_motors = &motors;
+}
+
+// --------------------------------------------------
+
+// Add a servo to the records
+//  @param (servo) : the servo [VespaServo &]
+//  @returns false if there are already <VESPA_SERVO_QTY> servos [bool]
+//  Note: the servos are recorded in the order they were added.
+bool VespaTelemetry::attach(VespaServo &servo){
+  for (uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+    if (this->_servos[i] == &servo){
+      return true; // already added
+    }
+    if (this->_servos[i] == nullptr){
+      this->_servos[i] = &servo;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// --------------------------------------------------
+
+// Get the number of records dropped
+//  @returns the number of records sampled but not sent [uint32_t]
+//  Note: increase the period or the baud rate if the records are being dropped.
+uint32_t VespaTelemetry::getDropped(void){
+  return this->_dropped;
+}
+
+// --------------------------------------------------
+
+// Set the period between two records
+//  @param (period) : the period [ms] [uint32_t]
+void VespaTelemetry::setPeriod(uint32_t period){
+  this->_period = period;
+}
+
+// --------------------------------------------------
+
+// Sample and send the records
+//  Note: call it in <loop()>, at least as often as the period. It never blocks.
+void VespaTelemetry::update(void){
+  // sample a new record
+  uint32_t now = VespaHAL::millis();
+  if ((this->_period > 0) && ((int32_t)(now - this->_next_time) >= 0)){
+    this->_next_time += this->_period;
+    if ((int32_t)(now - this->_next_time) >= 0){
+      this->_next_time = now + this->_period; // late (skip the missed records)
+    }
+
+    // the record not sent yet is replaced by the new one
+    if (this->_pending){
+      this->_dropped++;
+    }
+    this->_sample(this->_sending ^ 0x01);
+    this->_pending = true;
+  }
+
+  this->_send();
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Sample the state of the board into a frame
+//  @param (index) : the index of the frame [uint8_t]
+void VespaTelemetry::_sample(uint8_t index){
+  uint8_t record[VespaTelemetry::RECORD_SIZE];
+  uint8_t flags = 0x00;
+  int32_t duty_left = 0, duty_right = 0;
+  uint32_t voltage = 0;
+
+  if (this->_motors != nullptr){
+    flags |= 0x01;
+    duty_left = this->_motors->getDutyLeft();
+    duty_right = this->_motors->getDutyRight();
+  }
+  if (this->_battery != nullptr){
+    flags |= 0x02;
+    voltage = this->_battery->readVoltage();
+  }
+  if (this->_button != nullptr){
+    flags |= 0x04;
+    flags |= this->_button->read() ? 0x08 : 0x00;
+  }
+
+  uint8_t *position = record;
+  position = _putLE(position, VespaTelemetry::RECORD_TYPE, 1);
+  position = _putLE(position, this->_sequence++, 2);
+  position = _putLE(position, VespaHAL::millis(), 4);
+  uint8_t *position_flags = position++; // updated with the servos
+  position = _putLE(position, (uint16_t)_toInt16(duty_left), 2);
+  position = _putLE(position, (uint16_t)_toInt16(duty_right), 2);
+  position = _putLE(position, (voltage > UINT16_MAX) ? UINT16_MAX : voltage, 2);
+  for (uint8_t i=0 ; i < VESPA_SERVO_QTY ; i++){
+    uint16_t pulse_width = 0;
+    if ((this->_servos[i] != nullptr) && this->_servos[i]->attached()){
+      flags |= 0x10 << i;
+      pulse_width = this->_servos[i]->getPulseWidth();
+    }
+    position = _putLE(position, pulse_width, 2);
+  }
+  *position_flags = flags;
+  uint16_t crc = VespaCodec::crc16(record, position - record);
+  _putLE(position, crc, 2);
+
+  // encode and add the delimiter
+  uint8_t *frame = this->_frames[index];
+  uint8_t length = VespaCodec::encodeCOBS(record, VespaTelemetry::RECORD_SIZE, frame);
+  frame[length++] = 0x00;
+  this->_lengths[index] = length;
+}
+
+// --------------------------------------------------
+
+// Send the frames with the space available in the output
+void VespaTelemetry::_send(void){
+  // check if the current frame was sent
+  if (this->_sent >= this->_lengths[this->_sending]){
+    if (!this->_pending){
+      return; // nothing to send
+    }
+
+    // swap the buffers
+    this->_sending ^= 0x01;
+    this->_sent = 0;
+    this->_pending = false;
+  }
+
+  int available = this->_output.availableForWrite();
+  if (available <= 0){
+    return;
+  }
+
+  size_t size = this->_lengths[this->_sending] - this->_sent;
+  if (size > (size_t)available){
+    size = available;
+  }
+  this->_sent += this->_output.write(&this->_frames[this->_sending][this->_sent], size);
+}
+
+// --------------------------------------------------
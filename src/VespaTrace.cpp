@@ -0,0 +1,160 @@
+/*******************************************************************************
+* RoboCore Vespa Trace Library
+* 
+* Ring buffers of the calls to the methods of the Vespa library.
+* 
+* Copyright 2024 RoboCore.
+* 
+* 
+* This file is part of the Vespa library by RoboCore ("RoboCore-Vespa-lib").
+* 
+* "RoboCore-Vespa-lib" is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+* 
+* "RoboCore-Vespa-lib" is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public License
+* along with "RoboCore-Vespa-lib". If not, see <https://www.gnu.org/licenses/>
+*******************************************************************************/
+
+/*
+* Format of the binary trace (little endian):
+*   header : "VTRC" (4) | version (1) | cores (1) | entries per core (2) | cycles per [us] (4)
+*   core   : core ID (1) | number of entries (2) | total recorded (4)
+*   entry  : cycles (4) | argument (4) | event (1)
+* 
+* The header is followed by one block per core, each with its entries from the
+* oldest to the newest. The entries lost to the overwriting of the ring buffer
+* are given by (total recorded - number of entries).
+*/
+
+// --------------------------------------------------
+// Libraries
+
+#include "RoboCore_Vespa.h"
+
+// --------------------------------------------------
+// Variables
+
+#if defined(VESPA_TRACE_ENABLED)
+
+static_assert((VESPA_TRACE_SIZE & (VESPA_TRACE_SIZE - 1)) == 0, "The size of the trace must be a power of 2");
+static_assert(VESPA_TRACE_SIZE <= 0xFFFF, "The size of the trace must fit in 16 bits");
+
+struct VespaTraceEntry {
+  uint32_t cycles;
+  uint32_t argument;
+  uint8_t event;
+};
+
+static VespaTraceEntry _trace_entries[VESPA_TRACE_CORES][VESPA_TRACE_SIZE];
+static std::atomic<uint32_t> _trace_heads[VESPA_TRACE_CORES]; // total recorded
+static std::atomic<bool> _trace_paused(false);
+
+#endif
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Write a value in little endian
+//  @param (output) : the destination [Print &]
+//         (value) : the value to write [uint32_t]
+//         (size) : the number of bytes [uint8_t]
+//  @returns the number of bytes written [size_t]
+static size_t _writeLE(Print &output, uint32_t value, uint8_t size){
+  uint8_t buffer[4];
+  for (uint8_t i=0 ; i < size ; i++){
+    buffer[i] = (value >> (8 * i)) & 0xFF;
+  }
+  return output.write(buffer, size);
+}
+
+// --------------------------------------------------
+// --------------------------------------------------
+
+// Clear the entries of all the cores
+void VespaTrace::clear(void){
+#if defined(VESPA_TRACE_ENABLED)
+  for (uint8_t i=0 ; i < VESPA_TRACE_CORES ; i++){
+    _trace_heads[i].store(0, std::memory_order_relaxed);
+  }
+#endif
+}
+
+// --------------------------------------------------
+
+// Write the binary trace (see the format above)
+//  @param (output) : the destination (e.g. <Serial>) [Print &]
+//  @returns the number of bytes written [size_t]
+//  Note: the recording is paused while writing, so the trace is consistent.
+//        Only the header is written if the trace is not enabled.
+size_t VespaTrace::dump(Print &output){
+  size_t res = output.write((const uint8_t *)"VTRC", 4);
+  res += _writeLE(output, VespaTrace::FORMAT_VERSION, 1);
+
+#if defined(VESPA_TRACE_ENABLED)
+  _trace_paused.store(true, std::memory_order_seq_cst);
+
+  res += _writeLE(output, VESPA_TRACE_CORES, 1);
+  res += _writeLE(output, VESPA_TRACE_SIZE, 2);
+  res += _writeLE(output, VespaHAL::cyclesPerMicrosecond(), 4);
+
+  for (uint8_t core=0 ; core < VESPA_TRACE_CORES ; core++){
+    uint32_t head = _trace_heads[core].load(std::memory_order_acquire);
+    uint32_t count = (head < VESPA_TRACE_SIZE) ? head : VESPA_TRACE_SIZE;
+
+    res += _writeLE(output, core, 1);
+    res += _writeLE(output, count, 2);
+    res += _writeLE(output, head, 4);
+
+    for (uint32_t i=(head - count) ; i != head ; i++){
+      const VespaTraceEntry &entry = _trace_entries[core][i & (VESPA_TRACE_SIZE - 1)];
+      res += _writeLE(output, entry.cycles, 4);
+      res += _writeLE(output, entry.argument, 4);
+      res += _writeLE(output, entry.event, 1);
+    }
+  }
+
+  _trace_paused.store(false, std::memory_order_seq_cst);
+#else
+  res += _writeLE(output, 0, 1); // no cores
+  res += _writeLE(output, 0, 2);
+  res += _writeLE(output, VespaHAL::cyclesPerMicrosecond(), 4);
+#endif
+
+  return res;
+}
+
+// --------------------------------------------------
+
+// Record an event in the buffer of the current core
+//  @param (event) : the event (see <VespaTraceEvent>) [uint8_t]
+//         (argument) : the argument of the method [uint32_t]
+//  Note: lock-free and in IRAM, so it can be called from interrupts. An interrupt
+//        only reserves the next slot of the buffer of its core.
+void IRAM_ATTR VespaTrace::record(uint8_t event, uint32_t argument){
+#if defined(VESPA_TRACE_ENABLED)
+  if (_trace_paused.load(std::memory_order_relaxed)){
+    return;
+  }
+
+  uint32_t cycles = VespaHAL::cycles();
+  uint8_t core = VespaHAL::coreID() % VESPA_TRACE_CORES;
+  uint32_t index = _trace_heads[core].fetch_add(1, std::memory_order_relaxed) & (VESPA_TRACE_SIZE - 1);
+
+  VespaTraceEntry &entry = _trace_entries[core][index];
+  entry.cycles = cycles;
+  entry.argument = argument;
+  entry.event = event;
+#else
+  (void)event;
+  (void)argument;
+#endif
+}
+
+// --------------------------------------------------